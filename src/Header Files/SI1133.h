@@ -11,36 +11,90 @@
 #include "i2c.h"
 #include "brd_config.h"
 #include "HW_delay.h"
+#include "i2c_bench.h"
+#include "retain.h"
 
-#define   NULL_CB           0x00         //0b0000
+#define   NULL_CB           SCHED_NO_EVENT
+#define   SI1133_ADDRESS    0x55
 #define   RESET_CMD_CNT     0x00
 #define   PART_ID_REGISTER  0x00  //Register address for Part ID
+#define   SI1133_PART_ID    0x33  //Part ID register value
 #define   RESPONSE0         0x11
+#define   RESPONSE1         0x10
 #define   INPUT0            0x0A
 #define   COMMAND           0x0B
 #define   ADCCONFIG0        0x02
 #define   WHITE_LIGHT       0b01011 //For adcmux
+#define   LARGE_IR          0b00010 //For adcmux
+#define   UV                0b11000 //For adcmux
+#define   DECIM_2048        (1 << DECIM_RATE_SHIFT)
+#define   DECIM_4096        (2 << DECIM_RATE_SHIFT)
 #define   COMMAND_BITS      0b10000000 //for ORing with command
+#define   PARAM_QUERY_BITS  0b01000000 //for ORing with a parameter, result in RESPONSE1
 #define   CHANNEL0_PREP     0b000001
 #define   CHAN_LIST         0x01
 #define   FORCE             0x11 //force command
 #define   HOSTOUT0          0x13
 #define   HOSTOUT1          0x14
 #define   HOSTOUT2          0x15
+#define   IRQ_ENABLE        0x0F  //Register, a set bit latches the channel's completion in IRQ_STATUS
+#define   IRQ_STATUS        0x12  //Register, cleared by reading, directly before HOSTOUT0
+#define   ADCSENS0          0x03
+#define   PARAM_CHANNEL_STRIDE  4     //ADCCONFIGn = ADCCONFIG0 + 4n, ADCSENSn = ADCSENS0 + 4n
+#define   SI1133_CHANNELS   6
+#define   SI1133_READ_WORDS ((1 + 2 * SI1133_CHANNELS + 3) / 4) //IRQ_STATUS and a 16 bit result per channel
+
+// Channel periods in FORCEs, channel 0 (white light) is measured on every one
+#define   SI1133_IR_PERIOD  10
+#define   SI1133_UV_PERIOD  30
+
+// Measurement time model, Si1133 datasheet ADCCONFIG/ADCSENS descriptions
+#define   DECIM_RATE_SHIFT  5     //ADCCONFIGx[6:5]
+#define   HW_GAIN_MASK      0x0F  //ADCSENSx[3:0], integration time doubles per step
+#define   SW_GAIN_SHIFT     4     //ADCSENSx[6:4], 2^SW_GAIN measurements are summed
+#define   SW_GAIN_MASK      0x07
+#define   SI1133_MEAS_HALF_NS   12200 //half of one measurement at DECIM_RATE 0 (1024 clocks) and HW_GAIN 0
+#define   SI1133_CHANNEL_US     50    //per channel sequencing, margin over the datasheet figure
+#define   SI1133_START_US       200   //FORCE to first conversion, margin over the datasheet figure
+#define   SI1133_FORCE_BUS_US   100   //FORCE write on the bus at 400 kHz, START to STOP
+#define   SI1133_READ_RETRIES   3     //stale result reads retried before the sample is dropped
+#define   CMD_CTR_MASK      0x0F  //RESPONSE0[3:0], completed command counter
+#define   CMD_ERR           0x10  //RESPONSE0[4], last command failed
+#define   SI1133_CONFIG_VERIFY  si1133_verify_deferred  //RESPONSE0 check of the configuration writes
+#define   SI1133_PROBE_US   2000  //a transaction to a sensor that is still starting up is abandoned after this
+#define   SI1133_NO_RESPONSE    0xFFFFFFFF
 
 //***********************************************************************************
 // global variables
 //***********************************************************************************
+typedef enum {
+  si1133_verify_each,       // read RESPONSE0 after every parameter write
+  si1133_verify_deferred    // read RESPONSE0 once after all of them
+} SI1133_VERIFY;
+
+typedef struct {
+  uint8_t   adcconfig;    // ADCCONFIGn, adcmux and decimation
+  uint8_t   adcsens;      // ADCSENSn, 0 keeps the reset value
+  uint16_t  period;       // measured on every period-th FORCE
+} SI1133_CHANNEL_CONFIG;
 
 
 //***********************************************************************************
 // function prototypes
 //***********************************************************************************
 void Si1133_i2c_open();
+void si1133_i2c_bench(void);
+void si1133_i2c_reopen(I2C_EXEC_MODE exec);
+void si1133_profile_set(uint32_t channels, uint32_t white_adcsens);
 void si1133_read(uint32_t bytes_expected, uint32_t desired_register_address, uint32_t app_cb);
 void si1133_write(uint32_t bytes_expected, uint32_t desired_register_address, uint32_t app_cb);
 void si1133_force_cmd();
+bool si1133_force_try(void);
 void si1133_read_white_light(uint32_t light_cb);
 uint32_t si1133_read_result();
+bool si1133_result_fresh(void);
+uint32_t si1133_conversion_us(void);
+uint32_t si1133_channel_result(uint32_t channel);
+uint32_t si1133_gain_shift(uint32_t channel);
 
 #endif /* HEADER_FILES_SI1133_H_ */
@@ -20,25 +20,95 @@
 #include "sleep_routines.h"
 #include "LEDs_thunderboard.h"
 #include "SI1133.h"
+#include "timing.h"
+#include "metrics.h"
+#include "idle_work.h"
+#include "sync_input.h"
+#include "saturation_bench.h"
+#include "leuart.h"
+#include "sample_log.h"
+#include "log_export.h"
+#include "pipeline.h"
+#include "event_bus.h"
+#include "led_fade.h"
+#include "flash.h"
+#include "retain.h"
+#include "profile.h"
+#include "history.h"
 
 
 //***********************************************************************************
 // defined files
 //***********************************************************************************
-#define   PWM_PER             1.0   // PWM period in seconds
-#define   PWM_ACT_PER         .002  // PWM active period in seconds
+#define   PWM_PER             1.0   // PWM period in seconds of the standard profile, above 65.5 s the LETIMER clock is prescaled
 #define   READ_BYTES          1     //Number of bytes we want to read from si1133
 #define   EXPECTED_READ_DATA  20    //Part ID value expected to return from read
+#define   FILTER_SHIFT        2     //Smoothing of the filter stage, each sample moves the output 1/4 of the way
+#define   APP_PROFILE_INITIAL app_profile_standard  //Operating profile of a cold boot, see app_profiles in app.c
+
+//#define   GPIO_LEAKAGE_CHARACTERIZE       //Steps the sleep pin-state profile so the EM2/EM3 floor of each can be read on the Energy Profiler
+#define   GPIO_LEAKAGE_PERIODS  10  //LETIMER periods spent sleeping in each profile while characterizing
+
+//#define   SYNC_INPUT_MODE                 //Samples on the external sync edge instead of the LETIMER
+
+//#define   SATURATION_BENCH                //Steps the sample rate up until the pipeline saturates, results in the bench_* metrics
+
+//#define   LED_FADE_VISUALIZE              //Fades the green LED to the filtered light level on every sample
+#define   FADE_VISUALIZE_MS     800       //Fade length, shorter than PWM_PER so each fade completes before the next sample
+
+//#define   FLASH_LATENCY_BENCH             //Erases and rewrites a storage page continuously, compare i2c_isr_flash_cycles to i2c_isr_cycles, replaces the history
+
+//#define   BUS_FANOUT_BENCH                //Measures event bus delivery cost per subscriber at startup, results in bus_fanout_cycles
+
+//#define   I2C_TIMING_BENCH                //Sweeps the I2C timing settings at startup, results in i2c_bench_table and i2c_bench_choice
+
+//#define   CLOCK_GATING_BASELINE           //Holds HFPER and I2C1 enabled as before clock gating, the EM0/EM1 current difference is the saving
 
 
 //***********************************************************************************
 // global variables
 //***********************************************************************************
-// Application scheduled events
-#define   LETIMER0_COMP0_CB     0x00000001   //0b0001
-#define   LETIMER0_COMP1_CB     0x00000002   //0b0010
-#define   LETIMER0_UF_CB        0x00000004   //0b0100
-#define   SI1133_LIGHT_CB   0x00000008   //0b1000
+// Application scheduled events, ids allocated in priority order: the lowest scheduled id is handled first.
+// Every event has a handler in the event table in app.c.
+typedef enum {
+  app_event_none = SCHED_NO_EVENT,
+  LETIMER0_UF_CB,
+  LETIMER0_COMP0_CB,
+  LETIMER0_COMP1_CB,
+  SI1133_LIGHT_CB,
+  SYNC_READ_CB,
+  LEUART0_RX_CB,
+  LEUART0_TX_CB,
+  FLASH_DONE_CB,
+  LIGHT_SAMPLE_CB,        //event bus topics
+  PIPE_CLASSIFY_CB,       //sample pipeline stages
+  PIPE_FILTER_CB,
+  PIPE_LOG_CB,
+  PIPE_TELEMETRY_CB,
+  APP_EVENT_COUNT
+} APP_EVENT;
+
+// Event bus topics, index into the topic table in app.c
+typedef enum {
+  app_topic_light_sample,       // payload is an APP_LIGHT_SAMPLE
+  APP_TOPIC_COUNT
+} APP_TOPIC;
+
+// Operating profiles, index into the profile table in app.c. EXPORT_CMD_PROFILE switches between them.
+typedef enum {
+  app_profile_standard,         // PWM_PER sampling of every channel, every sample logged
+  app_profile_low_power,        // slow white light only sampling, no LEDs or telemetry, every 6th sample logged
+  app_profile_diagnostic,       // fast sampling of every channel with telemetry
+  app_profile_high_accuracy,    // white light only at a longer integration time
+  APP_PROFILE_COUNT
+} APP_PROFILE;
+
+// Payload of app_topic_light_sample, valid until the next sample is read
+typedef struct {
+  uint32_t raw;
+  uint32_t gain;          // log2 of the gain raw was measured at
+  uint32_t timestamp;
+} APP_LIGHT_SAMPLE;
 
 
 
@@ -53,6 +123,10 @@ void scheduled_letimer0_uf_cb (void);
 void scheduled_letimer0_comp0_cb (void);
 void scheduled_letimer0_comp1_cb (void);
 void scheduled_si1133_read_cb(void);
+void scheduled_sync_read_cb(void);
+void scheduled_leuart0_rx_cb(void);
+void scheduled_leuart0_tx_cb(void);
+void scheduled_flash_done_cb(void);
 void rgb_led_open(void);
 
 #endif
@@ -77,6 +77,29 @@
 #define SI1133_DRIVE_STRENGTH gpioDriveStrengthWeakAlternateWeak
 #define SI1133_SENSOR_EN_DEFAULT true
 
+// Sync input (edge shared between boards for coordinated sampling)
+#define SYNC_IN_PORT          gpioPortD
+#define SYNC_IN_PIN           10
+#define SYNC_IN_GPIOMODE      gpioModeInputPullFilter
+#define SYNC_IN_PULL          false     // pull down, an idle line reads low
+#define SYNC_PRS_CH           0
+#define SYNC_PRS_SOURCE       PRS_CH_CTRL_SOURCESEL_GPIOH   // pins 8-15
+#define SYNC_PRS_SIGNAL       PRS_CH_CTRL_SIGSEL_GPIOPIN10
+
+// LEUART0 on the board controller virtual COM port
+#define LEUART_TX_PORT        gpioPortA
+#define LEUART_TX_PIN         0
+#define LEUART_TX_DEFAULT     true      // UART idles high
+#define LEUART_RX_PORT        gpioPortA
+#define LEUART_RX_PIN         1
+#define LEUART_RX_DEFAULT     false
+#define VCOM_ENABLE_PORT      gpioPortA
+#define VCOM_ENABLE_PIN       5
+#define VCOM_ENABLE_DEFAULT   true
+#define LEUART_TX_ROUTE       LEUART_ROUTELOC0_TXLOC_LOC0
+#define LEUART_RX_ROUTE       LEUART_ROUTELOC0_RXLOC_LOC0
+#define LEUART_BAUDRATE       9600
+
 // I2C Route Location
 #define I2C_SCL_PC5   I2C_ROUTELOC0_SCLLOC_LOC17
 #define I2C_SDA_PC4   I2C_ROUTELOC0_SDALOC_LOC17
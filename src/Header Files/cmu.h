@@ -5,14 +5,17 @@
 #define CMU_HG
 
 /* System include statements */
-
+#include <stdint.h>
+#include <stdbool.h>
 
 /* Silicon Labs include statements */
 #include "em_cmu.h"
+#include "em_core.h"
 #include "em_assert.h"
 
 /* The developer's include statements */
-
+#include "metrics.h"
+#include "timing.h"
 
 
 //***********************************************************************************
@@ -23,11 +26,22 @@
 //***********************************************************************************
 // global variables
 //***********************************************************************************
+// Clocks gated by reference count, every one but HFPER is a peripheral on the HFPER branch
+typedef enum {
+  cmu_gate_hfper,
+  cmu_gate_i2c0,
+  cmu_gate_i2c1,
+  cmu_gate_timer0,
+  cmu_gate_timer1,
+  CMU_GATES
+} CMU_GATE;
 
 
 //***********************************************************************************
 // function prototypes
 //***********************************************************************************
 void cmu_open(void);
+void cmu_clock_acquire(CMU_Clock_TypeDef clock);
+void cmu_clock_release(CMU_Clock_TypeDef clock);
 
 #endif
@@ -0,0 +1,51 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef EVENT_BUS_HG
+#define EVENT_BUS_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+#include "em_core.h"
+
+/* The developer's include statements */
+#include "scheduler.h"
+#include "metrics.h"
+#include "timing.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define BUS_MAX_TOPICS        8
+#define BUS_MAX_SUBSCRIBERS   8
+#define BUS_BENCH_ROUNDS      16    // deliveries averaged per point of the fan-out benchmark
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+// Subscribers receive the publisher's payload by reference and must not keep the pointer
+typedef void (*BUS_HANDLER)(const void *payload);
+
+// Topics and their subscriber lists are defined as constant tables by the application
+typedef struct {
+  const char          *name;
+  uint32_t            event;        // scheduler event used to deliver the topic
+  const BUS_HANDLER   *subscribers; // called in table order
+  uint32_t            count;
+} BUS_TOPIC;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void bus_open(const BUS_TOPIC *topics, uint32_t count);
+void bus_publish(uint32_t topic, const void *payload);
+void bus_dispatch(void);
+void bus_fanout_bench(void);
+
+#endif
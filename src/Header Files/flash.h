@@ -0,0 +1,60 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef FLASH_HG
+#define FLASH_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_device.h"
+#include "em_ldma.h"
+#include "em_core.h"
+#include "em_assert.h"
+
+/* The developer's include statements */
+#include "ldma.h"
+#include "scheduler.h"
+#include "sleep_routines.h"
+#include "metrics.h"
+#include "timing.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define FLASH_PAGE_WORDS      (FLASH_PAGE_SIZE / 4)        // FLASH_PAGE_SIZE comes from the device header
+#define FLASH_STORAGE_PAGES   32                  // pages reserved at the end of flash for application data, the history
+#define FLASH_STORAGE_SIZE    (FLASH_STORAGE_PAGES * FLASH_PAGE_SIZE)
+#define FLASH_EM_BLOCK        EM2                 // the LDMA and the MSC write sequencer need EM1
+#define FLASH_LDMA_SIGNAL     ldmaPeripheralSignal_MSC_WDATA
+#define FLASH_ERASE_MAX_MS    40                  // worst case page erase time of the EFR32MG12, flash fetches stall meanwhile
+
+// Code that touches the MSC while it is programming is copied to RAM by the startup code with .data
+#define FLASH_RAMFUNC         __attribute__((section(".ram"), noinline, long_call))
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef enum {
+  flash_idle,
+  flash_erasing,
+  flash_writing,      // LDMA is feeding WDATA
+  flash_draining,     // LDMA is done, the MSC is programming the last word
+} FLASH_STATE;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void flash_open(uint32_t done_cb);
+bool flash_erase(uint32_t *page);
+bool flash_write(uint32_t *dest, const uint32_t *src, uint32_t words);
+bool flash_busy(void);
+bool flash_error(void);
+uint32_t *flash_storage(void);
+void MSC_IRQHandler(void);
+
+#endif
@@ -5,7 +5,8 @@
 #define GPIO_HG
 
 /* System include statements */
-
+#include <stdint.h>
+#include <stdbool.h>
 
 /* Silicon Labs include statements */
 #include "em_cmu.h"
@@ -14,19 +15,39 @@
 
 /* The developer's include statements */
 #include "brd_config.h"
+#include "timing.h"
 
 //***********************************************************************************
 // defined files
 //***********************************************************************************
+#define GPIO_LEVEL_KEEP     0xFF    // Profile leaves the output level of the pin to the application
+#define GPIO_MODE_BITS      4       // Width of one pin's field in the MODEL/MODEH registers
 
 //***********************************************************************************
 // global variables
 //***********************************************************************************
+typedef enum {
+  gpio_profile_active,    // run state set up by gpio_open()
+  gpio_profile_sleep,     // EM2/EM3 state, I2C bus is idle so its pins are released
+  gpio_profile_shipping,  // everything off, sensor unpowered
+  GPIO_PROFILE_COUNT
+} GPIO_PROFILE;
+
+typedef struct {
+  uint32_t    entries;        // number of times the profile was applied
+  uint32_t    pins_touched;   // pins whose mode or level was actually rewritten
+  uint32_t    switch_cycles;  // cycles of the last switch into the profile
+} GPIO_PROFILE_STATS;
 
 
 //***********************************************************************************
 // function prototypes
 //***********************************************************************************
 void gpio_open(void);
+void gpio_profile_set(GPIO_PROFILE profile);
+GPIO_PROFILE gpio_profile_get(void);
+void gpio_profile_sleep_select(GPIO_PROFILE profile);
+GPIO_PROFILE gpio_profile_sleep_get(void);
+const GPIO_PROFILE_STATS *gpio_profile_stats(GPIO_PROFILE profile);
 
 #endif
@@ -0,0 +1,89 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef HISTORY_HG
+#define HISTORY_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+
+/* The developer's include statements */
+#include "flash.h"
+#include "idle_work.h"
+#include "letimer.h"
+#include "sample_log.h"
+#include "metrics.h"
+#include "timing.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+/* The history keeps the light level for months in the flash storage pages at a fixed size. Full resolution
+ * samples stay in the sample log. Every completed minute is stored as one record in the minute ring, and
+ * minutes older than HISTORY_MINUTE_AGE are merged into hour records in the hour ring, which frees their page.
+ * The hour ring drops its oldest page once it is full. Time is powered time in minutes, counted on from the
+ * newest record after every reset, as the board has no calendar. */
+#define HISTORY_RECORD_WORDS    3
+#define HISTORY_PAGE_RECORDS    (FLASH_PAGE_WORDS / HISTORY_RECORD_WORDS)
+#define HISTORY_PAGE_HOURS      2       // a minute page holds the minutes of one window of whole hours
+#define HISTORY_PAGE_MINUTES    (HISTORY_PAGE_HOURS * 60)
+#define HISTORY_MINUTE_PAGES    8       // 16 hours of minutes, the other storage pages hold hours
+#define HISTORY_HOUR_PAGES      (FLASH_STORAGE_PAGES - HISTORY_MINUTE_PAGES)
+#define HISTORY_MINUTE_AGE      (12 * 60)   // minutes kept at minute resolution, below the minute ring's capacity
+#define HISTORY_SAMPLES_PER_UNIT  32    // samples aggregated per unit of idle work
+#define HISTORY_FREE            0xFFFFFFFF  // minute of an erased record
+#define HISTORY_NO_PAGE         0xFFFFFFFF
+
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+// One aggregate as stored in flash, over the log codes of the samples it covers
+typedef struct {
+  uint32_t    minute;       // first minute covered, HISTORY_FREE while the record is erased
+  uint16_t    min;
+  uint16_t    max;
+  uint16_t    mean;         // mean log code, the geometric mean of the readings
+  uint16_t    count;        // samples, saturated at 0xFFFF
+} HISTORY_RECORD;
+
+typedef enum {
+  history_minutes,
+  history_hours,
+  HISTORY_TIERS
+} HISTORY_TIER;
+
+// Ring of storage pages holding the records of one tier in time order
+typedef struct {
+  uint32_t    first_page;   // storage page of ring page 0
+  uint32_t    pages;
+  uint32_t    write_page;   // ring page holding the newest record
+  uint32_t    write_slot;   // next free record of write_page
+} HISTORY_RING;
+
+// Aggregate being built
+typedef struct {
+  uint32_t    minute;
+  uint32_t    min;
+  uint32_t    max;
+  uint64_t    sum;
+  uint32_t    count;
+} HISTORY_ACC;
+
+// Converts a timestamp difference of the sample log to ms
+typedef uint32_t (*HISTORY_CLOCK)(uint32_t elapsed);
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void history_open(HISTORY_CLOCK clock);
+void history_poll(void);
+void history_flash_done(void);
+
+#endif
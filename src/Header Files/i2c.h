@@ -14,12 +14,33 @@
 #include <stdbool.h>
 #include "sleep_routines.h"
 #include "scheduler.h"
+#include "metrics.h"
+#include "timing.h"
+#include "flash.h"
+#include "cmu.h"
 
 //***********************************************************************************
 // global variables
 //***********************************************************************************
 #define I2C_EM_BLOCK   EM2
 
+// Execution mode cost model. Currents are approximate datasheet figures, only used to rank the modes.
+#define I2C_EM0_UA_PER_MHZ      69    // core running, polling
+#define I2C_EM1_UA_PER_MHZ      46    // core sleeping between interrupts, peripherals clocked
+#define I2C_SUPPLY_MV           3000
+#define I2C_ISR_DEFAULT_CYCLES  150   // handler entry, body and exit before the I2C1 handler has been measured
+#define I2C_DISPATCH_CYCLES     400   // scheduler dispatch and sleep entry for the completion event
+#define I2C_POLL_MAX_US         250   // longest transaction polled, bounds how long the caller is held
+#define I2C_FRAME_BITS          9     // 8 data bits and the ACK
+#define I2C_ISR_AVG_SHIFT       3     // handler time average moves 1/8 of the way per interrupt
+
+typedef enum {
+  i2c_exec_polled,      // caller spins on the IF flags, no interrupts
+  i2c_exec_irq,         // interrupt per ACK/RXDATAV/MSTOP, core in EM1 in between
+  i2c_exec_auto,        // choose per transaction from the cost model
+  I2C_EXEC_MODES = i2c_exec_auto
+} I2C_EXEC_MODE;
+
 typedef struct {
   bool                  enable;
   bool                  master;
@@ -33,6 +54,7 @@ typedef struct {
   bool                  ack_irq_enable;
   bool                  rxdatav_irq_enable;
   bool                  stop_irq_enable;
+  I2C_EXEC_MODE         exec_policy;  // fixed execution mode or i2c_exec_auto
 
 
 } I2C_OPEN_STRUCT ;
@@ -63,16 +85,34 @@ typedef struct {
   uint32_t              *data;
   uint32_t              I2C_CB;
   DEFINED_STATES        current_state;
+  uint32_t              start_cycles; //cycle count at START, for the transaction time histogram
+  I2C_EXEC_MODE         exec_policy;
+  I2C_EXEC_MODE         exec;         //mode of the current transaction
+  uint32_t              bus_hz;
+  uint32_t              core_hz;
+  uint32_t              isr_avg_cycles; //measured handler cost, feeds the cost model
+  CMU_Clock_TypeDef     clock;          //peripheral clock, held only during a transaction
 
 } I2C_STATE_MACHINE;
 
+// Totals of every I2C transaction since metrics_open(), a module measures its share as the difference of two copies
+typedef struct {
+  uint32_t              transactions;
+  uint32_t              busy_waits;     //i2c_start() calls that waited for the previous transaction
+  uint32_t              busy_cycles;    //START to MSTOP time
+  uint32_t              isr_cycles;     //I2C handler time
+} I2C_STATS;
+
 
 //***********************************************************************************
 // function prototypes
 //***********************************************************************************
-void i2c_start(I2C_TypeDef *i2c, uint32_t device_address, OPERATION_MODE mode, uint32_t *data, uint32_t bytes_expected, uint32_t desired_register_address, uint32_t app_cb);
+void i2c_start(I2C_TypeDef *i2c, uint32_t device_address, OPERATION_MODE mode, uint32_t *data, uint32_t bytes_expected, uint32_t desired_register_address, uint32_t app_cb, bool caller_waits);
+bool i2c_try_start(I2C_TypeDef *i2c, uint32_t device_address, OPERATION_MODE mode, uint32_t *data, uint32_t bytes_expected, uint32_t desired_register_address, uint32_t app_cb, bool caller_waits);
 void i2c_open(I2C_TypeDef *i2c, I2C_OPEN_STRUCT *i2c_setup);
 bool i2c_available(I2C_TypeDef *i2c);
+void i2c_stats(I2C_STATS *stats);
+void i2c_abort(I2C_TypeDef *i2c);
 void I2C0_IRQHandler(void);
 void I2C1_IRQHandler(void);
 
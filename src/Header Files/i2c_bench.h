@@ -0,0 +1,59 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef I2C_BENCH_HG
+#define I2C_BENCH_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+#include "em_cmu.h"
+
+/* The developer's include statements */
+#include "i2c.h"
+#include "metrics.h"
+#include "timing.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define I2C_BENCH_BANDS           3       // HFRCO bands swept, see i2c_bench.c
+#define I2C_BENCH_CLHRS           3       // standard 4:4, asymmetric 6:3, fast 11:6
+#define I2C_BENCH_FREQS           3       // SCL frequencies swept
+#define I2C_BENCH_LENGTHS         4       // read lengths swept
+#define I2C_BENCH_MAX_BYTES       7       // longest read
+#define I2C_BENCH_POINTS          (I2C_BENCH_BANDS * I2C_BENCH_CLHRS * I2C_BENCH_FREQS * I2C_BENCH_LENGTHS)
+#define I2C_BENCH_TRANSACTIONS    16      // transactions measured at each point
+#define I2C_BENCH_TIMEOUT_US      5000    // a transaction still running after this is aborted and counted as an error
+#define I2C_BENCH_SIZING_BYTES    3       // read length the recommendation is made for, the white light result read
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef enum {
+  i2c_bench_bytes_per_s,      // payload throughput, START to MSTOP
+  i2c_bench_cycles_per_byte,  // CPU cycles per payload byte with interrupt execution, x16
+  i2c_bench_nj,               // modelled energy per transaction in nJ
+  i2c_bench_errors,           // wrong data or aborted transactions
+  I2C_BENCH_FIELDS
+} I2C_BENCH_FIELD;
+
+typedef enum {
+  i2c_bench_choice_band_hz,
+  i2c_bench_choice_clhr,
+  i2c_bench_choice_freq,
+  i2c_bench_choice_point,     // index of the point in i2c_bench_table
+  I2C_BENCH_CHOICE_FIELDS
+} I2C_BENCH_CHOICE;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void i2c_bench_run(I2C_TypeDef *i2c, I2C_OPEN_STRUCT *setup, uint32_t device_address, uint32_t reg, uint32_t expected);
+
+#endif
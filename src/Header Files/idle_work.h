@@ -0,0 +1,59 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef IDLE_WORK_HG
+#define IDLE_WORK_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+#include "em_core.h"
+#include "em_cmu.h"
+
+/* The developer's include statements */
+#include "scheduler.h"
+#include "timing.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define IDLE_WORK_MAX_JOBS      8
+#define IDLE_SLICE_US           1000    // Time budget of one idle slice, converted to core cycles at the current clock
+#define IDLE_MIN_HEADROOM_MS    3       // Minimum time to the next LETIMER deadline before a slice may run
+#define IDLE_NO_JOB             0xFFFFFFFF
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+// A job performs one small, bounded unit of work per call and returns true while more work remains
+typedef bool (*IDLE_JOB_FUNC)(void);
+
+typedef struct {
+  const char      *name;
+  IDLE_JOB_FUNC   job;
+  bool            pending;          // job has work remaining
+  uint32_t        posts;            // idle_work_post() calls, a post during a unit keeps the job pending
+  uint32_t        units;            // progress: units of work completed in total
+  uint32_t        completions;      // number of times the job ran out of work
+  uint32_t        slices;           // number of slices the job was given
+  uint32_t        cycles_total;     // cycles spent in the job
+  uint32_t        cycles_max_unit;  // longest single unit of work in cycles
+  uint32_t        overruns;         // slices that ended past the IDLE_SLICE_US budget
+} IDLE_JOB;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void idle_work_open(void);
+uint32_t idle_work_register(const char *name, IDLE_JOB_FUNC job);
+void idle_work_post(uint32_t job_id);
+bool idle_work_pending(void);
+void idle_work_run_slice(void);
+const IDLE_JOB *idle_work_stats(uint32_t job_id);
+
+#endif
@@ -0,0 +1,45 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef LDMA_HG
+#define LDMA_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_ldma.h"
+#include "em_assert.h"
+
+/* The developer's include statements */
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define LDMA_CHANNELS         8
+
+// Channel assignments, one owner per channel
+#define LDMA_CH_FADE_RED      0
+#define LDMA_CH_FADE_GREEN    1
+#define LDMA_CH_FADE_BLUE     2
+#define LDMA_CH_FLASH         3
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+// Called from the LDMA interrupt when a channel's transfer is complete
+typedef void (*LDMA_DONE_FUNC)(uint32_t channel);
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void ldma_open(void);
+void ldma_start(uint32_t channel, const LDMA_TransferCfg_t *config, const LDMA_Descriptor_t *descriptor, LDMA_DONE_FUNC done);
+void ldma_stop(uint32_t channel);
+uint32_t ldma_remaining(uint32_t channel);
+void LDMA_IRQHandler(void);
+
+#endif
@@ -0,0 +1,57 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef LED_FADE_HG
+#define LED_FADE_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_cmu.h"
+#include "em_timer.h"
+#include "em_ldma.h"
+#include "em_core.h"
+#include "em_assert.h"
+
+/* The developer's include statements */
+#include "brd_config.h"
+#include "LEDs_thunderboard.h"
+#include "ldma.h"
+#include "scheduler.h"
+#include "sleep_routines.h"
+#include "metrics.h"
+#include "cmu.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define FADE_TIMER            TIMER0
+#define FADE_TIMER_CLOCK      cmuClock_TIMER0
+#define FADE_TIMER_PRESCALE   timerPrescale32   // 26 MHz / 32 / 1024 = 793 Hz PWM, one ramp step per period
+#define FADE_TIMER_DIV        32
+#define FADE_PWM_TOP          1023              // 10 bit duty cycle so the low end of the gamma curve keeps its steps
+#define FADE_TIMER_EM         EM2               // TIMER0 and the LDMA stop in EM2, block it while a color is lit
+#define FADE_LDMA_SIGNAL      ldmaPeripheralSignal_TIMER0_UFOF
+#define FADE_CHANNELS         3                 // red, green, blue in COLOR_* bit order
+#define FADE_MAX_STEPS        1024              // longest ramp, about 1.3 s at the PWM rate
+#define FADE_LEVELS           256               // brightness levels, before gamma correction
+#define FADE_GAMMA_X2         5                 // gamma of 2.5, applied as sqrt(level^5)
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void led_fade_open(uint32_t colors, uint32_t done_cb);
+void led_fade_clock_update(void);
+void led_fade_to(uint32_t color, uint8_t level, uint32_t duration_ms);
+bool led_fade_busy(void);
+uint8_t led_fade_level(uint32_t color);
+
+#endif
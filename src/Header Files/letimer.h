@@ -23,6 +23,8 @@
 //***********************************************************************************
 #define LETIMER_HZ		1000			 // Utilizing ULFRCO oscillator for LETIMERs
 #define LETIMER_EM    EM4       // Using the ULFRCO, block from entering energey mode 4
+#define LETIMER_MAX_COUNT   0xFFFF    // COMP0 is 16 bits
+#define LETIMER_MAX_DIV     32768     // largest LFA prescaler, about 24 days per period
 
 //***********************************************************************************
 // global variables
@@ -50,6 +52,9 @@ typedef struct {
 //***********************************************************************************
 void letimer_pwm_open(LETIMER_TypeDef *letimer, APP_LETIMER_PWM_TypeDef *app_letimer_struct);
 void letimer_start(LETIMER_TypeDef *letimer, bool enable);
+bool letimer_pwm_period_set(LETIMER_TypeDef *letimer, float period, float active_period);
+uint32_t letimer_ticks_to_next_event(LETIMER_TypeDef *letimer);
+uint32_t letimer_ms_to_ticks(LETIMER_TypeDef *letimer, uint32_t ms);
 void LETIMER0_IRQHandler(void);
 
 #endif
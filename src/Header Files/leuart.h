@@ -0,0 +1,87 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef LEUART_HG
+#define LEUART_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_leuart.h"
+#include "em_cmu.h"
+#include "em_gpio.h"
+#include "em_core.h"
+#include "em_assert.h"
+
+/* The developer's include statements */
+#include "brd_config.h"
+#include "sleep_routines.h"
+#include "scheduler.h"
+#include "metrics.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define LEUART_EM_BLOCK     EM3       // LEUART runs from the LFXO down to EM2
+#define LEUART_RX_BUF_SIZE  64        // power of two
+#define LEUART_SESSION_MS   30000     // a session without traffic for this long ends and EM3 is allowed again
+
+// The start bit of the first byte on the RX pin wakes the board from EM3, the LEUART itself is stopped there
+#if LEUART_RX_PIN & 1
+#define LEUART_WAKE_IRQn    GPIO_ODD_IRQn
+#else
+#define LEUART_WAKE_IRQn    GPIO_EVEN_IRQn
+#endif
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef struct {
+  uint32_t              baudrate;
+  LEUART_Databits_TypeDef databits;
+  LEUART_Parity_TypeDef parity;
+  LEUART_Stopbits_TypeDef stopbits;
+  LEUART_Enable_TypeDef enable;
+  uint32_t              tx_route;     // tx and rx routes
+  uint32_t              rx_route;
+  bool                  tx_en;        // enable tx route
+  bool                  rx_en;        // enable rx route
+  uint32_t              rx_cb;        // scheduled when bytes are received
+  uint32_t              tx_cb;        // scheduled when a transmission completes
+} LEUART_OPEN_STRUCT;
+
+typedef struct {
+  LEUART_TypeDef        *leuart;
+  bool                  available;    // no transmission in progress
+  const uint8_t         *tx_data;
+  uint32_t              tx_remaining;
+  uint32_t              tx_cb;
+  uint32_t              rx_cb;
+  uint8_t               rx_buf[LEUART_RX_BUF_SIZE];
+  uint32_t              rx_head;      // written by the interrupt
+  uint32_t              rx_tail;      // read by leuart_read()
+  bool                  session;      // woken by the host, EM3 is blocked so bytes can be received
+  bool                  activity;     // a byte was received or sent since the last leuart_session_poll()
+  uint32_t              active_ms;    // time of the last activity seen by leuart_session_poll()
+} LEUART_STATE_MACHINE;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void leuart_open(LEUART_TypeDef *leuart, LEUART_OPEN_STRUCT *leuart_setup);
+void leuart_start(LEUART_TypeDef *leuart, const uint8_t *data, uint32_t length);
+bool leuart_tx_available(LEUART_TypeDef *leuart);
+bool leuart_read(LEUART_TypeDef *leuart, uint8_t *byte);
+void leuart_session_poll(LEUART_TypeDef *leuart, uint32_t now_ms);
+void LEUART0_IRQHandler(void);
+#if LEUART_RX_PIN & 1
+void GPIO_ODD_IRQHandler(void);
+#else
+void GPIO_EVEN_IRQHandler(void);
+#endif
+
+#endif
@@ -0,0 +1,47 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef LOG_CODE_HG
+#define LOG_CODE_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+#include "em_device.h"
+
+/* The developer's include statements */
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+/* A log code is a 16 bit log2 of the calibrated reading, the reading divided by its gain:
+ *
+ *   code = round((log2(raw) - gain_shift + LOG_CODE_BIAS) * 2^LOG_CODE_FRAC_BITS)
+ *   reading = 2^(code / 2^LOG_CODE_FRAC_BITS - LOG_CODE_BIAS)
+ *
+ * gain_shift is the ADCSENS HW_GAIN plus SW_GAIN of the measurement. A 16 bit raw count at any gain covers
+ * 34 octaves, codes 1024 to 35840. Steps are 2^(1/1024), a relative error of at most 0.04% after a round trip.
+ * Code 0 is a zero reading. Codes of a steady light differ by small amounts, so they delta encode well. */
+#define LOG_CODE_FRAC_BITS  10
+#define LOG_CODE_BIAS       19      // keeps the smallest reading at the largest gain above code 0
+#define LOG_CODE_ZERO       0
+#define LOG_CODE_MAX_GAIN   18      // HW_GAIN 11 plus SW_GAIN 7
+#define LOG_CODE_TABLE_BITS 6       // interpolation tables of 2^6 + 1 entries
+
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+uint16_t log_code_encode(uint32_t raw, uint32_t gain_shift);
+uint32_t log_code_decode(uint16_t code, uint32_t q);
+
+#endif
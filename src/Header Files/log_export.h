@@ -0,0 +1,124 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef LOG_EXPORT_HG
+#define LOG_EXPORT_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+
+/* The developer's include statements */
+#include "leuart.h"
+#include "sample_log.h"
+#include "metrics.h"
+#include "profile.h"
+#include "pla.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+/* Frame: SOF, type, payload length, payload, CRC-16/CCITT (little endian) over type, length and payload.
+ *
+ * Host to device:
+ *   EXPORT_CMD_INFO    no payload                    -> EXPORT_RSP_INFO
+ *   EXPORT_CMD_START   from_seq u32, credits u8      start or resume streaming at from_seq
+ *   EXPORT_CMD_CREDIT  credits u8                    allow credits more blocks
+ *   EXPORT_CMD_STOP    no payload                    stop streaming
+ *   EXPORT_CMD_PROFILE id u8                         switch operating profile at the next sample -> EXPORT_RSP_PROFILE
+ *   EXPORT_CMD_START_PLA from_seq u32, credits u8, error u8
+ *                                                    as START, but sends SEGMENTS with every code within error
+ *   EXPORT_CMD_METRICS offset u32                    -> EXPORT_RSP_METRICS
+ *   EXPORT_CMD_METRIC_DESC index u16                 -> EXPORT_RSP_METRIC_DESC
+ *
+ * Device to host:
+ *   EXPORT_RSP_INFO    oldest_seq u32, next_seq u32
+ *   EXPORT_RSP_BLOCK   first_seq u32, count u8, timestamp u32, code u16, then count - 1 pairs of zigzag varints:
+ *                      timestamp delta-of-delta and code delta. A code is the log code of the calibrated reading,
+ *                      reading = 2^(code / 1024 - 19) and code 0 is a zero reading, see log_code.h
+ *   EXPORT_RSP_END     next_seq u32, the host is up to date
+ *   EXPORT_RSP_PROFILE id u8, accepted u8, the profile_* metrics show when the switch was made
+ *   EXPORT_RSP_SEGMENTS seq u32, count u8, timestamp u32, code u32, starts u8, then count - 1 knots of three
+ *                      varints: seq delta << 1 | starts, zigzag timestamp delta and zigzag code delta
+ *   EXPORT_RSP_METRICS offset u32, then up to EXPORT_METRICS_CHUNK bytes of the metrics dump from offset: a
+ *                      METRICS_HEADER followed by the metrics block, no bytes past its end, see metrics.h
+ *   EXPORT_RSP_METRIC_DESC index u16, type u8, words u8, value address u32, name. Only the index is sent for an
+ *                      index past the desc_count of the METRICS_HEADER
+ *
+ * SEGMENTS carry the knots of a piecewise linear approximation of the samples, see pla.h. Codes are in 1/16
+ * code steps. The samples between two knots are the line between them, by sequence number, each one within
+ * error code steps (plus one 1/16 step of rounding) of its code and EXPORT_PLA_TIME_ERROR of its timestamp.
+ * A knot with starts set begins a new series and is not connected to the knot before it, samples between them
+ * were overwritten. The last sample sent before END is always a knot.
+ *
+ * A host keeps the sequence number after the last block it received. After an interrupted transfer it sends
+ * START with that number, so only samples it does not have are sent. If first_seq of the first block is above
+ * from_seq, the missing samples were overwritten before they could be exported.
+ *
+ * A host reads the metrics with METRICS from offset 0 until it has the header and its length bytes, and
+ * METRIC_DESC for each descriptor, which only change with the firmware image. tools/metrics_decode.c turns
+ * the responses into names and values. The stream is not interrupted, both can be sent while it runs.
+ *
+ * An idle link lets the board sleep in EM3, where the LEUART is stopped. A host starts a session with a wake
+ * byte (any byte other than EXPORT_SOF), waits for the LFXO to restart and then sends its frames. The session
+ * ends after LEUART_SESSION_MS without traffic, so a host that pauses longer than that wakes the board again. */
+#define EXPORT_SOF              0xA5
+#define EXPORT_CMD_INFO         0x01
+#define EXPORT_CMD_START        0x02
+#define EXPORT_CMD_CREDIT       0x03
+#define EXPORT_CMD_STOP         0x04
+#define EXPORT_CMD_PROFILE      0x05
+#define EXPORT_CMD_START_PLA    0x06
+#define EXPORT_CMD_METRICS      0x07
+#define EXPORT_CMD_METRIC_DESC  0x08
+#define EXPORT_RSP_INFO         0x81
+#define EXPORT_RSP_BLOCK        0x82
+#define EXPORT_RSP_END          0x83
+#define EXPORT_RSP_PROFILE      0x84
+#define EXPORT_RSP_SEGMENTS     0x85
+#define EXPORT_RSP_METRICS      0x86
+#define EXPORT_RSP_METRIC_DESC  0x87
+#define EXPORT_MAX_PAYLOAD      255
+#define EXPORT_BLOCK_HEADER     11
+#define EXPORT_MAX_SAMPLE_BYTES 8       // a 5-byte timestamp varint and a 3-byte code varint
+#define EXPORT_SEGMENT_HEADER   14
+#define EXPORT_MAX_KNOT_BYTES   15      // three 5-byte varints
+#define EXPORT_PLA_TIME_ERROR   1       // timestamp error of a segment, ms or sync edge ticks
+#define EXPORT_METRICS_CHUNK    248     // metrics dump bytes per METRICS response, whole words
+#define EXPORT_RX_MAX_PAYLOAD   8
+#define EXPORT_FRAME_OVERHEAD   5       // SOF, type, length, CRC
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef enum {
+  export_wait_sof,
+  export_wait_type,
+  export_wait_length,
+  export_wait_payload,
+  export_wait_crc_low,
+  export_wait_crc_high
+} EXPORT_RX_STATE;
+
+// End point of a segment as sent in SEGMENTS
+typedef struct {
+  uint32_t    seq;
+  uint32_t    timestamp;
+  int32_t     code;         // log code in 1/16 steps
+  bool        starts;       // first knot of a series
+} EXPORT_KNOT;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void log_export_open(LEUART_TypeDef *leuart);
+void log_export_rx(void);
+void log_export_tx_done(void);
+uint16_t log_export_crc16(uint16_t crc, const uint8_t *data, uint32_t length);
+
+#endif
@@ -20,6 +20,8 @@
 #include "app.h"
 #include "brd_config.h"
 #include "scheduler.h"
+#include "idle_work.h"
+#include "letimer.h"
 
 //***********************************************************************************
 // defined files
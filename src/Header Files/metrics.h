@@ -0,0 +1,93 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef METRICS_HG
+#define METRICS_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_device.h"
+#include "em_assert.h"
+
+/* The developer's include statements */
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define METRICS_MAGIC         0x5352544D    // "MTRS" little endian
+#define METRICS_VERSION       1
+#define METRIC_HIST_BUCKETS   16            // log2 buckets: 0, 1, 2-3, 4-7, ... , >= 2^14
+
+#define METRIC_DATA_SECTION   __attribute__((section(".bss.metrics"), used, aligned(4)))
+#define METRIC_DESC_SECTION   __attribute__((section(".metrics_desc"), used, aligned(4)))
+
+/* Declares a metric at file scope in the module that owns it. The value is placed in the contiguous metrics
+ * block in RAM and its descriptor in flash, so no registration code runs and the dump is one block copy. */
+#define METRIC_DECLARE(metric, metric_type, metric_words) \
+  static uint32_t metric_##metric[metric_words] METRIC_DATA_SECTION; \
+  static const METRIC_DESC metric_desc_##metric METRIC_DESC_SECTION = { #metric, metric_type, metric_words, metric_##metric }
+
+#define METRIC_COUNTER(metric)          METRIC_DECLARE(metric, metric_counter, 1)
+#define METRIC_GAUGE(metric)            METRIC_DECLARE(metric, metric_gauge, 1)
+#define METRIC_HISTOGRAM(metric)        METRIC_DECLARE(metric, metric_histogram, METRIC_HIST_BUCKETS)
+
+/* Updates compile to a load/modify/store on a fixed address, there is no lookup */
+#define METRIC_INC(metric)              (metric_##metric[0]++)
+#define METRIC_ADD(metric, n)           (metric_##metric[0] += (n))
+#define METRIC_SET(metric, v)           (metric_##metric[0] = (v))
+#define METRIC_MAX(metric, v)           do { if((uint32_t)(v) > metric_##metric[0]) metric_##metric[0] = (v); } while(0)
+#define METRIC_HIST(metric, v)          (metric_##metric[metric_hist_bucket(v)]++)
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef enum {
+  metric_counter,
+  metric_gauge,
+  metric_histogram
+} METRIC_TYPE;
+
+typedef struct {
+  const char    *name;
+  uint32_t      type;     // METRIC_TYPE
+  uint32_t      words;    // number of 32-bit values
+  uint32_t      *value;   // location of the values inside the metrics block
+} METRIC_DESC;
+
+// Header sent in front of the metrics block. The host maps each descriptor's value address onto the block
+// with data_addr, using the descriptors read with metrics_desc().
+typedef struct {
+  uint32_t      magic;
+  uint16_t      version;
+  uint16_t      desc_count;
+  uint32_t      data_addr;
+  uint32_t      length;   // bytes of metric values following the header
+} METRICS_HEADER;
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void metrics_open(void);
+uint32_t metrics_read(uint32_t offset, uint8_t *dst, uint32_t length);
+const METRIC_DESC *metrics_desc(uint32_t index);
+uint32_t metrics_size(void);
+
+/***************************************************************************//**
+ * @brief
+ * Returns the log2 histogram bucket of a value.
+ *
+ * @details
+ * Bucket 0 holds 0, bucket n holds values in [2^(n-1), 2^n), the last bucket holds everything above.
+ * The bucket is found with a single CLZ instruction.
+ *
+ ******************************************************************************/
+static inline uint32_t metric_hist_bucket(uint32_t v){
+  uint32_t bucket = 32 - __CLZ(v);
+  return (bucket < METRIC_HIST_BUCKETS) ? bucket : METRIC_HIST_BUCKETS - 1;
+}
+
+#endif
@@ -0,0 +1,74 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef PIPELINE_HG
+#define PIPELINE_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+
+/* The developer's include statements */
+#include "scheduler.h"
+#include "metrics.h"
+#include "timing.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define PIPE_POOL_SIZE      16      // sample slots, power of two
+#define PIPE_RING_SIZE      PIPE_POOL_SIZE  // a ring can hold every slot, so a push never fails
+#define PIPE_MAX_STAGES     4
+#define PIPE_BATCH          4       // samples a stage handles per scheduled call
+#define PIPE_NO_SLOT        0xFF
+#define PIPE_NOT_LOGGED     0xFFFFFFFF  // seq of a sample the log stage did not store
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+// A sample is written once by the source into a pool slot. Stages only pass the slot along and each stage
+// fills in only its own result field.
+typedef struct {
+  uint32_t    timestamp;
+  uint32_t    raw;          // source
+  uint16_t    code;         // source, log code of the calibrated reading
+  uint32_t    profile;      // source, operating profile the sample was taken with
+  uint32_t    dark;         // classify stage
+  uint32_t    filtered;     // filter stage
+  uint32_t    seq;          // log stage
+} PIPE_SAMPLE;
+
+// Processes a batch of samples in place
+typedef void (*PIPE_STAGE_FUNC)(PIPE_SAMPLE *const batch[], uint32_t count);
+
+// Single producer single consumer ring of pool slot indices. The producer only writes head and the consumer
+// only writes tail, so no locking is needed.
+typedef struct {
+  volatile uint32_t   head;
+  volatile uint32_t   tail;
+  uint8_t             slot[PIPE_RING_SIZE];
+} PIPE_RING;
+
+typedef struct {
+  const char          *name;
+  PIPE_STAGE_FUNC     func;
+  uint32_t            event;      // scheduler event that runs this stage
+  uint32_t            priority;   // 0 runs first when several stages have work
+  PIPE_RING           in;
+} PIPE_STAGE;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void pipeline_open(void);
+uint32_t pipeline_add_stage(const char *name, PIPE_STAGE_FUNC func, uint32_t event, uint32_t priority);
+PIPE_SAMPLE *pipeline_alloc(void);
+void pipeline_submit(PIPE_SAMPLE *sample);
+void pipeline_service(void);
+
+#endif
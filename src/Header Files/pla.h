@@ -0,0 +1,52 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef PLA_HG
+#define PLA_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+
+/* The developer's include statements */
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define PLA_FRAC_BITS     4         // knots are placed to 1/16 of an input unit
+#define PLA_MAX_SPAN      0xFFFF    // points a segment can span, keeps the door arithmetic in 64 bits
+
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+// Swinging door over a series of (x, value) points with increasing x. The doors are the steepest and the
+// flattest slope from the anchor that keep every point since the anchor within error of the line, a point that
+// would close them ends the segment. Values are held in PLA_FRAC_BITS fixed point.
+typedef struct {
+  int64_t     anchor;       // knot the segment starts at
+  uint32_t    anchor_x;
+  int64_t     error;        // largest distance of a point from its segment
+  int64_t     upper;        // upper door, slope upper / upper_dx
+  uint32_t    upper_dx;
+  int64_t     lower;        // lower door, slope lower / lower_dx
+  uint32_t    lower_dx;
+  uint32_t    last_x;       // x of the last point added
+  uint32_t    points;       // points added since the anchor
+} PLA_DOOR;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void pla_start(PLA_DOOR *door, uint32_t error, uint32_t x, int64_t value);
+bool pla_fits(const PLA_DOOR *door, uint32_t x, int64_t value);
+void pla_add(PLA_DOOR *door, uint32_t x, int64_t value);
+bool pla_pending(const PLA_DOOR *door);
+int64_t pla_close(PLA_DOOR *door);
+
+#endif
@@ -0,0 +1,57 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef PROFILE_HG
+#define PROFILE_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+#include "em_cmu.h"
+
+/* The developer's include statements */
+#include "i2c.h"
+#include "metrics.h"
+#include "timing.h"
+#include "retain.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define PROFILE_NONE      0xFFFFFFFF    // no switch requested
+
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+// One operating point of the application, every setting a switch can change
+typedef struct {
+  const char              *name;
+  float                   period;         // sample period in seconds
+  uint8_t                 white_adcsens;  // ADCSENS of the white light channel, HW_GAIN and SW_GAIN
+  uint8_t                 channels;       // Si1133 channels measured, white light is always included
+  CMU_HFRCOFreq_TypeDef   hf_band;        // HFRCO band, clocks the core, I2C and HFPER
+  I2C_EXEC_MODE           i2c_exec;       // i2c execution policy
+  uint8_t                 log_every;      // every log_every-th sample is logged, 0 logs none
+  bool                    telemetry;      // light level metrics are published
+  bool                    leds;           // LEDs show the light level
+} PROFILE;
+
+// Moves the hardware from one profile to another, from is 0 when the first profile is applied
+typedef void (*PROFILE_APPLY)(const PROFILE *from, const PROFILE *to);
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void profile_open(const PROFILE *table, uint32_t count, uint32_t initial, PROFILE_APPLY apply);
+bool profile_request(uint32_t id);
+void profile_boundary(uint32_t now_ms);
+uint32_t profile_current(void);
+const PROFILE *profile_get(uint32_t id);
+
+#endif
@@ -0,0 +1,58 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef RETAIN_HG
+#define RETAIN_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+#include "em_cmu.h"
+#include "em_gpcrc.h"
+#include "em_rmu.h"
+
+/* The developer's include statements */
+#include "metrics.h"
+#include "timing.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define RETAIN_NOINIT       __attribute__((section(".noinit")))   // not cleared by the startup code
+#define RETAIN_REGIONS      16      // state regions registered with retain_add()
+#define RETAIN_WORDS        32      // payload of one slot
+#define RETAIN_MAGIC        0x5254414E
+
+// Resets that keep RAM and sensor power. Power on, brown out and EM4 wake up always start cold.
+#define RETAIN_WARM_CAUSES  (RMU_RSTCAUSE_WDOGRST | RMU_RSTCAUSE_SYSREQRST | RMU_RSTCAUSE_LOCKUPRST | RMU_RSTCAUSE_EXTRST)
+#define RETAIN_COLD_CAUSES  (RMU_RSTCAUSE_PORST | RMU_RSTCAUSE_AVDDBOD | RMU_RSTCAUSE_DVDDBOD | RMU_RSTCAUSE_DECBOD | RMU_RSTCAUSE_EM4RST)
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef struct {
+  uint32_t    magic;
+  uint32_t    build;              // image the state was sealed by, state of another build is not restored
+  uint32_t    generation;         // seal count, the newer of two valid slots is restored
+  uint32_t    bytes;              // payload in use, regions in registration order
+  uint32_t    data[RETAIN_WORDS];
+  uint32_t    crc;                // CRC-32 of the header and the payload in use
+} RETAIN_SLOT;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void retain_open(void);
+void retain_add(void *data, uint32_t bytes);
+void retain_seal(void);
+bool retain_resumed(void);
+uint32_t retain_crc32(const uint32_t *words, uint32_t count);
+
+#endif
@@ -0,0 +1,45 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef SAMPLE_LOG_HG
+#define SAMPLE_LOG_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+
+/* The developer's include statements */
+#include "metrics.h"
+#include "retain.h"
+#include "seqlock.h"
+#include "log_code.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define SAMPLE_LOG_SIZE     1024    // records kept, power of two
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef struct {
+  uint32_t    seq;          // sequence number, increments by one per sample and never repeats
+  uint32_t    timestamp;    // ms since start, or sync edge ticks in SYNC_INPUT_MODE
+  uint16_t    code;         // log code of the calibrated si1133 result
+} SAMPLE_RECORD;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void sample_log_open(void);
+uint32_t sample_log_append(uint32_t timestamp, uint16_t code);
+bool sample_log_get(uint32_t seq, SAMPLE_RECORD *record);
+uint32_t sample_log_oldest(void);
+uint32_t sample_log_next(void);
+
+#endif
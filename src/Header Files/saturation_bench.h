@@ -0,0 +1,70 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef SATURATION_BENCH_HG
+#define SATURATION_BENCH_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+
+/* The developer's include statements */
+#include "metrics.h"
+#include "timing.h"
+#include "sleep_routines.h"
+#include "letimer.h"
+#include "scheduler.h"
+#include "i2c.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define BENCH_SAMPLES_PER_STEP    20      // samples taken at each rate before the indicators are checked
+#define BENCH_STEP_PERCENT        80      // each step runs at this percentage of the previous period
+#define BENCH_MIN_PERIOD_MS       3       // smallest period with COMP1 still ahead of the underflow at 1 kHz
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef enum {
+  bench_stage_comp1_cb,     // FORCE issue callback
+  bench_stage_uf_cb,        // HOSTOUT read issue callback
+  bench_stage_read_cb,      // result callback
+  bench_stage_i2c_bus,      // I2C START to MSTOP
+  bench_stage_conversion,   // sensor conversion window, COMP1 to underflow
+  BENCH_STAGE_COUNT
+} BENCH_STAGE;
+
+typedef enum {
+  bench_limit_none,             // still running
+  bench_limit_coalesce,         // an event was posted again before its callback ran
+  bench_limit_i2c_queue,        // a transaction had to wait for the previous one
+  bench_limit_deadline,         // a sample started before the previous one completed
+  bench_limit_timer_resolution  // reached BENCH_MIN_PERIOD_MS without saturating
+} BENCH_LIMIT;
+
+typedef struct {
+  bool        done;
+  uint32_t    steps;
+  uint32_t    period_ms;                          // period being measured
+  uint32_t    knee_period_ms;                     // shortest period that ran clean
+  BENCH_LIMIT limit;
+  uint32_t    util_permille[BENCH_STAGE_COUNT];   // utilization at the knee
+} BENCH_RESULT;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void saturation_bench_open(uint32_t period_ms, uint32_t active_ms);
+void saturation_bench_sample_start(void);
+void saturation_bench_sample_done(void);
+void saturation_bench_stage(BENCH_STAGE stage, uint32_t cycles);
+bool saturation_bench_step(uint32_t *next_period_ms);
+const BENCH_RESULT *saturation_bench_result(void);
+
+#endif
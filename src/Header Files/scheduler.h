@@ -6,34 +6,51 @@
 
 /* System include statements */
 #include <stdint.h>
+#include <stdbool.h>
 
 /* Silicon Labs include statements */
 #include "em_assert.h"
 #include "em_core.h"
 #include "em_emu.h"
+#include "em_device.h"
 
 /* The developer's include statements */
 //#include "sleep_routines.h"
+#include "metrics.h"
 
 
 
 //***********************************************************************************
 // defined files
 //***********************************************************************************
+/* An event is an id from 1 to SCHED_MAX_EVENTS - 1, allocated at compile time by the application's event enum.
+ * Pending events are bits of leaf words, and a summary word has a bit for every leaf word that is not empty.
+ * Bits are stored from the most significant end, so two count leading zeros find the lowest pending id, which
+ * is handled first. Posting, removing and finding an event take the same time at any number of events. */
+#define SCHED_NO_EVENT      0       // no callback, posting it does nothing
+#define SCHED_LEAF_BITS     32
+#define SCHED_LEAF_WORDS    32      // one summary bit per leaf word
+#define SCHED_MAX_EVENTS    (SCHED_LEAF_WORDS * SCHED_LEAF_BITS)
 
 
 //***********************************************************************************
 // global variables
 //***********************************************************************************
+// Handles a scheduled event and removes it, it may post the event again if work remains
+typedef void (*SCHED_HANDLER)(void);
 
 
 //***********************************************************************************
 // function prototypes
 //***********************************************************************************
-void scheduler_open(void);
+void scheduler_open(const SCHED_HANDLER *handlers, uint32_t count);
 void add_scheduled_event(uint32_t event);
 void remove_scheduled_event(uint32_t event);
-uint32_t get_scheduled_events(void);
+bool is_scheduled_event(uint32_t event);
+bool any_scheduled_event(void);
+uint32_t next_scheduled_event(void);
+void scheduler_dispatch(void);
+uint32_t scheduler_coalesced(void);
 
 
 #endif
@@ -0,0 +1,46 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef SEQLOCK_HG
+#define SEQLOCK_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_assert.h"
+#include "em_device.h"
+
+/* The developer's include statements */
+#include "metrics.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define SEQLOCK_READ_TRIES    8       // copies seqlock_read() makes before it gives up
+
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+// Guards data with one writer and any number of readers. The writer never waits, a reader copies the data and
+// copies it again if a write overlapped the copy. Readers run at the writer's priority or below it, a reader
+// that interrupted a write in progress can not see it complete and gives up instead.
+typedef struct {
+  volatile uint32_t   sequence;     // odd while a write is in progress
+} SEQLOCK;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void seqlock_init(SEQLOCK *lock);
+void seqlock_write_begin(SEQLOCK *lock);
+void seqlock_write_end(SEQLOCK *lock);
+uint32_t seqlock_read_begin(const SEQLOCK *lock);
+bool seqlock_read_retry(const SEQLOCK *lock, uint32_t start);
+bool seqlock_read(const SEQLOCK *lock, void *copy, const volatile void *data, uint32_t bytes);
+
+#endif
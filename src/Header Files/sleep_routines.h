@@ -13,6 +13,10 @@
 #include "em_core.h"
 #include "em_assert.h"
 
+/* The developer's include statements */
+#include "gpio.h"
+#include "metrics.h"
+
 
 //***********************************************************************************
 // global variables
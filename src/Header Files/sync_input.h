@@ -0,0 +1,62 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef SYNC_INPUT_HG
+#define SYNC_INPUT_HG
+
+/* System include statements */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Silicon Labs include statements */
+#include "em_cmu.h"
+#include "em_gpio.h"
+#include "em_prs.h"
+#include "em_timer.h"
+#include "em_assert.h"
+
+/* The developer's include statements */
+#include "brd_config.h"
+#include "scheduler.h"
+#include "sleep_routines.h"
+#include "SI1133.h"
+#include "seqlock.h"
+#include "cmu.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define SYNC_TIMER            TIMER1
+#define SYNC_TIMER_PRESCALE   timerPrescale16   // 26 MHz / 16 = 1.625 MHz timestamp clock
+#define SYNC_TIMER_DIV        16
+#define SYNC_TIMER_EM         EM2               // TIMER1 does not run in EM2, block it while sync mode is open
+#define SYNC_CAPTURE_CC       0                 // CC0 captures the sync edge from PRS
+#define SYNC_READ_CC          1                 // CC1 fires when the measurement is complete
+#define SYNC_IRQ_PRIORITY     0                 // above I2C so the FORCE start latency does not depend on other interrupts
+#define SYNC_OTHER_PRIORITY   1
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+typedef struct {
+  uint32_t    triggers;       // sync edges captured
+  uint32_t    missed;         // edges dropped because the I2C bus was still busy
+  uint32_t    latency_last;   // sync edge to the FORCE write issued to the I2C peripheral, timer ticks
+  uint32_t    latency_min;
+  uint32_t    latency_max;
+  uint32_t    jitter;         // latency_max - latency_min, timer ticks
+} SYNC_INPUT_STATS;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void sync_input_open(uint32_t conversion_us, uint32_t read_cb);
+void sync_input_conversion_set(uint32_t conversion_us);
+uint32_t sync_input_timestamp(void);
+bool sync_input_stats(SYNC_INPUT_STATS *stats);
+uint32_t sync_input_ticks_to_us(uint32_t ticks);
+void TIMER1_IRQHandler(void);
+
+#endif
@@ -0,0 +1,36 @@
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#ifndef TIMING_HG
+#define TIMING_HG
+
+/* System include statements */
+#include <stdint.h>
+
+/* Silicon Labs include statements */
+#include "em_device.h"
+#include "em_cmu.h"
+#include "em_assert.h"
+
+/* The developer's include statements */
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void timing_open(void);
+uint32_t timing_cycles(void);
+uint32_t timing_cycles_since(uint32_t start);
+uint32_t timing_cycles_to_us(uint32_t cycles);
+
+#endif
@@ -34,7 +34,7 @@
 void timer_delay(uint32_t ms_delay){
 	uint32_t timer_clk_freq = CMU_ClockFreqGet(cmuClock_HFPER);
 	uint32_t delay_count = ms_delay *(timer_clk_freq/1000) / 1024;
-	CMU_ClockEnable(cmuClock_TIMER0, true);
+	cmu_clock_acquire(cmuClock_TIMER0);
 	TIMER_Init_TypeDef delay_counter_init = TIMER_INIT_DEFAULT;
 		delay_counter_init.oneShot = true;
 		delay_counter_init.enable = false;
@@ -46,6 +46,6 @@ void timer_delay(uint32_t ms_delay){
 	TIMER_Enable(TIMER0, true);
 	while (TIMER0->CNT != 00);
 	TIMER_Enable(TIMER0, false);
-	CMU_ClockEnable(cmuClock_TIMER0, false);
+	cmu_clock_release(cmuClock_TIMER0);
 }
 
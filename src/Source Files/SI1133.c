@@ -18,24 +18,69 @@
 //***********************************************************************************
 // Private variables
 //***********************************************************************************
-static uint32_t si1133_read_data;
+static uint32_t si1133_read_data[SI1133_READ_WORDS];
+static uint32_t si1133_read_bytes;     // length of the last read, locates its bytes in si1133_read_data
 static uint32_t si1133_write_data;
+static uint32_t si1133_force_data = FORCE;     // FORCE from an interrupt, never shared with a main loop write
+
+// Channels written by si1133_configure(), UV and IR change much slower than white light
+static const SI1133_CHANNEL_CONFIG si1133_channels[] = {
+  { WHITE_LIGHT, 0, 1 },                              // channel 0, decimation 0
+  { LARGE_IR | DECIM_2048, 0, SI1133_IR_PERIOD },
+  { UV | DECIM_4096, 0, SI1133_UV_PERIOD }
+};
+#define SI1133_CONFIGURED   (sizeof(si1133_channels) / sizeof(si1133_channels[0]))
+
+static uint8_t si1133_configured;              // every configured channel, IRQ_ENABLE
+static uint8_t si1133_chan_list;               // CHAN_LIST as last written, the channels the next FORCE measures
+static uint8_t si1133_active;                  // channels measured by the last FORCE
+static uint16_t si1133_countdown[SI1133_CHANNELS];  // FORCEs until each channel is due again
+static uint8_t si1133_enabled;                 // configured channels the operating profile measures
+static uint8_t si1133_adcsens[SI1133_CHANNELS];     // ADCSENSn as last written
+static I2C_EXEC_MODE si1133_exec;              // i2c execution policy of the operating profile
+METRIC_COUNTER(si1133_chan_list_writes);       // CHAN_LIST rewritten because the due set changed
+METRIC_GAUGE(si1133_force_us);                 // modelled conversion time of the last FORCE
+METRIC_DECLARE(si1133_channel_value, metric_gauge, SI1133_CHANNELS);
+METRIC_DECLARE(si1133_channels_measured, metric_counter, SI1133_CHANNELS);
+
+static uint32_t si1133_light_cb;      // callback of the result read, kept for retries
+static uint32_t si1133_read_retries;  // retries made for the current result
+static uint8_t si1133_status_seen;    // channels reported complete by any read of the current result
+METRIC_COUNTER(si1133_stale_reads);   // result read before IRQ_STATUS showed every channel complete
+METRIC_COUNTER(si1133_stale_dropped); // samples dropped after SI1133_READ_RETRIES stale reads
+METRIC_COUNTER(si1133_retried_fresh); // samples that were fresh on a retry
+
+static bool si1133_blocking;          // configuration waits for each transaction, tells the i2c cost model
+static uint32_t si1133_cmd_expected;  // RESPONSE0 command counter once every parameter write has completed
+METRIC_GAUGE(si1133_config_transactions);
+METRIC_GAUGE(si1133_config_bus_cycles);   // START to STOP time of the configuration transactions
+METRIC_GAUGE(si1133_config_cycles);       // total configuration time, including the waits between transactions
+METRIC_COUNTER(si1133_config_retries);    // deferred check failed and the parameters were written again
+METRIC_GAUGE(si1133_config_kept);         // a warm reset found the sensor still configured
 
 //***********************************************************************************
 // Private functions
 //***********************************************************************************
+static uint32_t si1133_reset_cmd_ctr();
+static void si1133_param_set(uint32_t param, uint32_t value, bool verify);
+static bool si1133_param_verify();
+static uint32_t si1133_read_byte(uint32_t byte);
+static uint32_t si1133_channels_us(uint32_t chan_list);
+static void si1133_schedule_channels(void);
+static void si1133_i2c_setup(I2C_OPEN_STRUCT *setup);
+static bool si1133_wait(uint32_t start);
+static uint32_t si1133_query_chan_list(void);
+
 /***************************************************************************//**
  * @brief
- * This function configures si1133 for white light ADC operation
+ * Resets the command counter and returns its value.
  *
  * @details
- * This function sends the proper parameter info and commands to setup the si1133 operation for white light ADC reading mode
- *
- * @note
- * This function will be called in the si1133 open func, in order to configure the si1133 operation
+ * RESPONSE0[3:0] counts completed commands from here, so the parameter writes that follow can be checked
+ * against it.
  *
  ******************************************************************************/
-static void si1133_configure(){
+static uint32_t si1133_reset_cmd_ctr(){
   si1133_write_data = RESET_CMD_CNT;
   si1133_write(1,COMMAND,NULL_CB); //write our input data to INPUT0
 
@@ -43,42 +88,287 @@ static void si1133_configure(){
 
   si1133_read(1, RESPONSE0, NULL_CB); //expect 1 byte, response0 register, no callback
   while(!i2c_available(I2C1)); //wait until end of i2c read
-  uint32_t cmd_ctr = si1133_read_data & 0x0f; //grab lower 4bits
-
-  si1133_write_data = WHITE_LIGHT;
-  si1133_write(1,INPUT0,NULL_CB); //write our input data to INPUT0
+  return si1133_read_data[0] & CMD_CTR_MASK; //grab lower 4bits
+}
 
+/***************************************************************************//**
+ * @brief
+ * Writes one parameter with a single I2C transaction.
+ *
+ * @details
+ * INPUT0 and COMMAND are adjacent registers, so a two byte write starting at INPUT0 loads the value and then
+ * issues the PARAM_SET command. The i2c driver sends the most significant byte first.
+ *
+ * @note
+ * With verify set RESPONSE0 is read back after the command, one more transaction. Otherwise the caller
+ * checks every parameter at once with si1133_param_verify().
+ *
+ * @param[in] param
+ * Parameter table address
+ *
+ * @param[in] value
+ * Parameter value
+ *
+ * @param[in] verify
+ * Read RESPONSE0 back and assert the command completed
+ *
+ ******************************************************************************/
+static void si1133_param_set(uint32_t param, uint32_t value, bool verify){
+  si1133_write_data = (value << 8) | COMMAND_BITS | param;
+  si1133_write(2,INPUT0,NULL_CB); //INPUT0 = value, COMMAND = PARAM_SET | param
   while(!i2c_available(I2C1)); //wait until end of i2c write
 
-  si1133_write_data = COMMAND_BITS | ADCCONFIG0;
-  si1133_write(1,COMMAND,NULL_CB); //write the input0 data to adcconfig0 adcmux bits
-
-  while(!i2c_available(I2C1)); //wait until end of i2c write
+  si1133_cmd_expected = (si1133_cmd_expected + 1) & CMD_CTR_MASK;
+  if(verify){
+      bool completed = si1133_param_verify();
+      EFM_ASSERT(completed); //command write failed
+  }
+}
 
-  // Verifies write command occurred
+/***************************************************************************//**
+ * @brief
+ * Checks that every parameter write since the counter reset completed.
+ *
+ * @details
+ * One RESPONSE0 read covers any number of writes, up to the 16 the counter can count.
+ *
+ * @return
+ * False if a command was lost or the sensor reported a command error
+ *
+ ******************************************************************************/
+static bool si1133_param_verify(){
   si1133_read(1, RESPONSE0, NULL_CB); //expect 1 byte, response0 register, no callback
   while(!i2c_available(I2C1)); //wait until end of i2c read
-  if((si1133_read_data & 0x0F) != cmd_ctr+1){
-     EFM_ASSERT(false); //command write failed
+  return !(si1133_read_data[0] & CMD_ERR) && (si1133_read_data[0] & CMD_CTR_MASK) == si1133_cmd_expected;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns one byte of the last read, in the order the si1133 sent it.
+ *
+ * @details
+ * The i2c driver stores the first byte received in the most significant position, so byte 0 of an n byte
+ * read is at position n - 1, counting bytes from the least significant end of si1133_read_data[0].
+ *
+ * @param[in] byte
+ * Index of the byte from the start register of the read
+ *
+ ******************************************************************************/
+static uint32_t si1133_read_byte(uint32_t byte){
+  uint32_t position = si1133_read_bytes - 1 - byte;
+
+  return (si1133_read_data[position / 4] >> (8 * (position % 4))) & 0xFF;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the time from FORCE to a complete result for a set of channels.
+ *
+ * @details
+ * Each channel takes one measurement time, scaled by its decimation rate and by 2^HW_GAIN, repeated
+ * 2^SW_GAIN times. The fixed start and per channel sequencing times are margins, the stale read counters
+ * show whether they are enough.
+ *
+ * @param[in] chan_list
+ * CHAN_LIST bits of the channels measured
+ *
+ ******************************************************************************/
+static uint32_t si1133_channels_us(uint32_t chan_list){
+  static const uint8_t decim_half_units[4] = { 2, 4, 8, 1 };   // 1024, 2048, 4096, 512 clocks
+  uint64_t total_ns = 0;
+
+  for(uint32_t channel = 0; channel < SI1133_CONFIGURED; channel++){
+      if(!(chan_list & (1 << channel))){
+          continue;
+      }
+      uint32_t hw_gain = si1133_adcsens[channel] & HW_GAIN_MASK;
+      uint32_t sw_gain = (si1133_adcsens[channel] >> SW_GAIN_SHIFT) & SW_GAIN_MASK;
+      uint32_t decim = (si1133_channels[channel].adcconfig >> DECIM_RATE_SHIFT) & 0x3;
+
+      total_ns += ((uint64_t)SI1133_MEAS_HALF_NS * decim_half_units[decim] << hw_gain << sw_gain) + SI1133_CHANNEL_US * 1000;
   }
+  return SI1133_START_US + (total_ns + 999) / 1000;
+}
 
-  si1133_write_data = CHANNEL0_PREP;
-  si1133_write(1,INPUT0,NULL_CB); //write our input data to INPUT0
+/***************************************************************************//**
+ * @brief
+ * Selects the channels the next FORCE measures.
+ *
+ * @details
+ * Every enabled channel counts down the FORCEs until it is due. CHAN_LIST is only rewritten when the due set differs
+ * from the last one written, one fused parameter write, so a FORCE measures and a result read returns only the
+ * channels that are due.
+ *
+ * @note
+ * This is called once the result of the last FORCE has been read or dropped, so the write is off the FORCE
+ * path and the sensor is idle.
+ *
+ ******************************************************************************/
+static void si1133_schedule_channels(void){
+  uint32_t due = 0;
+
+  for(uint32_t channel = 0; channel < SI1133_CONFIGURED; channel++){
+      if(!(si1133_enabled & (1 << channel))){
+          continue;
+      }
+      if(--si1133_countdown[channel] == 0){
+          si1133_countdown[channel] = si1133_channels[channel].period;
+          due |= 1 << channel;
+      }
+  }
 
-  while(!i2c_available(I2C1));
+  if(due != si1133_chan_list){
+      si1133_chan_list = due;
+      si1133_param_set(CHAN_LIST, due, false);
+      METRIC_INC(si1133_chan_list_writes);
+  }
+}
 
-  si1133_write_data = COMMAND_BITS | CHAN_LIST;
-  si1133_write(1,COMMAND,NULL_CB); //write the input0 data to chan_list
+/***************************************************************************//**
+ * @brief
+ * Waits for a transaction to a sensor that may not be powered.
+ *
+ * @details
+ * A polled transaction that is not acknowledged is abandoned by the i2c driver. An interrupt driven one
+ * waits forever for an ACK, so it is abandoned after SI1133_PROBE_US.
+ *
+ * @param[in] start
+ * timing_cycles() before the transaction was started
+ *
+ * @return
+ * False if the transaction had to be abandoned
+ *
+ ******************************************************************************/
+static bool si1133_wait(uint32_t start){
+  uint32_t timeout = (uint64_t)SI1133_PROBE_US * CMU_ClockFreqGet(cmuClock_CORE) / 1000000;
 
-  while(!i2c_available(I2C1));
+  while(!i2c_available(I2C1) && timing_cycles_since(start) < timeout);
+  if(!i2c_available(I2C1)){
+      i2c_abort(I2C1);
+      return false;
+  }
+  return true;
+}
 
- // Verifies write command occurred
-  si1133_read(1, RESPONSE0, NULL_CB); //expect 1 byte, response0 register, no callback
-  while(!i2c_available(I2C1)); //wait until end of i2c read
-  if((si1133_read_data & 0x0F) != cmd_ctr+2){
-     EFM_ASSERT(false); //command write failed
+/***************************************************************************//**
+ * @brief
+ * Reads CHAN_LIST back from the sensor.
+ *
+ * @details
+ * A PARAM_QUERY command puts the parameter in RESPONSE1. CHAN_LIST is 0 after the sensor resets and is never
+ * 0 once configured, so this tells if the sensor kept its configuration.
+ *
+ * @return
+ * CHAN_LIST, or SI1133_NO_RESPONSE if the sensor did not answer
+ *
+ ******************************************************************************/
+static uint32_t si1133_query_chan_list(void){
+  uint32_t start;
+  uint32_t chan_list = SI1133_NO_RESPONSE;
+
+  si1133_blocking = true;
+  si1133_read_data[0] = SI1133_NO_RESPONSE; //kept if a NACK abandons the read
+
+  start = timing_cycles();
+  si1133_write_data = PARAM_QUERY_BITS | CHAN_LIST;
+  si1133_write(1,COMMAND,NULL_CB);
+  if(si1133_wait(start)){
+      start = timing_cycles();
+      si1133_read(1, RESPONSE1, NULL_CB);
+      if(si1133_wait(start) && si1133_read_data[0] != SI1133_NO_RESPONSE){
+          chan_list = si1133_read_data[0] & 0xFF;
+      }
   }
 
+  si1133_blocking = false;
+  return chan_list;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Fills in the i2c settings of the si1133.
+ *
+ * @param[out] setup
+ * Settings passed to i2c_open()
+ *
+ ******************************************************************************/
+static void si1133_i2c_setup(I2C_OPEN_STRUCT *setup){
+  setup->clhr = i2cClockHLRAsymetric; //6:3 ratio
+  setup->enable = true;
+  setup->freq = I2C_FREQ_FAST_MAX ; //400 Khz (si113 max freq)
+  setup->master = true;
+  setup->out_scl_en = true;
+  setup->out_sda_en = true;
+  setup->refFreq = 0; //gecko in master mode
+  setup->scl_out_route0 = I2C_SCL_PC5;
+  setup->sda_out_route0 = I2C_SDA_PC4;
+  setup->ack_irq_enable = true;
+  setup->rxdatav_irq_enable = true;
+  setup->stop_irq_enable = true;
+  setup->exec_policy = si1133_exec;
+}
+
+/***************************************************************************//**
+ * @brief
+ * This function configures si1133 for white light ADC operation
+ *
+ * @details
+ * This function sends the proper parameter info and commands to setup the si1133 operation for white light ADC reading mode.
+ * Each parameter is one fused INPUT0/COMMAND write. With SI1133_CONFIG_VERIFY set to deferred, RESPONSE0 is only read
+ * once at the end; if that check fails the parameters are written again, checking each one.
+ *
+ * @note
+ * This function will be called in the si1133 open func, in order to configure the si1133 operation. The transactions,
+ * bus time and total time it takes are kept in the si1133_config_* metrics.
+ *
+ ******************************************************************************/
+static void si1133_configure(){
+  I2C_STATS i2c_start_stats, i2c_end_stats;
+  i2c_stats(&i2c_start_stats);
+  uint32_t start = timing_cycles();
+  bool verify_each = SI1133_CONFIG_VERIFY == si1133_verify_each;
+
+  EFM_ASSERT(SI1133_CONFIGURED <= SI1133_CHANNELS);
+  EFM_ASSERT(si1133_channels[0].period == 1); //the white light sample clock
+  si1133_blocking = true;
+
+  // The first FORCE measures every channel, then each one is due again after its period
+  si1133_configured = 0;
+  for(uint32_t channel = 0; channel < SI1133_CONFIGURED; channel++){
+      si1133_configured |= 1 << channel;
+      si1133_countdown[channel] = si1133_channels[channel].period;
+      si1133_adcsens[channel] = si1133_channels[channel].adcsens;
+  }
+  si1133_chan_list = si1133_configured;
+  si1133_enabled = si1133_configured;
+
+  do{
+      si1133_cmd_expected = si1133_reset_cmd_ctr();
+      for(uint32_t channel = 0; channel < SI1133_CONFIGURED; channel++){
+          si1133_param_set(ADCCONFIG0 + PARAM_CHANNEL_STRIDE * channel, si1133_channels[channel].adcconfig, verify_each);
+          if(si1133_channels[channel].adcsens){
+              si1133_param_set(ADCSENS0 + PARAM_CHANNEL_STRIDE * channel, si1133_channels[channel].adcsens, verify_each);
+          }
+      }
+      si1133_param_set(CHAN_LIST, si1133_chan_list, verify_each);
+      if(!verify_each && !si1133_param_verify()){
+          METRIC_INC(si1133_config_retries);
+          verify_each = true; //find the write that fails
+          continue;
+      }
+      break;
+  }while(true);
+
+  // Latch the completion of every channel in IRQ_STATUS so each result read can check it is fresh
+  si1133_write_data = si1133_configured;
+  si1133_write(1,IRQ_ENABLE,NULL_CB);
+  while(!i2c_available(I2C1));
+
+  i2c_stats(&i2c_end_stats);
+  METRIC_SET(si1133_config_transactions, i2c_end_stats.transactions - i2c_start_stats.transactions);
+  METRIC_SET(si1133_config_bus_cycles, i2c_end_stats.busy_cycles - i2c_start_stats.busy_cycles);
+  METRIC_SET(si1133_config_cycles, timing_cycles_since(start));
+  si1133_blocking = false;
 }
 
 
@@ -91,6 +381,8 @@ static void si1133_configure(){
  *
  * @details
  * This function passes a peripheral dependent struct to the general i2c driver in order to configure i2c to operate with the si1133 peripheral
+ * After a warm reset the sensor is asked for its CHAN_LIST. If it answers with a configured channel list it kept its
+ * power and configuration, so the startup delay and the configuration are skipped.
  *
  * @note
  * This function will be called in app.c to setup i2c operation with the si1133.
@@ -98,27 +390,129 @@ static void si1133_configure(){
  ******************************************************************************/
 void Si1133_i2c_open(){
   I2C_OPEN_STRUCT si113_i2c_open_struct;
+  uint32_t chan_list;
+
+  // Channel scheduling state continues across a warm reset
+  retain_add(&si1133_configured, sizeof(si1133_configured));
+  retain_add(&si1133_chan_list, sizeof(si1133_chan_list));
+  retain_add(si1133_countdown, sizeof(si1133_countdown));
+  retain_add(&si1133_enabled, sizeof(si1133_enabled));
+  retain_add(si1133_adcsens, sizeof(si1133_adcsens));
+  si1133_exec = i2c_exec_auto; //polled or interrupt per transaction, until a profile selects one
+
+  if(!retain_resumed()){
+      timer_delay(25); // 25ms for startup of sensor
+  }
 
-  timer_delay(25); // 25ms for startup of sensor
+  si1133_i2c_setup(&si113_i2c_open_struct);
+  i2c_open(I2C1, &si113_i2c_open_struct);
 
+  if(retain_resumed()){
+      chan_list = si1133_query_chan_list();
+      if(chan_list != SI1133_NO_RESPONSE && chan_list != 0){
+          // Still configured, only CHAN_LIST may be one schedule ahead of the retained state
+          METRIC_SET(si1133_config_kept, 1);
+          if(chan_list != si1133_chan_list){
+              si1133_blocking = true;
+              si1133_param_set(CHAN_LIST, si1133_chan_list, false);
+              si1133_blocking = false;
+          }
+          return;
+      }
+      if(chan_list == SI1133_NO_RESPONSE){
+          timer_delay(25); // sensor lost power over the reset and is starting up
+      }
+  }
+  si1133_configure();
+}
 
-  si113_i2c_open_struct.clhr = i2cClockHLRAsymetric; //6:3 ratio
-  si113_i2c_open_struct.enable = true;
-  si113_i2c_open_struct.freq = I2C_FREQ_FAST_MAX ; //400 Khz (si113 max freq)
-  si113_i2c_open_struct.master = true;
-  si113_i2c_open_struct.out_scl_en = true;
-  si113_i2c_open_struct.out_sda_en = true;
-  si113_i2c_open_struct.refFreq = 0; //gecko in master mode
-  si113_i2c_open_struct.scl_out_route0 = I2C_SCL_PC5;
-  si113_i2c_open_struct.sda_out_route0 = I2C_SDA_PC4;
-  si113_i2c_open_struct.ack_irq_enable = true;
-  si113_i2c_open_struct.rxdatav_irq_enable = true;
-  si113_i2c_open_struct.stop_irq_enable = true;
+/***************************************************************************//**
+ * @brief
+ * Opens the i2c again with another execution policy.
+ *
+ * @details
+ * i2c_open() computes the bus divider and the cost model from the HF clock, so this is also called after the
+ * HFRCO band changes.
+ *
+ * @note
+ * This function is called between samples, when no transaction is in progress.
+ *
+ * @param[in] exec
+ * Execution policy, polled, interrupt or chosen per transaction
+ *
+ ******************************************************************************/
+void si1133_i2c_reopen(I2C_EXEC_MODE exec){
+  I2C_OPEN_STRUCT si113_i2c_open_struct;
+
+  EFM_ASSERT(i2c_available(I2C1));
+  si1133_exec = exec;
+  si1133_i2c_setup(&si113_i2c_open_struct);
+  i2c_open(I2C1, &si113_i2c_open_struct);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Selects the channels measured and the white light gain.
+ *
+ * @details
+ * Channels that are enabled again are measured on the next FORCE and then after their period. Channels that are
+ * disabled keep their last result and are no longer due. The white light ADCSENS and CHAN_LIST are only written
+ * if they change, with one fused parameter write each.
+ *
+ * @note
+ * This function is called at a sample boundary, once the last result has been read and before the next FORCE,
+ * so the next FORCE is the first one of the new settings.
+ *
+ * @param[in] channels
+ * CHAN_LIST bits of the channels to measure, channels that are not configured are ignored
+ *
+ * @param[in] white_adcsens
+ * ADCSENS of the white light channel
+ *
+ ******************************************************************************/
+void si1133_profile_set(uint32_t channels, uint32_t white_adcsens){
+  uint32_t enabled = (channels | 1) & si1133_configured;   //white light is the sample clock
+  uint32_t added = enabled & ~si1133_enabled;
+  uint32_t next;
+
+  for(uint32_t channel = 0; channel < SI1133_CONFIGURED; channel++){
+      if(added & (1 << channel)){
+          si1133_countdown[channel] = si1133_channels[channel].period;
+      }
+  }
+  si1133_enabled = enabled;
+  next = (si1133_chan_list & enabled) | added;
 
+  si1133_blocking = true;
+  if(white_adcsens != si1133_adcsens[0]){
+      si1133_param_set(ADCSENS0, white_adcsens, false);
+      si1133_adcsens[0] = white_adcsens;
+  }
+  if(next != si1133_chan_list){
+      si1133_chan_list = next;
+      si1133_param_set(CHAN_LIST, next, false);
+      METRIC_INC(si1133_chan_list_writes);
+  }
+  si1133_blocking = false;
+}
 
+/***************************************************************************//**
+ * @brief
+ * Characterizes the I2C timing settings with the si1133 on the bus.
+ *
+ * @details
+ * The sweep reads the Part ID register at every setting and restores the si1133 settings afterwards, the
+ * configuration written by Si1133_i2c_open() is not touched.
+ *
+ * @note
+ * This function is called in app_peripheral_setup() after Si1133_i2c_open() when I2C_TIMING_BENCH is defined.
+ *
+ ******************************************************************************/
+void si1133_i2c_bench(void){
+  I2C_OPEN_STRUCT si113_i2c_open_struct;
 
-  i2c_open(I2C1, &si113_i2c_open_struct);
-  si1133_configure();
+  si1133_i2c_setup(&si113_i2c_open_struct);
+  i2c_bench_run(I2C1, &si113_i2c_open_struct, SI1133_ADDRESS, PART_ID_REGISTER, SI1133_PART_ID);
 }
 
 
@@ -143,9 +537,11 @@ void Si1133_i2c_open(){
  *
  ******************************************************************************/
 void si1133_read(uint32_t bytes_expected, uint32_t desired_register_address, uint32_t app_cb){
-  uint32_t device_address = 0x55;
+  uint32_t device_address = SI1133_ADDRESS;
 
-  i2c_start(I2C1, device_address, read, &si1133_read_data, bytes_expected, desired_register_address, app_cb);
+  EFM_ASSERT(bytes_expected <= 4 * SI1133_READ_WORDS);
+  si1133_read_bytes = bytes_expected;
+  i2c_start(I2C1, device_address, read, si1133_read_data, bytes_expected, desired_register_address, app_cb, app_cb == NULL_CB && si1133_blocking);
 
 }
 
@@ -170,9 +566,9 @@ void si1133_read(uint32_t bytes_expected, uint32_t desired_register_address, uin
  *
  ******************************************************************************/
 void si1133_write(uint32_t bytes_expected, uint32_t desired_register_address, uint32_t app_cb){
-  uint32_t device_address = 0x55;
+  uint32_t device_address = SI1133_ADDRESS;
 
-  i2c_start(I2C1, device_address, write, &si1133_write_data, bytes_expected, desired_register_address, app_cb);
+  i2c_start(I2C1, device_address, write, &si1133_write_data, bytes_expected, desired_register_address, app_cb, app_cb == NULL_CB && si1133_blocking);
 }
 
 /***************************************************************************//**
@@ -187,7 +583,107 @@ void si1133_write(uint32_t bytes_expected, uint32_t desired_register_address, ui
  *
  ******************************************************************************/
 uint32_t si1133_read_result(){
-  return si1133_read_data;
+  return si1133_channel_result(0); //white light, measured on every FORCE
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the last result of a channel.
+ *
+ * @details
+ * Channels that are not due on a FORCE keep their previous result, si1133_channels_measured counts how often
+ * each one was updated.
+ *
+ * @param[in] channel
+ * Channel number, the order of the channel configuration
+ *
+ ******************************************************************************/
+uint32_t si1133_channel_result(uint32_t channel){
+  EFM_ASSERT(channel < SI1133_CHANNELS);
+  return metric_si1133_channel_value[channel];
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns log2 of the gain a channel measures at.
+ *
+ * @details
+ * HW_GAIN doubles the integration time and SW_GAIN sums 2^SW_GAIN measurements, so a result divided by
+ * 2^(HW_GAIN + SW_GAIN) is the same light level at any ADCSENS setting.
+ *
+ * @param[in] channel
+ * Channel number, the order of the channel configuration
+ *
+ ******************************************************************************/
+uint32_t si1133_gain_shift(uint32_t channel){
+  EFM_ASSERT(channel < SI1133_CHANNELS);
+  return (si1133_adcsens[channel] & HW_GAIN_MASK) + ((si1133_adcsens[channel] >> SW_GAIN_SHIFT) & SW_GAIN_MASK);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Checks that the last result read returned a completed measurement.
+ *
+ * @details
+ * The result read starts at IRQ_STATUS, so the status of the measurement comes back in the same transaction
+ * as its data. IRQ_STATUS is cleared by reading, so the channels it reports are collected over the reads of
+ * one result. Until every channel of the FORCE has been reported the result is stale: the read is retried, up
+ * to SI1133_READ_RETRIES times, with the same callback. HOSTOUT keeps a completed channel's data until the
+ * next FORCE, so the last read holds every channel. Every stale read and dropped sample is counted.
+ * A fresh result holds one HOSTOUT pair per measured channel, in channel order, which is stored per channel.
+ * Once the result is used or dropped the channels of the next FORCE are selected.
+ *
+ * @note
+ * This function is called first in the result read callback, which returns if it is false.
+ *
+ * @return
+ * True if the result is fresh and can be used
+ *
+ ******************************************************************************/
+bool si1133_result_fresh(void){
+  si1133_status_seen |= si1133_read_byte(0) & si1133_active;
+
+  if(si1133_status_seen == si1133_active){
+      if(si1133_read_retries){
+          METRIC_INC(si1133_retried_fresh);
+      }
+      uint32_t byte = 1;
+      for(uint32_t channel = 0; channel < SI1133_CONFIGURED; channel++){
+          if(si1133_active & (1 << channel)){
+              metric_si1133_channel_value[channel] = (si1133_read_byte(byte) << 8) | si1133_read_byte(byte + 1);
+              metric_si1133_channels_measured[channel]++;
+              byte += 2;
+          }
+      }
+      si1133_schedule_channels();
+      return true;
+  }
+
+  METRIC_INC(si1133_stale_reads);
+  if(si1133_read_retries < SI1133_READ_RETRIES){
+      si1133_read_retries++;
+      si1133_read(si1133_read_bytes, IRQ_STATUS, si1133_light_cb);
+  }else{
+      METRIC_INC(si1133_stale_dropped);
+      si1133_schedule_channels();
+  }
+  return false;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the time from FORCE to a complete result for the enabled channels.
+ *
+ * @details
+ * This is the worst case, the FORCE that measures every enabled channel. FORCEs with fewer channels due complete
+ * earlier, si1133_force_us has the model time of the last one.
+ *
+ * @note
+ * This is used to place the result read directly after the measurement, in the LETIMER gap and in sync mode.
+ *
+ ******************************************************************************/
+uint32_t si1133_conversion_us(void){
+  return si1133_channels_us(si1133_enabled);
 }
 
 /***************************************************************************//**
@@ -204,7 +700,10 @@ uint32_t si1133_read_result(){
 void si1133_force_cmd(){
 //  si1133_read(1, RESPONSE0, NULL_CB); //expect 1 byte, response0 register, no callback
 //  while(!i2c_available(I2C1)); //wait until end of i2c read
-//  uint32_t cmd_ctr = si1133_read_data & 0x0f; //grab lower 4bits
+//  uint32_t cmd_ctr = si1133_read_data[0] & 0x0f; //grab lower 4bits
+
+  si1133_active = si1133_chan_list;
+  METRIC_SET(si1133_force_us, si1133_channels_us(si1133_active));
 
   si1133_write_data = FORCE;
   si1133_write(1,COMMAND,NULL_CB); //write our input data to INPUT0
@@ -214,18 +713,43 @@ void si1133_force_cmd(){
 //  // Verify write command
 //  si1133_read(1, RESPONSE0, NULL_CB); //expect 1 byte, response0 register, no callback
 //  while(!i2c_available(I2C1)); //wait until end of i2c read
-//  if((si1133_read_data & 0x0f) != cmd_ctr+1){
+//  if((si1133_read_data[0] & 0x0f) != cmd_ctr+1){
 //     EFM_ASSERT(false); //command write failed
 //  }
 
 }
 
+/***************************************************************************//**
+ * @brief
+ * Sends the FORCE command if the i2c bus is free, without waiting.
+ *
+ * @details
+ * The bus is claimed atomically with i2c_try_start() and the command word is private to this function, so
+ * a FORCE from an interrupt cannot corrupt a transaction or write data of the main loop it preempted.
+ *
+ * @note
+ * This is called from the TIMER1 interrupt on a sync edge.
+ *
+ * @return
+ * False if the bus was busy and no measurement was started
+ ******************************************************************************/
+bool si1133_force_try(void){
+  if(!i2c_try_start(I2C1, SI1133_ADDRESS, write, &si1133_force_data, 1, COMMAND, NULL_CB, false)){
+      return false;
+  }
+  si1133_active = si1133_chan_list;
+  METRIC_SET(si1133_force_us, si1133_channels_us(si1133_active));
+  return true;
+}
+
 /***************************************************************************//**
  * @brief
  * This function requests the white light ADC data from the si1133
  *
  * @details
- * This function begins reading at the HOSTOUT0 register for the first byte of data and will then read from HOST1, and so on, for subsequent data bytes
+ * This function begins reading at the IRQ_STATUS register, directly followed by a HOSTOUT pair for each channel the
+ * last FORCE measured, so the completion status is read with the data in one transaction and only the due channels
+ * are on the bus. si1133_result_fresh() checks it.
  *
  * @note
  * This function will be called within the callback function within app.c during the timer UF callback to ensure the si1133 has been properly configured and started
@@ -235,7 +759,10 @@ void si1133_force_cmd(){
  *
  ******************************************************************************/
 void si1133_read_white_light(uint32_t light_cb){
-  si1133_read(2, HOSTOUT0, light_cb);
+  si1133_light_cb = light_cb;
+  si1133_read_retries = 0;
+  si1133_status_seen = 0;
+  si1133_read(1 + 2 * __builtin_popcount(si1133_active), IRQ_STATUS, light_cb);
 }
 
 
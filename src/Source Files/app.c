@@ -26,6 +26,34 @@
 // Private variables
 //***********************************************************************************
 static int RGB_COLOR;
+static uint32_t sample_time_ms;  // time of the current LETIMER sample
+static uint32_t sample_period_ms;     // LETIMER period in progress
+static uint32_t next_period_ms;       // LETIMER period after the next underflow, changed by a profile switch
+static uint32_t samples_unlogged;     // samples the log stage skipped since the last one it stored
+static float read_gap;           // COMP1 (FORCE) to underflow (result read) in seconds, the PWM active period
+static uint32_t filter_state;
+static bool range_valid;         // light_min and light_max hold a sample
+static APP_LIGHT_SAMPLE light_sample;   // payload of the light sample topic
+METRIC_GAUGE(light_last_code);    // log code, the reading at any gain
+METRIC_HISTOGRAM(light_level);
+METRIC_GAUGE(light_min);
+METRIC_GAUGE(light_max);
+METRIC_GAUGE(app_setup_cycles);  // app_peripheral_setup() from timing_open(), cold boot against warm reset
+#ifdef SYNC_INPUT_MODE
+METRIC_GAUGE(sync_triggers);
+METRIC_GAUGE(sync_missed);       // edges dropped as the I2C bus was busy
+METRIC_GAUGE(sync_latency_us);   // sync edge to the FORCE issued, last edge
+METRIC_GAUGE(sync_latency_min_us);
+METRIC_GAUGE(sync_latency_max_us);
+METRIC_GAUGE(sync_jitter_us);
+#endif
+#ifdef GPIO_LEAKAGE_CHARACTERIZE
+static uint32_t leakage_periods;
+#endif
+#ifdef FLASH_LATENCY_BENCH
+static uint32_t flash_bench_data[FLASH_PAGE_WORDS];
+static bool flash_bench_erased;
+#endif
 
 
 //***********************************************************************************
@@ -33,6 +61,251 @@ static int RGB_COLOR;
 //***********************************************************************************
 
 static void app_letimer_pwm_open(float period, float act_period, uint32_t out0_route, uint32_t out1_route, uint32_t comp0_cb, uint32_t comp1_cb, uint32_t underflow_cb);
+static void app_leuart_open(uint32_t rx_cb, uint32_t tx_cb);
+static float app_read_gap(void);
+static uint32_t app_elapsed_ms(uint32_t elapsed);
+static void app_pipeline_open(void);
+static void app_classify_stage(PIPE_SAMPLE *const batch[], uint32_t count);
+static void app_filter_stage(PIPE_SAMPLE *const batch[], uint32_t count);
+static void app_log_stage(PIPE_SAMPLE *const batch[], uint32_t count);
+static void app_telemetry_stage(PIPE_SAMPLE *const batch[], uint32_t count);
+static void app_sample_source(const void *payload);
+static void app_sample_range(const void *payload);
+static void app_profile_apply(const PROFILE *from, const PROFILE *to);
+
+// Operating profiles, switched at a sample boundary by profile_request()
+static const PROFILE app_profiles[APP_PROFILE_COUNT] = {
+    [app_profile_standard]      = { "standard", PWM_PER, 0, 0x07, MCU_HFXO_FREQ, i2c_exec_auto, 1, true, true },
+    [app_profile_low_power]     = { "low_power", 10.0, 0, 0x01, cmuHFRCOFreq_19M0Hz, i2c_exec_auto, 6, false, false },
+    [app_profile_diagnostic]    = { "diagnostic", 0.25, 0, 0x07, cmuHFRCOFreq_38M0Hz, i2c_exec_irq, 1, true, true },
+    [app_profile_high_accuracy] = { "high_accuracy", PWM_PER, 0x02, 0x01, MCU_HFXO_FREQ, i2c_exec_auto, 1, true, true }   //4x integration time
+};
+
+// Subscribers of each topic, called in this order
+static const BUS_HANDLER light_sample_subscribers[] = {
+    app_sample_source,
+    app_sample_range
+};
+
+static const BUS_TOPIC app_topics[APP_TOPIC_COUNT] = {
+    [app_topic_light_sample] = { "light_sample", LIGHT_SAMPLE_CB, light_sample_subscribers,
+                                 sizeof(light_sample_subscribers) / sizeof(light_sample_subscribers[0]) }
+};
+
+// Handler of every scheduled event, each one removes its event
+static const SCHED_HANDLER app_event_handlers[APP_EVENT_COUNT] = {
+    [LETIMER0_UF_CB]    = scheduled_letimer0_uf_cb,
+    [LETIMER0_COMP0_CB] = scheduled_letimer0_comp0_cb,
+    [LETIMER0_COMP1_CB] = scheduled_letimer0_comp1_cb,
+    [SI1133_LIGHT_CB]   = scheduled_si1133_read_cb,
+    [SYNC_READ_CB]      = scheduled_sync_read_cb,
+    [LEUART0_RX_CB]     = scheduled_leuart0_rx_cb,
+    [LEUART0_TX_CB]     = scheduled_leuart0_tx_cb,
+    [FLASH_DONE_CB]     = scheduled_flash_done_cb,
+    [LIGHT_SAMPLE_CB]   = bus_dispatch,
+    [PIPE_CLASSIFY_CB]  = pipeline_service,
+    [PIPE_FILTER_CB]    = pipeline_service,
+    [PIPE_LOG_CB]       = pipeline_service,
+    [PIPE_TELEMETRY_CB] = pipeline_service
+};
+
+/***************************************************************************//**
+ * @brief
+ * Light sample subscriber that copies the sample into a pipeline slot and submits it.
+ *
+ * @details
+ * The sample is dropped (and counted by the pipeline) when every slot is in use.
+ *
+ ******************************************************************************/
+static void app_sample_source(const void *payload){
+  const APP_LIGHT_SAMPLE *light = payload;
+  PIPE_SAMPLE *sample = pipeline_alloc();
+
+  if(sample){
+      sample->raw = light->raw;
+      sample->code = log_code_encode(light->raw, light->gain);
+      sample->timestamp = light->timestamp;
+      sample->profile = profile_current();
+      pipeline_submit(sample);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Light sample subscriber that tracks the smallest and largest reading since reset.
+ ******************************************************************************/
+static void app_sample_range(const void *payload){
+  const APP_LIGHT_SAMPLE *light = payload;
+
+  if(!range_valid || light->raw < metric_light_min[0]){
+      METRIC_SET(light_min, light->raw);
+  }
+  METRIC_MAX(light_max, light->raw);
+  range_valid = true;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Sample pipeline stage that turns the blue LED on while it is dark.
+ *
+ * @details
+ * Only the newest sample of a batch decides the LED, older ones are already out of date. The LEDs are a live
+ * output, so they follow the profile in use rather than the one the sample was taken with.
+ *
+ ******************************************************************************/
+static void app_classify_stage(PIPE_SAMPLE *const batch[], uint32_t count){
+  for(uint32_t i = 0; i < count; i++){
+      batch[i]->dark = batch[i]->raw < EXPECTED_READ_DATA;
+  }
+  if(profile_get(profile_current())->leds){
+      leds_enabled(RGB_LED_1, COLOR_BLUE, batch[count - 1]->dark);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Sample pipeline stage that smooths the light level with a first order IIR filter.
+ *
+ ******************************************************************************/
+static void app_filter_stage(PIPE_SAMPLE *const batch[], uint32_t count){
+  for(uint32_t i = 0; i < count; i++){
+      filter_state += ((int32_t)batch[i]->raw - (int32_t)filter_state) >> FILTER_SHIFT;
+      batch[i]->filtered = filter_state;
+  }
+#ifdef LED_FADE_VISUALIZE
+  if(profile_get(profile_current())->leds){
+      led_fade_to(COLOR_GREEN, filter_state > 255 ? 255 : filter_state, FADE_VISUALIZE_MS);
+  }
+#endif
+}
+
+/***************************************************************************//**
+ * @brief
+ * Sample pipeline stage that stores the samples in the sample log.
+ *
+ * @details
+ * Every log_every-th sample of the profile the sample was taken with is stored, the others are marked
+ * PIPE_NOT_LOGGED.
+ *
+ ******************************************************************************/
+static void app_log_stage(PIPE_SAMPLE *const batch[], uint32_t count){
+  for(uint32_t i = 0; i < count; i++){
+      const PROFILE *profile = profile_get(batch[i]->profile);
+      batch[i]->seq = PIPE_NOT_LOGGED;
+      if(profile->log_every && ++samples_unlogged >= profile->log_every){
+          samples_unlogged = 0;
+          batch[i]->seq = sample_log_append(batch[i]->timestamp, batch[i]->code);
+      }
+  }
+  retain_seal(); //the samples, their statistics and the channel schedule survive a reset from here on
+  leuart_session_poll(LEUART0, app_elapsed_ms(batch[count - 1]->timestamp)); //idle host link gives EM3 back
+#ifndef FLASH_LATENCY_BENCH
+  history_poll();
+#endif
+}
+
+/***************************************************************************//**
+ * @brief
+ * Sample pipeline stage that publishes the light level metrics.
+ *
+ * @details
+ * Only samples taken with a profile that has telemetry are published.
+ *
+ ******************************************************************************/
+static void app_telemetry_stage(PIPE_SAMPLE *const batch[], uint32_t count){
+  for(uint32_t i = 0; i < count; i++){
+      if(profile_get(batch[i]->profile)->telemetry){
+          METRIC_HIST(light_level, batch[i]->raw);
+          METRIC_SET(light_last_code, batch[i]->code);
+      }
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Moves the sensor, clocks and sample timer to an operating profile.
+ *
+ * @details
+ * The HFRCO band and the i2c execution policy are changed first, the i2c is opened again so its bus divider
+ * and cost model match the new clock. Then the Si1133 channels and gain are set and the read gap recomputed for
+ * the new conversion time. The LETIMER period is changed in place, so the period in progress completes at its
+ * old length and the next one has the new length. Only when the new period needs another prescaler is the
+ * LETIMER opened again, which restarts the period and can cost the sample in progress.
+ *
+ * @note
+ * This is called by profile_open() with from 0 before the sample clock is opened, and by profile_boundary()
+ * once a sample has been read. In SYNC_INPUT_MODE the band is not changed, TIMER1 timestamps count HFPER ticks,
+ * and the period comes from the sync input.
+ *
+ * @param[in] from
+ * Profile in use, 0 on the first call
+ *
+ * @param[in] to
+ * Profile to apply
+ *
+ ******************************************************************************/
+static void app_profile_apply(const PROFILE *from, const PROFILE *to){
+  if(!from || to->hf_band != from->hf_band || to->i2c_exec != from->i2c_exec){
+#ifndef SYNC_INPUT_MODE
+      CMU_HFRCOBandSet(to->hf_band);
+#ifdef LED_FADE_VISUALIZE
+      led_fade_clock_update();
+#endif
+#endif
+      si1133_i2c_reopen(to->i2c_exec);
+  }
+
+  si1133_profile_set(to->channels, to->white_adcsens);
+  if(!to->leds){
+      leds_enabled(RGB_LED_1, COLOR_BLUE, false);
+#ifdef LED_FADE_VISUALIZE
+      led_fade_to(COLOR_GREEN, 0, 0);
+#endif
+  }
+
+#ifdef SYNC_INPUT_MODE
+  if(from){
+      sync_input_conversion_set(SI1133_FORCE_BUS_US + si1133_conversion_us());
+  }
+#else
+  read_gap = app_read_gap();
+  next_period_ms = to->period * 1000;
+  if(!from){
+      sample_period_ms = next_period_ms;
+  }else if(!letimer_pwm_period_set(LETIMER0, to->period, read_gap)){
+      sample_period_ms = 0; //the restart underflows immediately, without a FORCE
+      app_letimer_pwm_open(to->period, read_gap, PWM_ROUTE_0, PWM_ROUTE_1, LETIMER0_COMP0_CB, LETIMER0_COMP1_CB, LETIMER0_UF_CB);
+      letimer_start(LETIMER0, true);
+  }
+#endif
+}
+#ifdef GPIO_LEAKAGE_CHARACTERIZE
+static void app_leakage_step(void);
+
+/***************************************************************************//**
+ * @brief
+ * Steps the sleep pin-state profile for leakage characterization.
+ *
+ * @details
+ * The device sleeps GPIO_LEAKAGE_PERIODS periods with the active profile kept in sleep, then with the sleep
+ * profile, and finally enters the shipping profile with LETIMER0 stopped so it stays in EM3. The floor current
+ * of each step is read off the Energy Profiler, and the difference between steps is the leakage of the pins
+ * that changed.
+ *
+ * @note
+ * The shipping profile removes sensor power, so it is always the last step.
+ *
+ ******************************************************************************/
+static void app_leakage_step(void){
+  leakage_periods++;
+  if(leakage_periods == GPIO_LEAKAGE_PERIODS){
+      gpio_profile_sleep_select(gpio_profile_sleep);
+  }else if(leakage_periods == 2 * GPIO_LEAKAGE_PERIODS){
+      gpio_profile_sleep_select(gpio_profile_shipping);
+      letimer_start(LETIMER0, false);
+  }
+}
+#endif
 
 //***********************************************************************************
 // Global functions
@@ -44,8 +317,13 @@ static void app_letimer_pwm_open(float period, float act_period, uint32_t out0_r
  *
  * @details
  * This function calls our drivers for the CMU, GPIO and letimer, in order to initialize each peripheral.
- * Additionally, this function will initialize our event scheduler and sleep driver.
- * It sets up LETIMER0 with a specified PWM, then starts the timer.
+ * Additionally, this function will initialize our event scheduler, sleep driver, cycle counter and idle work jobs.
+ * It sets up LETIMER0 with a specified PWM, then starts the timer. When SYNC_INPUT_MODE is defined the external sync
+ * input is opened instead and each sample is started by the sync edge.
+ * After a warm reset the retain module restores the sample log, light statistics and sensor state, and the sensor
+ * configuration is skipped if the sensor kept it.
+ * The operating profile is applied before the sample clock is opened, APP_PROFILE_INITIAL on a cold boot and the
+ * profile in use before the reset on a warm one.
  *
  * @note
  * This function will be called in main.c in order to set everything up for operation before we start operation.
@@ -54,14 +332,59 @@ static void app_letimer_pwm_open(float period, float act_period, uint32_t out0_r
 
 void app_peripheral_setup(void){
   cmu_open();
+  metrics_open();
+  timing_open();
+  retain_open();
+#ifdef CLOCK_GATING_BASELINE
+  cmu_clock_acquire(cmuClock_I2C1);   //never released, holds HFPER as well
+#endif
+  retain_add(&sample_time_ms, sizeof(sample_time_ms));
+  retain_add(&filter_state, sizeof(filter_state));
+  retain_add(&range_valid, sizeof(range_valid));
+  retain_add(metric_light_min, sizeof(metric_light_min));
+  retain_add(metric_light_max, sizeof(metric_light_max));
+  scheduler_open(app_event_handlers, APP_EVENT_COUNT);
   sleep_open();
   gpio_open();
   Si1133_i2c_open();
-  scheduler_open();
+#ifdef I2C_TIMING_BENCH
+  si1133_i2c_bench();
+#endif
+  bus_open(app_topics, APP_TOPIC_COUNT);
+#ifdef BUS_FANOUT_BENCH
+  bus_fanout_bench();
+#endif
+  idle_work_open();
+  sample_log_open();
+  flash_open(FLASH_DONE_CB);
+#ifdef FLASH_LATENCY_BENCH
+  for(uint32_t i = 0; i < FLASH_PAGE_WORDS; i++){
+      flash_bench_data[i] = i;
+  }
+  flash_bench_erased = false;
+  flash_erase(flash_storage());
+#else
+  history_open(app_elapsed_ms);
+#endif
+  app_pipeline_open();
+  app_leuart_open(LEUART0_RX_CB, LEUART0_TX_CB);
+  log_export_open(LEUART0);
   rgb_led_open();
-  app_letimer_pwm_open(PWM_PER, PWM_ACT_PER, PWM_ROUTE_0, PWM_ROUTE_1, LETIMER0_COMP0_CB, LETIMER0_COMP1_CB, LETIMER0_UF_CB);
+  profile_open(app_profiles, APP_PROFILE_COUNT, APP_PROFILE_INITIAL, app_profile_apply);
+#ifdef SYNC_INPUT_MODE
+  sync_input_open(SI1133_FORCE_BUS_US + si1133_conversion_us(), SYNC_READ_CB); //external sync edge replaces the LETIMER as the sample clock
+#else
+  app_letimer_pwm_open(profile_get(profile_current())->period, read_gap, PWM_ROUTE_0, PWM_ROUTE_1, LETIMER0_COMP0_CB, LETIMER0_COMP1_CB, LETIMER0_UF_CB);
+#ifdef GPIO_LEAKAGE_CHARACTERIZE
+  leakage_periods = 0;
+  gpio_profile_sleep_select(gpio_profile_active);
+#endif
+#ifdef SATURATION_BENCH
+  saturation_bench_open(sample_period_ms, read_gap * 1000);
+#endif
   letimer_start(LETIMER0, true);  //This command will initiate the start of the LETIMER0
-
+#endif
+  METRIC_SET(app_setup_cycles, timing_cycles());
 }
 
 /***************************************************************************//**
@@ -125,6 +448,95 @@ void app_letimer_pwm_open(float period, float act_period, uint32_t out0_route, u
   letimer_pwm_open(LETIMER0, &app_letimer_pwm_struct);
 }
 
+/***************************************************************************//**
+ * @brief
+ * Converts a difference of sample timestamps to ms for the history.
+ *
+ * @details
+ * Timestamps are ms of the LETIMER sample time, or sync edge ticks in SYNC_INPUT_MODE.
+ *
+ ******************************************************************************/
+static uint32_t app_elapsed_ms(uint32_t elapsed){
+#ifdef SYNC_INPUT_MODE
+  return sync_input_ticks_to_us(elapsed) / 1000;
+#else
+  return elapsed;
+#endif
+}
+
+
+/***************************************************************************//**
+ * @brief
+ * Returns the shortest COMP1 to underflow gap that fits the FORCE write and the measurement.
+ *
+ * @details
+ * The measurement time comes from the Si1133 configuration, so a higher decimation or more channels
+ * lengthen the gap instead of producing stale reads. The gap is rounded up to whole LETIMER ticks.
+ *
+ * @note
+ * Half a tick is added because letimer_pwm_open() truncates the period to LETIMER_HZ ticks. When a long PWM_PER
+ * prescales the LETIMER clock the gap is rounded up to the coarser ticks.
+ *
+ ******************************************************************************/
+static float app_read_gap(void){
+  uint32_t gap_us = SI1133_FORCE_BUS_US + si1133_conversion_us();
+  uint32_t ticks = ((uint64_t)gap_us * LETIMER_HZ + 999999) / 1000000;
+
+  if(ticks < 1){
+      ticks = 1;
+  }
+  return (ticks + 0.5f) / LETIMER_HZ;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Builds the sample pipeline: classify, filter, log, telemetry.
+ *
+ * @details
+ * Classification drives the LED so it has the highest priority; telemetry has the lowest.
+ *
+ ******************************************************************************/
+static void app_pipeline_open(void){
+  filter_state = 0;
+  samples_unlogged = 0;
+  pipeline_open();
+  pipeline_add_stage("classify", app_classify_stage, PIPE_CLASSIFY_CB, 0);
+  pipeline_add_stage("filter", app_filter_stage, PIPE_FILTER_CB, 1);
+  pipeline_add_stage("log", app_log_stage, PIPE_LOG_CB, 2);
+  pipeline_add_stage("telemetry", app_telemetry_stage, PIPE_TELEMETRY_CB, 3);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Sets up LEUART0 on the virtual COM port for the log export protocol.
+ *
+ * @details
+ * 8N1 at LEUART_BAUDRATE from the LFXO. Between sessions the board may enter EM3, the host wakes it with a
+ * byte on RX and the session ends LEUART_SESSION_MS after the last traffic.
+ *
+ * @param[in] rx_cb
+ * Used to set the event scheduler when bytes are received
+ *
+ * @param[in] tx_cb
+ * Used to set the event scheduler when a transmission completes
+ ******************************************************************************/
+static void app_leuart_open(uint32_t rx_cb, uint32_t tx_cb){
+  LEUART_OPEN_STRUCT app_leuart_struct;
+
+  app_leuart_struct.baudrate = LEUART_BAUDRATE;
+  app_leuart_struct.databits = leuartDatabits8;
+  app_leuart_struct.parity = leuartNoParity;
+  app_leuart_struct.stopbits = leuartStopbits1;
+  app_leuart_struct.enable = leuartEnable;
+  app_leuart_struct.tx_route = LEUART_TX_ROUTE;
+  app_leuart_struct.rx_route = LEUART_RX_ROUTE;
+  app_leuart_struct.tx_en = true;
+  app_leuart_struct.rx_en = true;
+  app_leuart_struct.rx_cb = rx_cb;
+  app_leuart_struct.tx_cb = tx_cb;
+
+  leuart_open(LEUART0, &app_leuart_struct);
+}
 
 /***************************************************************************//**
  * @brief
@@ -146,6 +558,10 @@ void app_letimer_pwm_open(float period, float act_period, uint32_t out0_route, u
 void rgb_led_open(void){
   RGB_COLOR = 0;
   rgb_init();
+#ifdef LED_FADE_VISUALIZE
+  led_fade_open(COLOR_GREEN, 0);  //green is driven by TIMER0, blue stays on GPIO for the dark indicator
+  leds_enabled(RGB_LED_0, NO_COLOR, true);
+#endif
 }
 
 /***************************************************************************//**
@@ -160,7 +576,11 @@ void rgb_led_open(void){
  *
  ******************************************************************************/
 void scheduled_letimer0_uf_cb (void){
-  //EFM_ASSERT(!(get_scheduled_events() & LETIMER0_UF_CB));
+  remove_scheduled_event(LETIMER0_UF_CB); //removes UF event (because it is currently being handled)
+#ifdef SATURATION_BENCH
+  uint32_t bench_start = timing_cycles();
+#endif
+  //EFM_ASSERT(!is_scheduled_event(LETIMER0_UF_CB));
 //  if(RGB_COLOR == 0){
 //      leds_enabled(RGB_LED_1, COLOR_RED, false);
 //      RGB_COLOR++;
@@ -174,8 +594,15 @@ void scheduled_letimer0_uf_cb (void){
 //      RGB_COLOR = 0;
 //  }
 
+  sample_time_ms += sample_period_ms;
+  sample_period_ms = next_period_ms;
   si1133_read_white_light(SI1133_LIGHT_CB);
-
+#ifdef GPIO_LEAKAGE_CHARACTERIZE
+  app_leakage_step();
+#endif
+#ifdef SATURATION_BENCH
+  saturation_bench_stage(bench_stage_uf_cb, timing_cycles_since(bench_start));
+#endif
 
 }
 
@@ -191,6 +618,7 @@ void scheduled_letimer0_uf_cb (void){
  *
  ******************************************************************************/
 void scheduled_letimer0_comp0_cb (void){
+  remove_scheduled_event(LETIMER0_COMP0_CB); //removes COMP0 event (because it is currently being handled)
   //EFM_ASSERT(false); NOT USED IN THIS LAB
 }
 
@@ -206,7 +634,12 @@ void scheduled_letimer0_comp0_cb (void){
  *
  ******************************************************************************/
 void scheduled_letimer0_comp1_cb (void){
-  //EFM_ASSERT(!(get_scheduled_events() & LETIMER0_COMP1_CB));
+  remove_scheduled_event(LETIMER0_COMP1_CB); //removes COMP1 event (because it is currently being handled)
+#ifdef SATURATION_BENCH
+  uint32_t bench_start = timing_cycles();
+  saturation_bench_sample_start();
+#endif
+  //EFM_ASSERT(!is_scheduled_event(LETIMER0_COMP1_CB));
 //  if(RGB_COLOR == 0){
 //      leds_enabled(RGB_LED_1, COLOR_RED,true);
 //  }
@@ -220,7 +653,9 @@ void scheduled_letimer0_comp1_cb (void){
 //  }
 
   si1133_force_cmd(); //send force command
-
+#ifdef SATURATION_BENCH
+  saturation_bench_stage(bench_stage_comp1_cb, timing_cycles_since(bench_start));
+#endif
 }
 
 /***************************************************************************//**
@@ -231,20 +666,123 @@ void scheduled_letimer0_comp1_cb (void){
  * This function handles operation that should occur after a successful i2c white light read operation of the si1133.
  *
  * @note
- * This function retrieves the value read from the si1133 peripheral and turns on BLUE LED if read value is less than expected value or
- * turns off if value is greater than or equal to expected value.
+ * This function publishes the value read from the si1133 peripheral on the light sample topic. Its subscribers feed the
+ * sample pipeline, whose classify stage turns on the BLUE LED if the value is less than the expected value.
  *
  ******************************************************************************/
 void scheduled_si1133_read_cb(){
-  uint32_t si1133_data = si1133_read_result();
+  remove_scheduled_event(SI1133_LIGHT_CB); //removes si1133 read event (because it is currently being handled)
+#ifdef SATURATION_BENCH
+  uint32_t bench_start = timing_cycles();
+  uint32_t bench_period_ms;
+#endif
+
+  if(!si1133_result_fresh()){
+      return; //measurement was not complete, the read is being retried or the sample is dropped
+  }
 
-  if(si1133_data < EXPECTED_READ_DATA){
-      leds_enabled(RGB_LED_1, COLOR_BLUE, true);
-  }else{
-      leds_enabled(RGB_LED_1, COLOR_BLUE, false);
+  light_sample.raw = si1133_read_result();
+  light_sample.gain = si1133_gain_shift(0);
+#ifdef SYNC_INPUT_MODE
+  light_sample.timestamp = sync_input_timestamp();
+#else
+  light_sample.timestamp = sample_time_ms;
+#endif
+  bus_publish(app_topic_light_sample, &light_sample);
+
+  // The sample is tagged with its profile, a switch applies from the next FORCE
+#ifdef SYNC_INPUT_MODE
+  profile_boundary(sync_input_ticks_to_us(light_sample.timestamp) / 1000);
+#else
+  profile_boundary(sample_time_ms);
+#endif
+
+#ifdef SATURATION_BENCH
+  saturation_bench_stage(bench_stage_read_cb, timing_cycles_since(bench_start));
+  saturation_bench_sample_done();
+  if(saturation_bench_step(&bench_period_ms)){
+      app_letimer_pwm_open(bench_period_ms / 1000.0, read_gap, PWM_ROUTE_0, PWM_ROUTE_1, LETIMER0_COMP0_CB, LETIMER0_COMP1_CB, LETIMER0_UF_CB);
+      letimer_start(LETIMER0, true);
   }
+#endif
+}
+
+/***************************************************************************//**
+ * @brief
+ * Call back function that is called once the measurement started by a sync edge is complete
+ *
+ * @details
+ * The FORCE was sent from the sync edge interrupt, so this only has to start the HOSTOUT read. The sample
+ * timestamp is the sync edge captured by TIMER1 and is available from sync_input_timestamp(). The sync edge
+ * statistics are published as metrics here, once per measurement rather than from the TIMER1 interrupt.
+ *
+ * @note
+ * This function is only scheduled when SYNC_INPUT_MODE is defined.
+ *
+ ******************************************************************************/
+void scheduled_sync_read_cb(void){
+  remove_scheduled_event(SYNC_READ_CB); //removes sync read event (because it is currently being handled)
+  si1133_read_white_light(SI1133_LIGHT_CB);
 
+#ifdef SYNC_INPUT_MODE
+  SYNC_INPUT_STATS stats;
+  if(sync_input_stats(&stats)){
+      METRIC_SET(sync_triggers, stats.triggers);
+      METRIC_SET(sync_missed, stats.missed);
+      METRIC_SET(sync_latency_us, sync_input_ticks_to_us(stats.latency_last));
+      METRIC_SET(sync_latency_min_us, sync_input_ticks_to_us(stats.latency_min));
+      METRIC_SET(sync_latency_max_us, sync_input_ticks_to_us(stats.latency_max));
+      METRIC_SET(sync_jitter_us, sync_input_ticks_to_us(stats.jitter));
+  }
+#endif
 }
 
+/***************************************************************************//**
+ * @brief
+ * Call back function that is called when LEUART0 has received bytes
+ *
+ * @details
+ * Passes the received bytes to the log export protocol parser.
+ *
+ ******************************************************************************/
+void scheduled_leuart0_rx_cb(void){
+  remove_scheduled_event(LEUART0_RX_CB); //removes receive event (because it is currently being handled)
+  log_export_rx();
+}
 
+/***************************************************************************//**
+ * @brief
+ * Call back function that is called when an LEUART0 transmission completes
+ *
+ * @details
+ * Lets the log export protocol send its next block.
+ *
+ ******************************************************************************/
+void scheduled_leuart0_tx_cb(void){
+  remove_scheduled_event(LEUART0_TX_CB); //removes transmit event (because it is currently being handled)
+  log_export_tx_done();
+}
 
+/***************************************************************************//**
+ * @brief
+ * Call back function that is called when a flash erase or write is complete
+ *
+ * @details
+ * With FLASH_LATENCY_BENCH defined the first storage page is erased and rewritten continuously while sampling
+ * runs, so the I2C handler time is recorded with the flash busy in the i2c_isr_flash_cycles histogram.
+ * Otherwise the flash belongs to the history.
+ *
+ ******************************************************************************/
+void scheduled_flash_done_cb(void){
+  remove_scheduled_event(FLASH_DONE_CB); //removes flash event (because it is currently being handled)
+#ifdef FLASH_LATENCY_BENCH
+  flash_bench_erased = !flash_bench_erased;
+  if(flash_bench_erased){
+      flash_write(flash_storage(), flash_bench_data, FLASH_PAGE_WORDS);
+  }else{
+      flash_erase(flash_storage());
+  }
+#else
+  history_flash_done();
+#endif
+}
@@ -22,11 +22,65 @@
 //***********************************************************************************
 // Private variables
 //***********************************************************************************
+static const CMU_Clock_TypeDef cmu_gate_clocks[CMU_GATES] = {
+  [cmu_gate_hfper]  = cmuClock_HFPER,
+  [cmu_gate_i2c0]   = cmuClock_I2C0,
+  [cmu_gate_i2c1]   = cmuClock_I2C1,
+  [cmu_gate_timer0] = cmuClock_TIMER0,
+  [cmu_gate_timer1] = cmuClock_TIMER1
+};
+static uint8_t cmu_gate_refs[CMU_GATES];        // holders of each clock, gated at 0
+static uint32_t cmu_gate_start[CMU_GATES];      // timing_cycles() when the clock was last enabled
+
+METRIC_DECLARE(cmu_gate_enables, metric_counter, CMU_GATES);     // times each clock was ungated
+METRIC_DECLARE(cmu_gate_held_cycles, metric_counter, CMU_GATES); // core cycles each clock was enabled, EM1 sleep not counted
 
 
 //***********************************************************************************
 // Private functions
 //***********************************************************************************
+static uint32_t cmu_gate_find(CMU_Clock_TypeDef clock);
+static void cmu_gate_take(uint32_t gate);
+static void cmu_gate_drop(uint32_t gate);
+
+/***************************************************************************//**
+ * @brief
+ * Returns the gate of a clock, asserts if the clock is not reference counted.
+ ******************************************************************************/
+static uint32_t cmu_gate_find(CMU_Clock_TypeDef clock){
+  for(uint32_t gate = 0; gate < CMU_GATES; gate++){
+      if(cmu_gate_clocks[gate] == clock){
+          return gate;
+      }
+  }
+  EFM_ASSERT(false);
+  return cmu_gate_hfper;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Adds a holder to a gate, the first one enables the clock.
+ ******************************************************************************/
+static void cmu_gate_take(uint32_t gate){
+  EFM_ASSERT(cmu_gate_refs[gate] < 0xFF);
+  if(cmu_gate_refs[gate]++ == 0){
+      CMU_ClockEnable(cmu_gate_clocks[gate], true);
+      cmu_gate_start[gate] = timing_cycles();
+      metric_cmu_gate_enables[gate]++;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Removes a holder from a gate, the last one gates the clock.
+ ******************************************************************************/
+static void cmu_gate_drop(uint32_t gate){
+  EFM_ASSERT(cmu_gate_refs[gate] > 0);
+  if(--cmu_gate_refs[gate] == 0){
+      CMU_ClockEnable(cmu_gate_clocks[gate], false);
+      metric_cmu_gate_held_cycles[gate] += timing_cycles_since(cmu_gate_start[gate]);
+  }
+}
 
 
 //***********************************************************************************
@@ -35,11 +89,14 @@
 
 /***************************************************************************//**
  * @brief
- * Enables the high frequency clock and disables the low frequency oscillators. Then routes the clock tree.
+ * Enables the high frequency clock, disables the LFRCO and enables the LFXO. Then routes the clock tree.
  *
  * @details
  * This is a low level module that directly interfaces with the hardware, selecting the clock we want to use and routing it
- * to the correct location. This module sets up an ultra low frequency clock and connects it to the low frequency clock tree.
+ * to the correct location. This module sets up an ultra low frequency clock and connects it to the LFA clock tree, and the
+ * LFXO on the LFB clock tree for the LEUART.
+ *
+ * The HFPER branch is left gated, drivers hold it through cmu_clock_acquire() while they use a peripheral on it.
  *
  * @note
  * This function is generally called once to initialize our clock for ultra low frequency use.
@@ -48,7 +105,10 @@
 
 void cmu_open(void){
 
-    CMU_ClockEnable(cmuClock_HFPER, true);
+    for(uint32_t gate = 0; gate < CMU_GATES; gate++){
+        cmu_gate_refs[gate] = 0;
+        CMU_ClockEnable(cmu_gate_clocks[gate], false);
+    }
 
     // By default, LFRCO is enabled, disable the LFRCO oscillator
     // Disable the LFRCO oscillator (Low frequency RC oscillator)
@@ -56,10 +116,9 @@ void cmu_open(void){
     // It can be found in the online HAL documentation
     CMU_OscillatorEnable(cmuOsc_LFRCO, false, false);
 
-    // Disable the LFXO oscillator (Low frequency crystal oscillator)
-    // What is the enumeration required for LFXO?
-    // It can be found in the online HAL documentation
-    CMU_OscillatorEnable(cmuOsc_LFXO, false, false);
+    // Enable the LFXO oscillator (Low frequency crystal oscillator)
+    // The LEUART needs a 32768 Hz clock for 9600 baud, the ULFRCO is too slow
+    CMU_OscillatorEnable(cmuOsc_LFXO, true, true);
 
     // No requirement to enable the ULFRCO oscillator.  It is always enabled in EM0-4H1
 
@@ -67,6 +126,7 @@ void cmu_open(void){
     // What is the enumeration required to placed the ULFRCO onto the proper clock branch?
     // It can be found in the online HAL documentation
     CMU_ClockSelectSet(cmuClock_LFA, cmuSelect_ULFRCO);    // routing ULFRCO to proper Low Freq clock tree
+    CMU_ClockSelectSet(cmuClock_LFB, cmuSelect_LFXO);      // routing LFXO to the LEUART clock tree
 
     // What is the proper enumeration to enable the clock tree onto the LE clock branches?
     // It can be found in the Assignment 2 documentation
@@ -74,3 +134,57 @@ void cmu_open(void){
 
 }
 
+/***************************************************************************//**
+ * @brief
+ * Holds a peripheral clock enabled.
+ *
+ * @details
+ * Clocks are reference counted, the clock is enabled by the first holder and stays enabled until every holder
+ * has released it. A peripheral on the HFPER branch also holds HFPER, so the branch is only gated when no
+ * peripheral on it is in use. Registers keep their values while a clock is gated.
+ *
+ * @note
+ * This may be called from interrupts. Drivers acquire the clock for as long as the peripheral has work, an
+ * I2C transaction or a running timer, and release it when the work is done.
+ *
+ * @param[in] clock
+ * Clock of the peripheral, one of cmu_gate_clocks
+ *
+ ******************************************************************************/
+void cmu_clock_acquire(CMU_Clock_TypeDef clock){
+  uint32_t gate = cmu_gate_find(clock);
+
+  /* Atomic event */
+  CORE_DECLARE_IRQ_STATE; //Save IRQ state
+  CORE_ENTER_CRITICAL(); //disables interrupts and saves IEN bit
+
+  if(gate != cmu_gate_hfper){
+      cmu_gate_take(cmu_gate_hfper);
+  }
+  cmu_gate_take(gate);
+
+  CORE_EXIT_CRITICAL(); //Restores interrupt processes
+}
+
+/***************************************************************************//**
+ * @brief
+ * Releases a clock held with cmu_clock_acquire().
+ *
+ * @param[in] clock
+ * Clock of the peripheral
+ *
+ ******************************************************************************/
+void cmu_clock_release(CMU_Clock_TypeDef clock){
+  uint32_t gate = cmu_gate_find(clock);
+
+  /* Atomic event */
+  CORE_DECLARE_IRQ_STATE; //Save IRQ state
+  CORE_ENTER_CRITICAL(); //disables interrupts and saves IEN bit
+
+  cmu_gate_drop(gate);
+  if(gate != cmu_gate_hfper){
+      cmu_gate_drop(cmu_gate_hfper);
+  }
+
+  CORE_EXIT_CRITICAL(); //Restores interrupt processes
+}
@@ -0,0 +1,181 @@
+/**
+ * @file
+ * event_bus.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that delivers published topics to a fixed list of subscribers through the event scheduler
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "event_bus.h"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+static const BUS_TOPIC *bus_topics;
+static uint32_t bus_topic_count;
+static const void *bus_payload[BUS_MAX_TOPICS];   // payload of the pending publication of each topic
+
+METRIC_DECLARE(bus_published, metric_counter, BUS_MAX_TOPICS);
+METRIC_DECLARE(bus_coalesced, metric_counter, BUS_MAX_TOPICS);      // published again before delivery
+METRIC_DECLARE(bus_delivery_cycles, metric_counter, BUS_MAX_TOPICS);
+METRIC_DECLARE(bus_fanout_cycles, metric_gauge, BUS_MAX_SUBSCRIBERS + 1);  // average cycles to deliver to n subscribers
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static void bus_deliver(const BUS_HANDLER *subscribers, uint32_t count, const void *payload);
+static void bus_bench_subscriber(const void *payload);
+
+/***************************************************************************//**
+ * @brief
+ * Calls each subscriber in list order with the payload.
+ ******************************************************************************/
+static void bus_deliver(const BUS_HANDLER *subscribers, uint32_t count, const void *payload){
+  for(uint32_t i = 0; i < count; i++){
+      subscribers[i](payload);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Subscriber used by the fan-out benchmark, reads the payload so the call is not optimized away.
+ ******************************************************************************/
+static void bus_bench_subscriber(const void *payload){
+  (void)*(const volatile uint32_t *)payload;
+}
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Initializes the event bus with the application's topic table.
+ *
+ * @details
+ * The topic index is its position in the table. Topics are delivered in table order and subscribers in list
+ * order, so delivery order never depends on the order of publication.
+ *
+ * @note
+ * This function is called once in app_peripheral_setup() after scheduler_open().
+ *
+ * @param[in] topics
+ * Constant topic table
+ *
+ * @param[in] count
+ * Number of topics
+ *
+ ******************************************************************************/
+void bus_open(const BUS_TOPIC *topics, uint32_t count){
+  EFM_ASSERT(count <= BUS_MAX_TOPICS);
+
+  bus_topics = topics;
+  bus_topic_count = count;
+  for(uint32_t i = 0; i < count; i++){
+      EFM_ASSERT(topics[i].count <= BUS_MAX_SUBSCRIBERS);
+      EFM_ASSERT(topics[i].event != SCHED_NO_EVENT);
+      for(uint32_t j = 0; j < i; j++){
+          EFM_ASSERT(topics[j].event != topics[i].event);
+      }
+      bus_payload[i] = 0;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Publishes a topic.
+ *
+ * @details
+ * The payload is not copied. It must stay valid until the topic is delivered from the main loop. If the topic is
+ * published again before that, only the latest payload is delivered and the publication is counted as coalesced.
+ *
+ * @note
+ * This function may be called from interrupts.
+ *
+ * @param[in] topic
+ * Index of the topic in the topic table
+ *
+ * @param[in] payload
+ * Payload passed to every subscriber
+ *
+ ******************************************************************************/
+void bus_publish(uint32_t topic, const void *payload){
+  EFM_ASSERT(topic < bus_topic_count);
+
+  /* Atomic event */
+  CORE_DECLARE_IRQ_STATE; //Save IRQ state
+  CORE_ENTER_CRITICAL(); //disables interrupts and saves IEN bit
+
+  if(is_scheduled_event(bus_topics[topic].event)){
+      metric_bus_coalesced[topic]++;
+  }
+  bus_payload[topic] = payload;
+  metric_bus_published[topic]++;
+  add_scheduled_event(bus_topics[topic].event);
+
+  CORE_EXIT_CRITICAL(); //Restores interrupt processes
+}
+
+/***************************************************************************//**
+ * @brief
+ * Delivers every pending topic to its subscribers.
+ *
+ * @details
+ * Each topic's event is removed before its subscribers run, so a subscriber may publish the same topic again for
+ * the next pass. The cycles spent delivering are added to the topic's metric.
+ *
+ * @note
+ * This function is the scheduler handler of every topic event.
+ *
+ ******************************************************************************/
+void bus_dispatch(void){
+  for(uint32_t i = 0; i < bus_topic_count; i++){
+      const BUS_TOPIC *topic = &bus_topics[i];
+      if(!is_scheduled_event(topic->event)){
+          continue;
+      }
+      remove_scheduled_event(topic->event);
+
+      uint32_t start = timing_cycles();
+      bus_deliver(topic->subscribers, topic->count, bus_payload[i]);
+      metric_bus_delivery_cycles[i] += timing_cycles_since(start);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Measures the cost of delivering to 0 through BUS_MAX_SUBSCRIBERS subscribers.
+ *
+ * @details
+ * Each point is the average of BUS_BENCH_ROUNDS deliveries. The difference between consecutive points of
+ * bus_fanout_cycles is the cost of one more subscriber, and point 0 is the fixed dispatch cost.
+ *
+ * @note
+ * This function is called in app_peripheral_setup() when BUS_FANOUT_BENCH is defined.
+ *
+ ******************************************************************************/
+void bus_fanout_bench(void){
+  static const BUS_HANDLER bench_subscribers[BUS_MAX_SUBSCRIBERS] = {
+      bus_bench_subscriber, bus_bench_subscriber, bus_bench_subscriber, bus_bench_subscriber,
+      bus_bench_subscriber, bus_bench_subscriber, bus_bench_subscriber, bus_bench_subscriber
+  };
+  static const uint32_t bench_payload = 0;
+
+  for(uint32_t n = 0; n <= BUS_MAX_SUBSCRIBERS; n++){
+      uint32_t start = timing_cycles();
+      for(int round = 0; round < BUS_BENCH_ROUNDS; round++){
+          bus_deliver(bench_subscribers, n, &bench_payload);
+      }
+      metric_bus_fanout_cycles[n] = timing_cycles_since(start) / BUS_BENCH_ROUNDS;
+  }
+}
@@ -0,0 +1,329 @@
+/**
+ * @file
+ * flash.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that erases and programs internal flash in the background and reports completion through the scheduler
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "flash.h"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+// Reserves the storage pages, the linker moves .internal_storage to linker_storage_begin at the end of flash
+static const uint8_t flash_storage_reserve[FLASH_STORAGE_SIZE] __attribute__((section(".internal_storage"), used, aligned(FLASH_PAGE_SIZE)));
+extern uint32_t linker_storage_begin[];
+
+static volatile FLASH_STATE flash_state;
+static uint32_t flash_done_cb;
+static bool flash_failed;               // MSC reported a locked or invalid address on the last operation
+static uint32_t *flash_dest;            // next word to program
+static const uint32_t *flash_src;
+static uint32_t flash_remaining;        // words not yet handed to the LDMA
+static uint32_t flash_segment;          // words in the segment the LDMA is feeding
+static uint32_t flash_start_cycles;
+static LDMA_Descriptor_t flash_descriptor;
+
+METRIC_COUNTER(flash_erases);
+METRIC_COUNTER(flash_words);
+METRIC_COUNTER(flash_errors);
+METRIC_COUNTER(flash_rejected);          // request made while an operation was in progress
+METRIC_HISTOGRAM(flash_op_cycles);       // request to completion
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static void flash_issue_erase(uint32_t *page) FLASH_RAMFUNC;
+static void flash_issue_segment(void) FLASH_RAMFUNC;
+static void flash_segment_done(uint32_t channel);
+static void flash_complete(void);
+
+/***************************************************************************//**
+ * @brief
+ * Starts a page erase.
+ *
+ * @details
+ * Runs from RAM so the instruction fetches between the command and the return do not touch the flash that is
+ * being erased.
+ *
+ ******************************************************************************/
+static void flash_issue_erase(uint32_t *page){
+  MSC->WRITECTRL |= MSC_WRITECTRL_WREN;
+  MSC->ADDRB = (uint32_t)page;
+  MSC->WRITECMD = MSC_WRITECMD_LADDRIM;
+  if(MSC->STATUS & (MSC_STATUS_LOCKED | MSC_STATUS_INVADDR)){
+      flash_failed = true;
+      return;
+  }
+  MSC->IFC = MSC_IF_ERASE;
+  MSC->IEN |= MSC_IEN_ERASE;
+  MSC->WRITECMD = MSC_WRITECMD_ERASEPAGE;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Starts programming the next segment of a write.
+ *
+ * @details
+ * The MSC address auto-increment does not cross a page, so a write is split into one segment per page. The
+ * LDMA copies the segment into WDATA each time the MSC requests a word, and the CPU is free between words.
+ *
+ ******************************************************************************/
+static void flash_issue_segment(void){
+  LDMA_TransferCfg_t config = LDMA_TRANSFER_CFG_PERIPHERAL(FLASH_LDMA_SIGNAL);
+  uint32_t page_left = FLASH_PAGE_WORDS - (((uint32_t)flash_dest % FLASH_PAGE_SIZE) / 4);
+
+  flash_segment = flash_remaining < page_left ? flash_remaining : page_left;
+
+  MSC->WRITECTRL |= MSC_WRITECTRL_WREN;
+  MSC->ADDRB = (uint32_t)flash_dest;
+  MSC->WRITECMD = MSC_WRITECMD_LADDRIM;
+  if(MSC->STATUS & (MSC_STATUS_LOCKED | MSC_STATUS_INVADDR)){
+      flash_failed = true;
+      return;
+  }
+
+  flash_descriptor = (LDMA_Descriptor_t)LDMA_DESCRIPTOR_SINGLE_M2P_BYTE(flash_src, &MSC->WDATA, flash_segment);
+  flash_descriptor.xfer.size = ldmaCtrlSizeWord;
+  flash_state = flash_writing;
+  ldma_start(LDMA_CH_FLASH, &config, &flash_descriptor, flash_segment_done);
+  MSC->WRITECMD = MSC_WRITECMD_WRITETRIG;
+}
+
+/***************************************************************************//**
+ * @brief
+ * LDMA completion function, called in interrupt context when the last word of a segment is in WDATA.
+ *
+ * @details
+ * The MSC is still programming that word. The WRITE interrupt is enabled to catch the end of it, unless it
+ * already finished.
+ *
+ ******************************************************************************/
+static void flash_segment_done(uint32_t channel){
+  (void)channel;
+
+  flash_dest += flash_segment;
+  flash_src += flash_segment;
+  flash_remaining -= flash_segment;
+  METRIC_ADD(flash_words, flash_segment);
+
+  flash_state = flash_draining;
+  MSC->IFC = MSC_IF_WRITE;
+  MSC->IEN |= MSC_IEN_WRITE;
+  if(!(MSC->STATUS & MSC_STATUS_BUSY)){
+      MSC->IEN &= ~MSC_IEN_WRITE;
+      MSC_IRQHandler();
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Ends the current operation and schedules the completion event.
+ ******************************************************************************/
+static void flash_complete(void){
+  MSC->IEN &= ~(MSC_IEN_ERASE | MSC_IEN_WRITE);
+  MSC->WRITECMD = MSC_WRITECMD_WRITEEND;
+  MSC->WRITECTRL &= ~MSC_WRITECTRL_WREN;
+  MSC->LOCK = 0;
+
+  if(flash_failed){
+      METRIC_INC(flash_errors);
+  }
+  METRIC_HIST(flash_op_cycles, timing_cycles_since(flash_start_cycles));
+
+  flash_state = flash_idle;
+  sleep_unblock_mode(FLASH_EM_BLOCK);
+  if(flash_done_cb){
+      add_scheduled_event(flash_done_cb);
+  }
+}
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Opens the flash engine.
+ *
+ * @details
+ * Erase and write requests return immediately. Writes are fed to the MSC by the LDMA one word at a time, so
+ * interrupts and the main loop keep running between words and only stall while fetching from flash during
+ * the word itself. A page erase stalls flash fetches for the whole erase, up to FLASH_ERASE_MAX_MS, so callers
+ * issue it only when nothing is due for that long.
+ *
+ * @note
+ * This function is called once in app_peripheral_setup().
+ *
+ * @param[in] done_cb
+ * Event scheduled when an erase or write is complete
+ *
+ ******************************************************************************/
+void flash_open(uint32_t done_cb){
+  ldma_open();
+
+  flash_state = flash_idle;
+  flash_done_cb = done_cb;
+  flash_failed = false;
+
+  MSC->IFC = MSC_IF_ERASE | MSC_IF_WRITE;
+  NVIC_EnableIRQ(MSC_IRQn);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Starts erasing a page.
+ *
+ * @param[in] page
+ * First word of the page, page aligned
+ *
+ * @return
+ * False if an operation is already in progress
+ *
+ ******************************************************************************/
+bool flash_erase(uint32_t *page){
+  EFM_ASSERT(!((uint32_t)page % FLASH_PAGE_SIZE));
+
+  /* Atomic event */
+  CORE_DECLARE_IRQ_STATE; //Save IRQ state
+  CORE_ENTER_CRITICAL(); //disables interrupts and saves IEN bit
+
+  if(flash_state != flash_idle){
+      METRIC_INC(flash_rejected);
+      CORE_EXIT_CRITICAL(); //Restores interrupt processes
+      return false;
+  }
+  flash_state = flash_erasing;
+  CORE_EXIT_CRITICAL(); //Restores interrupt processes
+
+  flash_failed = false;
+  flash_start_cycles = timing_cycles();
+  sleep_block_mode(FLASH_EM_BLOCK);
+  METRIC_INC(flash_erases);
+
+  MSC->LOCK = MSC_UNLOCK_CODE;
+  flash_issue_erase(page);
+
+  if(flash_failed){
+      flash_complete();
+  }
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Starts programming words into erased flash.
+ *
+ * @details
+ * The source is read by the LDMA while the write is in progress and must not change until the completion
+ * event.
+ *
+ * @param[in] dest
+ * Destination in flash, word aligned
+ *
+ * @param[in] src
+ * Words to program
+ *
+ * @param[in] words
+ * Number of words
+ *
+ * @return
+ * False if an operation is already in progress
+ *
+ ******************************************************************************/
+bool flash_write(uint32_t *dest, const uint32_t *src, uint32_t words){
+  EFM_ASSERT(words);
+
+  /* Atomic event */
+  CORE_DECLARE_IRQ_STATE; //Save IRQ state
+  CORE_ENTER_CRITICAL(); //disables interrupts and saves IEN bit
+
+  if(flash_state != flash_idle){
+      METRIC_INC(flash_rejected);
+      CORE_EXIT_CRITICAL(); //Restores interrupt processes
+      return false;
+  }
+  flash_state = flash_writing;
+  CORE_EXIT_CRITICAL(); //Restores interrupt processes
+
+  flash_failed = false;
+  flash_dest = dest;
+  flash_src = src;
+  flash_remaining = words;
+  flash_start_cycles = timing_cycles();
+  sleep_block_mode(FLASH_EM_BLOCK);
+
+  MSC->LOCK = MSC_UNLOCK_CODE;
+  flash_issue_segment();
+
+  if(flash_failed){
+      flash_complete();
+  }
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns true while an erase or write is in progress.
+ ******************************************************************************/
+bool flash_busy(void){
+  return flash_state != flash_idle;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns true if the last operation was refused by the MSC (locked page or invalid address).
+ ******************************************************************************/
+bool flash_error(void){
+  return flash_failed;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the first word of the storage pages reserved for application data.
+ ******************************************************************************/
+uint32_t *flash_storage(void){
+  (void)flash_storage_reserve;
+  return linker_storage_begin;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Interrupt handler for the MSC
+ *
+ * @details
+ * ERASE ends an erase. WRITE is only enabled once the LDMA has handed over the last word of a segment, so it
+ * ends the segment; the next segment is started or the write is complete.
+ *
+ ******************************************************************************/
+void MSC_IRQHandler(void){
+  uint32_t int_flag = MSC->IF & MSC->IEN;
+  MSC->IFC = int_flag;
+
+  if(flash_state == flash_erasing){
+      flash_complete();
+  }
+  else if(flash_state == flash_draining){
+      if(MSC->STATUS & MSC_STATUS_BUSY){
+          return;
+      }
+      MSC->IEN &= ~MSC_IEN_WRITE;
+      if(flash_remaining && !flash_failed){
+          flash_issue_segment();
+      }
+      if(!flash_remaining || flash_failed){
+          flash_complete();
+      }
+  }
+}
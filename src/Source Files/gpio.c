@@ -6,7 +6,7 @@
  * @date
  * 9/23/21
  * @brief
- * Sets up the LED output pins for use
+ * Sets up the LED, RGB and Si1133 pins for use and switches them between pin-state profiles
  *
  */
 
@@ -18,16 +18,106 @@
 //***********************************************************************************
 // defined files
 //***********************************************************************************
+#define GPIO_PORT_COUNT   (GPIO_PORT_MAX + 1)
 
 
 //***********************************************************************************
 // global variables
 //***********************************************************************************
+typedef struct {
+  GPIO_Port_TypeDef   port;
+  uint32_t            pin;
+  GPIO_Mode_TypeDef   mode[GPIO_PROFILE_COUNT];   // mode per profile
+  uint8_t             level[GPIO_PROFILE_COUNT];  // output level per profile, or GPIO_LEVEL_KEEP
+} GPIO_PROFILE_PIN;
+
+typedef struct {
+  uint32_t  model;        // MODEL register image of the managed pins
+  uint32_t  modeh;        // MODEH register image of the managed pins
+  uint32_t  dout;         // DOUT image of the pins with a fixed level
+  uint32_t  dout_mask;    // pins with a fixed level in this profile
+} GPIO_PORT_IMAGE;
+
+// Managed pins and their state in the active, sleep and shipping profiles.
+// LED levels are kept in sleep so an indicator that is lit stays lit; only pins that can leak are changed.
+static const GPIO_PROFILE_PIN profile_pins[] = {
+  { LED_RED_PORT,          LED_RED_PIN,          { LED_RED_GPIOMODE,   LED_RED_GPIOMODE,   gpioModeDisabled }, { GPIO_LEVEL_KEEP, GPIO_LEVEL_KEEP, 0 } },
+  { LED_GREEN_PORT,        LED_GREEN_PIN,        { LED_GREEN_GPIOMODE, LED_GREEN_GPIOMODE, gpioModeDisabled }, { GPIO_LEVEL_KEEP, GPIO_LEVEL_KEEP, 0 } },
+  { RGB_ENABLE_PORT,       RGB_ENABLE_PIN,       { gpioModePushPull,   gpioModePushPull,   gpioModeDisabled }, { GPIO_LEVEL_KEEP, GPIO_LEVEL_KEEP, 0 } },
+  { RGB0_PORT,             RGB0_PIN,             { gpioModePushPull,   gpioModePushPull,   gpioModeDisabled }, { GPIO_LEVEL_KEEP, GPIO_LEVEL_KEEP, 0 } },
+  { RGB1_PORT,             RGB1_PIN,             { gpioModePushPull,   gpioModePushPull,   gpioModeDisabled }, { GPIO_LEVEL_KEEP, GPIO_LEVEL_KEEP, 0 } },
+  { RGB2_PORT,             RGB2_PIN,             { gpioModePushPull,   gpioModePushPull,   gpioModeDisabled }, { GPIO_LEVEL_KEEP, GPIO_LEVEL_KEEP, 0 } },
+  { RGB3_PORT,             RGB3_PIN,             { gpioModePushPull,   gpioModePushPull,   gpioModeDisabled }, { GPIO_LEVEL_KEEP, GPIO_LEVEL_KEEP, 0 } },
+  { RGB_RED_PORT,          RGB_RED_PIN,          { gpioModePushPull,   gpioModePushPull,   gpioModeDisabled }, { GPIO_LEVEL_KEEP, GPIO_LEVEL_KEEP, 0 } },
+  { RGB_GREEN_PORT,        RGB_GREEN_PIN,        { gpioModePushPull,   gpioModePushPull,   gpioModeDisabled }, { GPIO_LEVEL_KEEP, GPIO_LEVEL_KEEP, 0 } },
+  { RGB_BLUE_PORT,         RGB_BLUE_PIN,         { gpioModePushPull,   gpioModePushPull,   gpioModeDisabled }, { GPIO_LEVEL_KEEP, GPIO_LEVEL_KEEP, 0 } },
+  { SI1133_SENSOR_EN_PORT, SI1133_SENSOR_EN_PIN, { gpioModePushPull,   gpioModePushPull,   gpioModePushPull }, { SI1133_SENSOR_EN_DEFAULT, SI1133_SENSOR_EN_DEFAULT, 0 } },
+  { SI1133_SCL_PORT,       SI1133_SCL_PIN,       { gpioModeWiredAnd,   gpioModeDisabled,   gpioModeDisabled }, { SI1133_SCL_DEFAULT, GPIO_LEVEL_KEEP, 0 } },
+  { SI1133_SDA_PORT,       SI1133_SDA_PIN,       { gpioModeWiredAnd,   gpioModeDisabled,   gpioModeDisabled }, { SI1133_SDA_DEFAULT, GPIO_LEVEL_KEEP, 0 } },
+};
+
+#define PROFILE_PIN_COUNT   (sizeof(profile_pins) / sizeof(profile_pins[0]))
+
+static GPIO_PORT_IMAGE port_images[GPIO_PROFILE_COUNT][GPIO_PORT_COUNT];
+static uint32_t port_mode_masks[GPIO_PORT_COUNT][2];   // MODEL/MODEH bits owned by the profiles
+static GPIO_PROFILE current_profile;
+static GPIO_PROFILE sleep_profile;
+static GPIO_PROFILE_STATS profile_stats[GPIO_PROFILE_COUNT];
 
 
 //***********************************************************************************
 // function prototypes
 //***********************************************************************************
+static void gpio_profile_build(void);
+static uint32_t gpio_mode_diff(uint32_t cur, uint32_t next, uint32_t mask);
+
+/***************************************************************************//**
+ * @brief
+ * Builds the per-port register images of every profile from the profile pin table.
+ *
+ * @details
+ * Each pin contributes a 4-bit mode field to MODEL (pins 0-7) or MODEH (pins 8-15) and optionally a DOUT bit.
+ * Building the images once lets a profile switch be done with a single masked write per register per port.
+ *
+ ******************************************************************************/
+static void gpio_profile_build(void){
+  for(uint32_t i = 0; i < PROFILE_PIN_COUNT; i++){
+      const GPIO_PROFILE_PIN *p = &profile_pins[i];
+      uint32_t high = p->pin >= 8;
+      uint32_t shift = (p->pin & 0x7) * GPIO_MODE_BITS;
+
+      port_mode_masks[p->port][high] |= 0xFu << shift;
+      for(int prof = 0; prof < GPIO_PROFILE_COUNT; prof++){
+          GPIO_PORT_IMAGE *img = &port_images[prof][p->port];
+          if(high){
+              img->modeh |= (uint32_t)p->mode[prof] << shift;
+          }else{
+              img->model |= (uint32_t)p->mode[prof] << shift;
+          }
+          if(p->level[prof] != GPIO_LEVEL_KEEP){
+              img->dout_mask |= 1u << p->pin;
+              img->dout |= (uint32_t)(p->level[prof] ? 1 : 0) << p->pin;
+          }
+      }
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the mask of the 4-bit mode fields that differ between two mode register values.
+ *
+ ******************************************************************************/
+static uint32_t gpio_mode_diff(uint32_t cur, uint32_t next, uint32_t mask){
+  uint32_t diff = (cur ^ next) & mask;
+  uint32_t field_mask = 0;
+
+  for(uint32_t shift = 0; shift < 32; shift += GPIO_MODE_BITS){
+      if(diff & (0xFu << shift)){
+          field_mask |= 0xFu << shift;
+      }
+  }
+  return field_mask;
+}
 
 
 //***********************************************************************************
@@ -76,4 +166,117 @@ void gpio_open(void){
   GPIO_PinModeSet(SI1133_SCL_PORT, SI1133_SCL_PIN, gpioModeWiredAnd, SI1133_SCL_DEFAULT);
   GPIO_PinModeSet(SI1133_SDA_PORT, SI1133_SDA_PIN, gpioModeWiredAnd, SI1133_SDA_DEFAULT);
 
+  //Configure LEUART pins on the virtual COM port
+  GPIO_PinModeSet(VCOM_ENABLE_PORT, VCOM_ENABLE_PIN, gpioModePushPull, VCOM_ENABLE_DEFAULT);
+  GPIO_PinModeSet(LEUART_TX_PORT, LEUART_TX_PIN, gpioModePushPull, LEUART_TX_DEFAULT);
+  GPIO_PinModeSet(LEUART_RX_PORT, LEUART_RX_PIN, gpioModeInput, LEUART_RX_DEFAULT);
+
+  //Build the pin-state profiles, the pins are now in the active profile
+  gpio_profile_build();
+  current_profile = gpio_profile_active;
+  sleep_profile = gpio_profile_sleep;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Switches the managed pins to a pin-state profile.
+ *
+ * @details
+ * For each port, the mode fields and output levels of the new profile are compared against the port registers
+ * and only the pins that differ are rewritten, with at most one masked write to DOUT, MODEL and MODEH per port.
+ * DOUT is written before the mode so that a pin becoming an output drives its new level from the first cycle.
+ *
+ * @note
+ * This function is called by enter_sleep() around EM2/EM3 with interrupts disabled, and can be called by the
+ * application to enter the shipping profile.
+ *
+ * @param[in] profile
+ * Profile to switch to
+ *
+ ******************************************************************************/
+void gpio_profile_set(GPIO_PROFILE profile){
+  uint32_t start = timing_cycles();
+  uint32_t touched = 0;
+
+  EFM_ASSERT(profile < GPIO_PROFILE_COUNT);
+
+  for(int port = 0; port < GPIO_PORT_COUNT; port++){
+      const GPIO_PORT_IMAGE *img = &port_images[profile][port];
+      if(!(port_mode_masks[port][0] | port_mode_masks[port][1])){
+          continue; //no managed pins on this port
+      }
+
+      uint32_t dout_diff = (GPIO->P[port].DOUT ^ img->dout) & img->dout_mask;
+      if(dout_diff){
+          GPIO_PortOutSetVal((GPIO_Port_TypeDef)port, img->dout, dout_diff);
+          touched += __builtin_popcount(dout_diff);
+      }
+
+      uint32_t model = GPIO->P[port].MODEL;
+      uint32_t model_diff = gpio_mode_diff(model, img->model, port_mode_masks[port][0]);
+      if(model_diff){
+          GPIO->P[port].MODEL = (model & ~model_diff) | (img->model & model_diff);
+          touched += __builtin_popcount(model_diff) / GPIO_MODE_BITS;
+      }
+
+      uint32_t modeh = GPIO->P[port].MODEH;
+      uint32_t modeh_diff = gpio_mode_diff(modeh, img->modeh, port_mode_masks[port][1]);
+      if(modeh_diff){
+          GPIO->P[port].MODEH = (modeh & ~modeh_diff) | (img->modeh & modeh_diff);
+          touched += __builtin_popcount(modeh_diff) / GPIO_MODE_BITS;
+      }
+  }
+
+  current_profile = profile;
+  profile_stats[profile].entries++;
+  profile_stats[profile].pins_touched += touched;
+  profile_stats[profile].switch_cycles = timing_cycles_since(start);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the pin-state profile that is currently applied.
+ *
+ ******************************************************************************/
+GPIO_PROFILE gpio_profile_get(void){
+  return current_profile;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Selects the profile that enter_sleep() applies while in EM2/EM3.
+ *
+ * @details
+ * The sleep profile is used by default. Selecting another profile lets the EM2/EM3 floor current of each
+ * profile be read off the Energy Profiler (see GPIO_LEAKAGE_CHARACTERIZE in app.h).
+ *
+ * @param[in] profile
+ * Profile to apply while sleeping
+ *
+ ******************************************************************************/
+void gpio_profile_sleep_select(GPIO_PROFILE profile){
+  EFM_ASSERT(profile < GPIO_PROFILE_COUNT);
+  sleep_profile = profile;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the profile that enter_sleep() applies while in EM2/EM3.
+ *
+ ******************************************************************************/
+GPIO_PROFILE gpio_profile_sleep_get(void){
+  return sleep_profile;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the switch statistics of a profile.
+ *
+ * @param[in] profile
+ * Profile to return the statistics of
+ *
+ ******************************************************************************/
+const GPIO_PROFILE_STATS *gpio_profile_stats(GPIO_PROFILE profile){
+  EFM_ASSERT(profile < GPIO_PROFILE_COUNT);
+  return &profile_stats[profile];
 }
@@ -0,0 +1,515 @@
+/**
+ * @file
+ * history.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that keeps a downsampled history of the light level in flash, compacting it in idle time
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "history.h"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+static HISTORY_RING history_rings[HISTORY_TIERS];
+static HISTORY_CLOCK history_clock;
+static uint32_t history_job_id;
+
+// Minute in progress, built from the sample log
+static uint32_t history_seq;              // next sample to aggregate
+static HISTORY_ACC history_minute;
+static uint32_t history_minute_ms;        // time into the minute in progress
+static uint32_t history_last_timestamp;   // timestamp of the last sample aggregated
+static bool history_minute_ready;         // history_minute_record waits for a flash write
+static HISTORY_RECORD history_minute_record;
+
+// Compaction of a minute page into hours
+static uint32_t history_compact_page;     // ring page being merged, HISTORY_NO_PAGE if there is none
+static bool history_compacted;            // its hours are in history_hour_queue
+static HISTORY_RECORD history_hour_queue[HISTORY_PAGE_HOURS];
+static uint32_t history_hour_count;
+static uint32_t history_hour_next;        // next queued hour to write
+static uint32_t history_last_hour;        // minute of the newest hour record, HISTORY_FREE if there is none
+
+static HISTORY_RECORD history_write_buffer;   // read by the LDMA until the write completes
+
+METRIC_COUNTER(history_minutes_written);
+METRIC_COUNTER(history_hours_written);
+METRIC_COUNTER(history_hours_dropped);    // hour records erased at the end of retention
+METRIC_COUNTER(history_samples_missed);   // samples overwritten in the sample log before they were aggregated
+METRIC_COUNTER(history_words_written);
+METRIC_COUNTER(history_erases);
+METRIC_COUNTER(history_erases_deferred);  // erases put off as they would run into the next LETIMER deadline
+METRIC_COUNTER(history_flash_errors);
+METRIC_DECLARE(history_page_erases, metric_counter, FLASH_STORAGE_PAGES);   // wear of each storage page since reset
+METRIC_COUNTER(history_cycles);           // CPU time of the idle job
+METRIC_GAUGE(history_unit_cycles_max);
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static const HISTORY_RECORD *history_records(HISTORY_TIER tier, uint32_t page);
+static uint32_t history_page_used(HISTORY_TIER tier, uint32_t page);
+static void history_acc_start(HISTORY_ACC *acc, uint32_t minute);
+static void history_acc_add(HISTORY_ACC *acc, uint32_t min, uint32_t max, uint64_t sum, uint32_t count);
+static void history_acc_record(const HISTORY_ACC *acc, HISTORY_RECORD *record);
+static uint32_t history_ring_scan(HISTORY_TIER tier);
+static bool history_erase(HISTORY_TIER tier, uint32_t page);
+static void history_write(HISTORY_TIER tier, const HISTORY_RECORD *record);
+static bool history_room(HISTORY_TIER tier, uint32_t minute);
+static bool history_due(void);
+static void history_compact(void);
+static bool history_collect(void);
+static bool history_step(void);
+static bool history_job(void);
+
+/***************************************************************************//**
+ * @brief
+ * Returns the records of a ring page.
+ ******************************************************************************/
+static const HISTORY_RECORD *history_records(HISTORY_TIER tier, uint32_t page){
+  return (const HISTORY_RECORD *)(flash_storage() + (history_rings[tier].first_page + page) * FLASH_PAGE_WORDS);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the number of records written to a ring page.
+ *
+ * @details
+ * Records are written in order from the start of an erased page, so the first erased one ends the page.
+ ******************************************************************************/
+static uint32_t history_page_used(HISTORY_TIER tier, uint32_t page){
+  const HISTORY_RECORD *records = history_records(tier, page);
+  uint32_t used = 0;
+
+  while(used < HISTORY_PAGE_RECORDS && records[used].minute != HISTORY_FREE){
+      used++;
+  }
+  return used;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Starts an empty aggregate.
+ ******************************************************************************/
+static void history_acc_start(HISTORY_ACC *acc, uint32_t minute){
+  acc->minute = minute;
+  acc->min = 0xFFFF;
+  acc->max = 0;
+  acc->sum = 0;
+  acc->count = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Adds samples to an aggregate, a single sample or a whole record.
+ ******************************************************************************/
+static void history_acc_add(HISTORY_ACC *acc, uint32_t min, uint32_t max, uint64_t sum, uint32_t count){
+  if(min < acc->min){
+      acc->min = min;
+  }
+  if(max > acc->max){
+      acc->max = max;
+  }
+  acc->sum += sum;
+  acc->count += count;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Converts an aggregate with at least one sample to the record stored for it.
+ ******************************************************************************/
+static void history_acc_record(const HISTORY_ACC *acc, HISTORY_RECORD *record){
+  EFM_ASSERT(acc->count);
+  record->minute = acc->minute;
+  record->min = acc->min;
+  record->max = acc->max;
+  record->mean = (acc->sum + acc->count / 2) / acc->count;
+  record->count = acc->count > 0xFFFF ? 0xFFFF : acc->count;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Finds the newest record of a ring and returns the last minute it covers.
+ *
+ * @details
+ * Minutes only increase, so the page whose first record is the latest holds the newest record and the next
+ * record is written after it.
+ *
+ * @return
+ * Last minute covered, HISTORY_FREE if the ring is empty
+ ******************************************************************************/
+static uint32_t history_ring_scan(HISTORY_TIER tier){
+  HISTORY_RING *ring = &history_rings[tier];
+  uint32_t newest = HISTORY_FREE;
+
+  ring->write_page = 0;
+  ring->write_slot = 0;
+  for(uint32_t page = 0; page < ring->pages; page++){
+      uint32_t first = history_records(tier, page)[0].minute;
+      if(first != HISTORY_FREE && (newest == HISTORY_FREE || first > newest)){
+          newest = first;
+          ring->write_page = page;
+      }
+  }
+  if(newest == HISTORY_FREE){
+      return HISTORY_FREE;
+  }
+
+  ring->write_slot = history_page_used(tier, ring->write_page);
+  newest = history_records(tier, ring->write_page)[ring->write_slot - 1].minute;
+  return tier == history_hours ? newest + 59 : newest;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Starts erasing a ring page and counts the wear.
+ *
+ * @details
+ * An erase stalls every flash fetch, interrupt handlers included, for up to FLASH_ERASE_MAX_MS. It is only
+ * started when the next LETIMER deadline is further away than that, so the COMP1 FORCE and the underflow read
+ * of the sample are not held up. history_poll() posts the job after the next sample, which leaves nearly a
+ * whole period for the erase. In SYNC_INPUT_MODE the LETIMER does not run and the next edge cannot be
+ * predicted, so the erase is started right away.
+ *
+ * @return
+ * True if the erase was started, false if it was put off
+ ******************************************************************************/
+static bool history_erase(HISTORY_TIER tier, uint32_t page){
+  uint32_t storage_page = history_rings[tier].first_page + page;
+
+  if(letimer_ticks_to_next_event(LETIMER0) < letimer_ms_to_ticks(LETIMER0, FLASH_ERASE_MAX_MS)){
+      METRIC_INC(history_erases_deferred);
+      return false;
+  }
+  flash_erase(flash_storage() + storage_page * FLASH_PAGE_WORDS);
+  METRIC_INC(history_erases);
+  metric_history_page_erases[storage_page]++;
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Starts writing a record to the next free slot of a ring.
+ *
+ * @note
+ * history_room() has to be true for the record first.
+ ******************************************************************************/
+static void history_write(HISTORY_TIER tier, const HISTORY_RECORD *record){
+  HISTORY_RING *ring = &history_rings[tier];
+  const HISTORY_RECORD *slot = &history_records(tier, ring->write_page)[ring->write_slot];
+
+  history_write_buffer = *record;
+  flash_write((uint32_t *)slot, (const uint32_t *)&history_write_buffer, HISTORY_RECORD_WORDS);
+  ring->write_slot++;
+  METRIC_ADD(history_words_written, HISTORY_RECORD_WORDS);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Makes room for the next record of a ring.
+ *
+ * @details
+ * A record goes to the next page once the write page is full, or for minutes once the record is from another
+ * window of HISTORY_PAGE_MINUTES, so a minute page always merges into whole hours. The next page is the oldest
+ * one. If it is not erased, the hour ring starts erasing it, which drops the oldest hours, and the minute ring
+ * selects it for compaction.
+ *
+ * @param[in] tier
+ * Ring the record is for
+ *
+ * @param[in] minute
+ * First minute of the record
+ *
+ * @return
+ * True if the record can be written now, false if a flash erase was started or put off, or a compaction is
+ * needed first
+ ******************************************************************************/
+static bool history_room(HISTORY_TIER tier, uint32_t minute){
+  HISTORY_RING *ring = &history_rings[tier];
+  const HISTORY_RECORD *records = history_records(tier, ring->write_page);
+  bool full = ring->write_slot >= HISTORY_PAGE_RECORDS;
+
+  if(tier == history_minutes && ring->write_slot){
+      full = full || records[0].minute / HISTORY_PAGE_MINUTES != minute / HISTORY_PAGE_MINUTES;
+  }
+  if(!full){
+      return true;
+  }
+
+  uint32_t next = (ring->write_page + 1) % ring->pages;
+  uint32_t used = history_page_used(tier, next);
+  if(used){
+      if(tier == history_hours){
+          if(history_erase(tier, next)){
+              METRIC_ADD(history_hours_dropped, used);
+          }
+      }else{
+          history_compact_page = next;
+      }
+      return false;
+  }
+  ring->write_page = next;
+  ring->write_slot = 0;
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Selects the oldest minute page for compaction once its window is older than HISTORY_MINUTE_AGE.
+ *
+ * @return
+ * True if a page was selected
+ ******************************************************************************/
+static bool history_due(void){
+  HISTORY_RING *ring = &history_rings[history_minutes];
+
+  for(uint32_t i = 1; i < ring->pages; i++){
+      uint32_t page = (ring->write_page + i) % ring->pages;
+      uint32_t first = history_records(history_minutes, page)[0].minute;
+      if(first != HISTORY_FREE){
+          uint32_t window_end = first - first % HISTORY_PAGE_MINUTES + HISTORY_PAGE_MINUTES;
+          if(window_end + HISTORY_MINUTE_AGE <= history_minute.minute){
+              history_compact_page = page;
+              return true;
+          }
+          return false;
+      }
+  }
+  return false;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Merges the minutes of the page selected for compaction into hour records.
+ *
+ * @details
+ * Hours already stored are skipped, they were merged before a reset interrupted the erase of the page. The
+ * mean of an hour is the mean of its minutes weighted by their samples.
+ ******************************************************************************/
+static void history_compact(void){
+  const HISTORY_RECORD *records = history_records(history_minutes, history_compact_page);
+  uint32_t used = history_page_used(history_minutes, history_compact_page);
+  HISTORY_ACC hour = { 0 };
+
+  history_hour_count = 0;
+  history_hour_next = 0;
+  for(uint32_t slot = 0; slot < used; slot++){
+      uint32_t start = records[slot].minute - records[slot].minute % 60;
+      if(history_last_hour != HISTORY_FREE && start <= history_last_hour){
+          continue;
+      }
+      if(hour.count && start != hour.minute){
+          history_acc_record(&hour, &history_hour_queue[history_hour_count++]);
+          hour.count = 0;
+      }
+      if(!hour.count){
+          history_acc_start(&hour, start);
+      }
+      history_acc_add(&hour, records[slot].min, records[slot].max, (uint64_t)records[slot].mean * records[slot].count, records[slot].count);
+  }
+  if(hour.count){
+      history_acc_record(&hour, &history_hour_queue[history_hour_count++]);
+  }
+  history_compacted = true;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Aggregates samples of the sample log into the minute in progress.
+ *
+ * @details
+ * Time is followed by the difference between consecutive timestamps, so a timestamp that wraps or restarts
+ * after a reset does not move the history back. A minute is complete once a sample of a later minute arrives.
+ *
+ * @return
+ * True if a minute is ready or more samples are waiting
+ ******************************************************************************/
+static bool history_collect(void){
+  SAMPLE_RECORD record;
+
+  for(uint32_t i = 0; i < HISTORY_SAMPLES_PER_UNIT; i++){
+      if(history_seq < sample_log_oldest()){
+          METRIC_ADD(history_samples_missed, sample_log_oldest() - history_seq);
+          history_seq = sample_log_oldest();
+      }
+      if(!sample_log_get(history_seq, &record)){
+          return false;
+      }
+      history_seq++;
+
+      if(history_minute.count){
+          history_minute_ms += history_clock(record.timestamp - history_last_timestamp);
+      }
+      history_last_timestamp = record.timestamp;
+      if(history_minute_ms >= 60000){
+          uint32_t minute = history_minute.minute + history_minute_ms / 60000;
+          history_minute_ms %= 60000;
+          history_acc_record(&history_minute, &history_minute_record);
+          history_minute_ready = true;
+          history_acc_start(&history_minute, minute);
+      }
+      history_acc_add(&history_minute, record.code, record.code, record.code, 1);
+      if(history_minute_ready){
+          return true;
+      }
+  }
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Performs one unit of history work.
+ *
+ * @details
+ * At most one flash operation is started per unit. While it runs the job has no work, the flash done callback
+ * posts it again. An erase that would run into the next LETIMER deadline leaves the job without work until
+ * history_poll() posts it after the next sample. Queued hours are written first, then the page they came from is erased, then the minute
+ * waiting for its write is stored and finally more samples are aggregated.
+ *
+ * @return
+ * True while work remains without waiting for the flash
+ ******************************************************************************/
+static bool history_step(void){
+  if(flash_busy()){
+      return false;
+  }
+
+  if(history_compact_page != HISTORY_NO_PAGE){
+      if(!history_compacted){
+          history_compact();
+          return true;
+      }
+      if(history_hour_next < history_hour_count){
+          HISTORY_RECORD *hour = &history_hour_queue[history_hour_next];
+          if(history_room(history_hours, hour->minute)){
+              history_write(history_hours, hour);
+              history_last_hour = hour->minute;
+              history_hour_next++;
+              METRIC_INC(history_hours_written);
+          }
+          return false;
+      }
+      if(!history_erase(history_minutes, history_compact_page)){
+          return false;
+      }
+      history_compact_page = HISTORY_NO_PAGE;
+      history_compacted = false;
+      return false;
+  }
+
+  if(history_minute_ready){
+      if(!history_room(history_minutes, history_minute_record.minute)){
+          return true;
+      }
+      history_write(history_minutes, &history_minute_record);
+      history_minute_ready = false;
+      METRIC_INC(history_minutes_written);
+      return false;
+  }
+
+  if(history_due()){
+      return true;
+  }
+  return history_collect();
+}
+
+/***************************************************************************//**
+ * @brief
+ * Idle job of the history, measures the CPU time of each unit.
+ ******************************************************************************/
+static bool history_job(void){
+  uint32_t start = timing_cycles();
+  bool more = history_step();
+  uint32_t cycles = timing_cycles_since(start);
+
+  METRIC_ADD(history_cycles, cycles);
+  METRIC_MAX(history_unit_cycles_max, cycles);
+  return more;
+}
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Finds the newest records in flash and registers the history idle job.
+ *
+ * @details
+ * The first minute after a reset follows the newest minute or hour stored. Samples already in the sample log
+ * are not aggregated again, the minute in progress at a reset is lost.
+ *
+ * @note
+ * This function is called once in app_peripheral_setup() after idle_work_open(), sample_log_open() and
+ * flash_open(). Nothing else may use the flash storage pages.
+ *
+ * @param[in] clock
+ * Converts a difference of sample log timestamps to ms
+ *
+ ******************************************************************************/
+void history_open(HISTORY_CLOCK clock){
+  uint32_t last_minute;
+  uint32_t last_hour;
+
+  EFM_ASSERT(clock && sizeof(HISTORY_RECORD) == HISTORY_RECORD_WORDS * 4);
+  EFM_ASSERT(HISTORY_PAGE_MINUTES <= HISTORY_PAGE_RECORDS && HISTORY_HOUR_PAGES >= 2);
+  EFM_ASSERT((HISTORY_MINUTE_AGE + HISTORY_PAGE_MINUTES) / HISTORY_PAGE_MINUTES < HISTORY_MINUTE_PAGES);
+
+  history_clock = clock;
+  history_rings[history_minutes] = (HISTORY_RING){ .first_page = 0, .pages = HISTORY_MINUTE_PAGES };
+  history_rings[history_hours] = (HISTORY_RING){ .first_page = HISTORY_MINUTE_PAGES, .pages = HISTORY_HOUR_PAGES };
+  last_minute = history_ring_scan(history_minutes);
+  last_hour = history_ring_scan(history_hours);
+  history_last_hour = last_hour == HISTORY_FREE ? HISTORY_FREE : last_hour - 59;
+
+  if(last_minute == HISTORY_FREE || (last_hour != HISTORY_FREE && last_hour > last_minute)){
+      last_minute = last_hour;
+  }
+  history_acc_start(&history_minute, last_minute == HISTORY_FREE ? 0 : last_minute + 1);
+  history_minute_ms = 0;
+  history_minute_ready = false;
+  history_compact_page = HISTORY_NO_PAGE;
+  history_compacted = false;
+  history_seq = sample_log_next();
+
+  history_job_id = idle_work_register("history", history_job);
+  idle_work_post(history_job_id);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Lets the history aggregate newly logged samples.
+ *
+ * @note
+ * This function is called after samples are appended to the sample log.
+ *
+ ******************************************************************************/
+void history_poll(void){
+  idle_work_post(history_job_id);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Continues the history once a flash erase or write completes.
+ *
+ * @note
+ * This function is called from the flash done scheduled callback.
+ *
+ ******************************************************************************/
+void history_flash_done(void){
+  if(flash_error()){
+      METRIC_INC(history_flash_errors);
+  }
+  idle_work_post(history_job_id);
+}
@@ -19,11 +19,124 @@
 // Private Variables
 //***********************************************************************************
 static I2C_STATE_MACHINE i2c0_state, i2c1_state;
+METRIC_COUNTER(i2c_transactions);
+METRIC_COUNTER(i2c_bytes);
+METRIC_COUNTER(i2c_busy_waits);     // i2c_start() had to wait for the previous transaction
+METRIC_HISTOGRAM(i2c_transaction_cycles);
+METRIC_COUNTER(i2c_busy_cycles);    // total cycles from START to MSTOP, bus utilization
+METRIC_HISTOGRAM(i2c_isr_cycles);         // I2C1 handler time with the flash idle
+METRIC_HISTOGRAM(i2c_isr_flash_cycles);   // I2C1 handler time while a flash erase or write is in progress
+METRIC_COUNTER(i2c_isr_total_cycles);     // all I2C1 handler time, CPU cost of interrupt execution
+METRIC_COUNTER(i2c_poll_nacks);           // polled transactions abandoned because the device did not acknowledge
+METRIC_DECLARE(i2c_exec_count, metric_counter, I2C_EXEC_MODES);     // transactions run in each mode
+METRIC_DECLARE(i2c_model_pj, metric_counter, I2C_EXEC_MODES + 1);   // modelled energy of every transaction in each mode, then of the modes chosen
 
 //***********************************************************************************
 // Private functions
 //***********************************************************************************
 void i2c_bus_reset(I2C_TypeDef *i2c);
+static I2C_EXEC_MODE i2c_choose_exec(I2C_STATE_MACHINE *i2c_sm, bool caller_waits);
+static void i2c_poll(I2C_STATE_MACHINE *i2c_sm);
+static void Ack_Func(I2C_STATE_MACHINE *i2c_sm);
+static void Rxdatav_Func(I2C_STATE_MACHINE *i2c_sm);
+static void Stop_Func(I2C_STATE_MACHINE *i2c_sm);
+static I2C_STATE_MACHINE *i2c_state_get(I2C_TypeDef *i2c);
+static bool i2c_claim(I2C_STATE_MACHINE *i2c_sm);
+static void i2c_begin(I2C_STATE_MACHINE *i2c_sm, I2C_TypeDef *i2c, uint32_t device_address, OPERATION_MODE mode, uint32_t *data, uint32_t bytes_expected, uint32_t desired_register_address, uint32_t app_cb, bool caller_waits);
+
+/***************************************************************************//**
+ * @brief
+ * Picks polled or interrupt execution for the transaction set up in the state machine.
+ *
+ * @details
+ * The bus time is fixed by SCL, so the modes only differ in what the core does during it. Polled keeps the core
+ * in EM0 for the whole transaction. Interrupt execution keeps it in EM1 except for one handler per ACK, RXDATAV
+ * and MSTOP plus the completion dispatch. If the caller spins until the transaction ends anyway, the interrupt
+ * mode's EM1 time is really EM0 time and polling always wins. The modelled energy of both modes is added to
+ * i2c_model_pj for every transaction so the choice can be checked against the measured handler cost.
+ *
+ * @note
+ * Transactions longer than I2C_POLL_MAX_US are never polled so that the caller is not held for long.
+ * DMA execution is not modelled: the Si1133 transfers are at most a few bytes, well below the size where
+ * LDMA setup pays for itself.
+ *
+ * @param[in] i2c_sm
+ * State machine of the transaction
+ *
+ * @param[in] caller_waits
+ * The caller waits for the transaction to complete before continuing
+ *
+ * @return
+ * Execution mode for the transaction
+ ******************************************************************************/
+static I2C_EXEC_MODE i2c_choose_exec(I2C_STATE_MACHINE *i2c_sm, bool caller_waits){
+  uint32_t bits, irqs;
+
+  if(i2c_sm->mode == read){
+      bits = 1 + I2C_FRAME_BITS * (3 + i2c_sm->num_of_data_bytes) + 2;   // START, address, register, RSTART, address, data, STOP
+      irqs = 3 + i2c_sm->num_of_data_bytes + 1;                         // 3 ACK, RXDATAV per byte, MSTOP
+  }else{
+      bits = 1 + I2C_FRAME_BITS * (2 + i2c_sm->num_of_data_bytes) + 1;
+      irqs = 2 + i2c_sm->num_of_data_bytes + 1;
+  }
+  uint32_t bus_cycles = (uint64_t)bits * i2c_sm->core_hz / i2c_sm->bus_hz;
+  uint32_t irq_cycles = irqs * i2c_sm->isr_avg_cycles + (i2c_sm->I2C_CB ? I2C_DISPATCH_CYCLES : 0);
+  uint32_t sleep_cycles = bus_cycles > irq_cycles ? bus_cycles - irq_cycles : 0;
+  uint32_t sleep_ua = caller_waits ? I2C_EM0_UA_PER_MHZ : I2C_EM1_UA_PER_MHZ;
+
+  // pJ = uA/MHz * mV * cycles / 1000
+  uint32_t polled_pj = (uint64_t)I2C_EM0_UA_PER_MHZ * I2C_SUPPLY_MV * bus_cycles / 1000;
+  uint32_t irq_pj = ((uint64_t)sleep_ua * sleep_cycles + (uint64_t)I2C_EM0_UA_PER_MHZ * irq_cycles) * I2C_SUPPLY_MV / 1000;
+
+  I2C_EXEC_MODE exec = i2c_sm->exec_policy;
+  if(exec == i2c_exec_auto){
+      bool short_enough = (uint64_t)bits * 1000000 / i2c_sm->bus_hz <= I2C_POLL_MAX_US;
+      exec = (short_enough && polled_pj <= irq_pj) ? i2c_exec_polled : i2c_exec_irq;
+  }
+
+  metric_i2c_model_pj[i2c_exec_polled] += polled_pj;
+  metric_i2c_model_pj[i2c_exec_irq] += irq_pj;
+  metric_i2c_model_pj[I2C_EXEC_MODES] += exec == i2c_exec_polled ? polled_pj : irq_pj;
+  metric_i2c_exec_count[exec]++;
+  return exec;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Runs a transaction to completion by polling the interrupt flags.
+ *
+ * @details
+ * The same state machine functions as the interrupt handler service each flag, so both modes behave the
+ * same and the completion event is still scheduled by Stop_Func(). A NACK abandons the transaction with
+ * i2c_abort(), without a completion event, instead of polling forever for an ACK that will not come.
+ *
+ * @note
+ * Interrupts of the peripheral are disabled by the caller for the duration.
+ ******************************************************************************/
+static void i2c_poll(I2C_STATE_MACHINE *i2c_sm){
+  I2C_TypeDef *i2c = i2c_sm->i2cx;
+
+  while(!i2c_sm->available){
+      uint32_t int_flag = i2c->IF & (I2C_IF_ACK | I2C_IF_NACK | I2C_IF_RXDATAV | I2C_IF_MSTOP);
+      i2c->IFC = int_flag;
+
+      if(int_flag & I2C_IF_NACK){
+          METRIC_INC(i2c_poll_nacks);
+          i2c_abort(i2c);
+          break;
+      }
+
+      if(int_flag & I2C_IF_ACK) {
+          Ack_Func(i2c_sm);
+      }
+      if(int_flag & I2C_IF_RXDATAV){
+          Rxdatav_Func(i2c_sm);
+      }
+      if(int_flag & I2C_IF_MSTOP){
+          Stop_Func(i2c_sm);
+      }
+  }
+}
 
 /***************************************************************************//**
  * @brief
@@ -61,7 +174,7 @@ static void Ack_Func(I2C_STATE_MACHINE *i2c_sm){
       break;
     case write_data:
       i2c_sm->num_of_data_bytes--;
-      i2c_sm->i2cx->TXDATA = (*(i2c_sm->data) >> (8*i2c_sm->num_of_data_bytes)) & 0xff;
+      i2c_sm->i2cx->TXDATA = (i2c_sm->data[i2c_sm->num_of_data_bytes / 4] >> (8*(i2c_sm->num_of_data_bytes % 4))) & 0xff;
       if(i2c_sm->num_of_data_bytes == 0){
          i2c_sm->i2cx->CMD = I2C_CMD_STOP;
          i2c_sm->current_state = recieve_data;
@@ -103,8 +216,8 @@ static void Rxdatav_Func(I2C_STATE_MACHINE *i2c_sm){
         break;
       case initialize_device_read:
             i2c_sm->num_of_data_bytes--;
-            *(i2c_sm->data) &= ~(0xff << (8*i2c_sm->num_of_data_bytes));
-            *(i2c_sm->data) |= i2c_sm->i2cx->RXDATA << (8*i2c_sm->num_of_data_bytes);
+            i2c_sm->data[i2c_sm->num_of_data_bytes / 4] &= ~(0xff << (8*(i2c_sm->num_of_data_bytes % 4)));
+            i2c_sm->data[i2c_sm->num_of_data_bytes / 4] |= i2c_sm->i2cx->RXDATA << (8*(i2c_sm->num_of_data_bytes % 4));
             if(i2c_sm->num_of_data_bytes > 0){ //still have more data to read
                 i2c_sm->i2cx->CMD = I2C_CMD_ACK;
                 break;
@@ -153,6 +266,10 @@ static void Stop_Func(I2C_STATE_MACHINE *i2c_sm){
           //Only get to this point if MSTOP was set in IRQ Handler
           //unblock sleep mode after verifying stop
               sleep_unblock_mode(I2C_EM_BLOCK);
+              cmu_clock_release(i2c_sm->clock);
+              uint32_t transaction_cycles = timing_cycles_since(i2c_sm->start_cycles);
+              METRIC_HIST(i2c_transaction_cycles, transaction_cycles);
+              METRIC_ADD(i2c_busy_cycles, transaction_cycles);
               i2c_sm->available = true;
               i2c_sm->current_state = initialize_device_write;
               add_scheduled_event(i2c_sm->I2C_CB);
@@ -165,6 +282,91 @@ static void Stop_Func(I2C_STATE_MACHINE *i2c_sm){
 }
 
 
+/***************************************************************************//**
+ * @brief
+ * Returns the state machine of an i2c peripheral.
+ ******************************************************************************/
+static I2C_STATE_MACHINE *i2c_state_get(I2C_TypeDef *i2c){
+  if(i2c == I2C0){
+      return &i2c0_state;
+  }
+  if(i2c == I2C1){
+      return &i2c1_state;
+  }
+  EFM_ASSERT(false);
+  return 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Claims the state machine for a new transaction.
+ *
+ * @details
+ * available is tested and cleared in one critical section, so a start from an interrupt cannot claim the
+ * state machine between the test and the clear of a start it preempted.
+ *
+ * @param[in] i2c_sm
+ * State machine to claim
+ *
+ * @return
+ * True if the state machine was free and now belongs to the caller
+ ******************************************************************************/
+static bool i2c_claim(I2C_STATE_MACHINE *i2c_sm){
+  bool claimed;
+
+  /* Atomic event */
+  CORE_DECLARE_IRQ_STATE;
+  CORE_ENTER_CRITICAL();
+  claimed = i2c_sm->available;
+  i2c_sm->available = false;
+  CORE_EXIT_CRITICAL();
+  return claimed;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Sets up and starts a transaction on a claimed state machine, see i2c_start() for the parameters.
+ ******************************************************************************/
+static void i2c_begin(I2C_STATE_MACHINE *i2c_sm, I2C_TypeDef *i2c, uint32_t device_address, OPERATION_MODE mode, uint32_t *data, uint32_t bytes_expected, uint32_t desired_register_address, uint32_t app_cb, bool caller_waits){
+  EFM_ASSERT((i2c->STATE & _I2C_STATE_STATE_MASK) == I2C_STATE_STATE_IDLE);
+
+  sleep_block_mode(I2C_EM_BLOCK); //block energy modes > 2
+  cmu_clock_acquire(i2c_sm->clock); //released when the transaction completes or is abandoned
+
+  // initialize struct
+  i2c_sm->i2cx = i2c;
+  i2c_sm->mode = mode;
+  i2c_sm->I2C_CB = app_cb;
+  i2c_sm->data = data;
+  i2c_sm->num_of_data_bytes = bytes_expected;
+  i2c_sm->current_state = initialize_device_write; //initial state 0
+  i2c_sm->desired_register_address = desired_register_address;
+  i2c_sm->device_address = device_address;
+  i2c_sm->start_cycles = timing_cycles();
+
+  i2c_sm->exec = i2c_choose_exec(i2c_sm, caller_waits);
+
+  METRIC_INC(i2c_transactions);
+  METRIC_ADD(i2c_bytes, bytes_expected);
+
+  if(i2c_sm->exec == i2c_exec_polled){
+      // Stop_Func() or i2c_abort() releases the transaction's clock, this reference keeps the peripheral
+      // clocked until IEN is restored, a write to a gated peripheral is lost
+      cmu_clock_acquire(i2c_sm->clock);
+      uint32_t saved_ien = i2c->IEN;
+      i2c->IEN = 0;
+      i2c->CMD = I2C_CMD_START;
+      i2c->TXDATA = (device_address << 1) | write;
+      i2c_poll(i2c_sm);
+      i2c->IEN = saved_ien;
+      cmu_clock_release(i2c_sm->clock);
+      return;
+  }
+
+  i2c->CMD = I2C_CMD_START;
+  i2c->TXDATA = (device_address << 1) | write;
+}
+
 //***********************************************************************************
 // Global functions
 //***********************************************************************************
@@ -189,7 +391,8 @@ static void Stop_Func(I2C_STATE_MACHINE *i2c_sm){
  * Operation mode of the i2c peripheral, either "write" or "read"
  *
  * @param[in] data
- * A pointer to the data variable that will hold the data read off or written to the slave device
+ * A pointer to the data variable that will hold the data read off or written to the slave device. Bytes are transferred most
+ * significant first. Transfers of more than 4 bytes use an array of words with data[0] holding the last 4 bytes.
  *
  * @param[in] bytes_expected
  * Number of bytes desired to read off or write to the slave device
@@ -199,39 +402,43 @@ static void Stop_Func(I2C_STATE_MACHINE *i2c_sm){
  *
  * @param[in] app_cb
  * Call back function to be serviced after i2c operation completes
+ *
+ * @param[in] caller_waits
+ * True if the caller spins until the operation completes, used by the execution mode cost model. A polled
+ * transaction is complete when this function returns.
  ******************************************************************************/
-void i2c_start(I2C_TypeDef *i2c, uint32_t device_address, OPERATION_MODE mode, uint32_t *data, uint32_t bytes_expected, uint32_t desired_register_address, uint32_t app_cb){ //input number of bytes wanting to read
-  I2C_STATE_MACHINE *i2c_local_sm = 0;
+void i2c_start(I2C_TypeDef *i2c, uint32_t device_address, OPERATION_MODE mode, uint32_t *data, uint32_t bytes_expected, uint32_t desired_register_address, uint32_t app_cb, bool caller_waits){ //input number of bytes wanting to read
+  I2C_STATE_MACHINE *i2c_local_sm = i2c_state_get(i2c);
 
-  if(i2c == I2C0){
-      i2c_local_sm = &i2c0_state;
-  }else if(i2c == I2C1){
-      i2c_local_sm = &i2c1_state;
-  }else{
-      EFM_ASSERT(false);
+  if(!i2c_claim(i2c_local_sm)){
+      METRIC_INC(i2c_busy_waits);
+      while(!i2c_claim(i2c_local_sm));
   }
-  while(!i2c_local_sm->available);
-
-  EFM_ASSERT((i2c->STATE & _I2C_STATE_STATE_MASK) == I2C_STATE_STATE_IDLE);
-
-  sleep_block_mode(I2C_EM_BLOCK); //block energy modes > 2
-
-
-  i2c_local_sm->available = false;
-
-  // initialize struct
-  i2c_local_sm->i2cx = i2c;
-  i2c_local_sm->mode = mode;
-  i2c_local_sm->I2C_CB = app_cb;
-  i2c_local_sm->data = data;
-  i2c_local_sm->num_of_data_bytes = bytes_expected;
-  i2c_local_sm->current_state = initialize_device_write; //initial state 0
-  i2c_local_sm->desired_register_address = desired_register_address;
-  i2c_local_sm->device_address = device_address;
+  i2c_begin(i2c_local_sm, i2c, device_address, mode, data, bytes_expected, desired_register_address, app_cb, caller_waits);
+}
 
-  i2c->CMD = I2C_CMD_START;
-  i2c->TXDATA = (device_address << 1) | write;
+/***************************************************************************//**
+ * @brief
+ * Begins an i2c operation if the peripheral is free, without waiting.
+ *
+ * @details
+ * Takes the same parameters as i2c_start(). The state machine is claimed atomically, so this can be called
+ * from an interrupt that preempts a start in the main loop.
+ *
+ * @note
+ * Used by the sync input to send FORCE from the TIMER1 interrupt, where spinning on a busy bus is not allowed.
+ *
+ * @return
+ * False if a transaction was already in progress and nothing was started
+ ******************************************************************************/
+bool i2c_try_start(I2C_TypeDef *i2c, uint32_t device_address, OPERATION_MODE mode, uint32_t *data, uint32_t bytes_expected, uint32_t desired_register_address, uint32_t app_cb, bool caller_waits){
+  I2C_STATE_MACHINE *i2c_local_sm = i2c_state_get(i2c);
 
+  if(!i2c_claim(i2c_local_sm)){
+      return false;
+  }
+  i2c_begin(i2c_local_sm, i2c, device_address, mode, data, bytes_expected, desired_register_address, app_cb, caller_waits);
+  return true;
 }
 
 
@@ -262,15 +469,27 @@ void i2c_start(I2C_TypeDef *i2c, uint32_t device_address, OPERATION_MODE mode, u
 void i2c_open(I2C_TypeDef *i2c, I2C_OPEN_STRUCT *i2c_setup){
   I2C_Init_TypeDef i2c_values;
 
-  // Enables clock
+  I2C_STATE_MACHINE *i2c_local_sm = 0;
+
+  // Enables clock for the configuration, afterwards it is only held during transactions
   if(i2c == I2C0){
-      CMU_ClockEnable(cmuClock_I2C0, true);
+      i2c0_state.clock = cmuClock_I2C0;
       i2c0_state.available = true;
+      i2c_local_sm = &i2c0_state;
   }
   if(i2c == I2C1){
-      CMU_ClockEnable(cmuClock_I2C1, true);
+      i2c1_state.clock = cmuClock_I2C1;
       i2c1_state.available = true;
+      i2c_local_sm = &i2c1_state;
     }
+  EFM_ASSERT(i2c_local_sm);
+  cmu_clock_acquire(i2c_local_sm->clock);
+
+  // Cost model inputs, the handler cost is refined as the I2C1 handler is measured
+  i2c_local_sm->exec_policy = i2c_setup->exec_policy;
+  i2c_local_sm->bus_hz = i2c_setup->freq;
+  i2c_local_sm->core_hz = CMU_ClockFreqGet(cmuClock_CORE);
+  i2c_local_sm->isr_avg_cycles = I2C_ISR_DEFAULT_CYCLES;
 
   // Test clock operation
   if ((i2c->IF & 0x01) == 0) {
@@ -312,6 +531,7 @@ void i2c_open(I2C_TypeDef *i2c, I2C_OPEN_STRUCT *i2c_setup){
 
 
   i2c_bus_reset(i2c);
+  cmu_clock_release(i2c_local_sm->clock);
 
 }
 
@@ -351,6 +571,35 @@ void i2c_bus_reset(I2C_TypeDef *i2c){
 
 }
 
+/***************************************************************************//**
+ * @brief
+ * Abandons the transaction in progress and frees the peripheral.
+ *
+ * @details
+ * The bus is reset and the state machine is returned to its idle state with the energy mode block of the
+ * transaction released. No completion event is scheduled.
+ *
+ * @note
+ * This is used when a transaction does not complete, by the timing benchmark at a bus setting under test, by
+ * polled execution on a NACK and when probing for a sensor that may still be starting up.
+ *
+ * @param[in] i2c
+ * A pointer/address to the i2c peripheral
+ ******************************************************************************/
+void i2c_abort(I2C_TypeDef *i2c){
+  I2C_STATE_MACHINE *i2c_local_sm = (i2c == I2C0) ? &i2c0_state : &i2c1_state;
+
+  EFM_ASSERT(i2c == I2C0 || i2c == I2C1);
+  if(i2c_local_sm->available){
+      return;
+  }
+  i2c_bus_reset(i2c);
+  i2c_local_sm->current_state = initialize_device_write;
+  i2c_local_sm->available = true;
+  sleep_unblock_mode(I2C_EM_BLOCK);
+  cmu_clock_release(i2c_local_sm->clock);
+}
+
 /***************************************************************************//**
  * @brief
  * Returns the i2c peripheral availability state
@@ -371,6 +620,31 @@ bool i2c_available(I2C_TypeDef *i2c){
   return false;
 }
 
+/***************************************************************************//**
+ * @brief
+ * Copies the transaction, bus time and handler time totals.
+ *
+ * @details
+ * The totals are kept in the i2c_* metrics and are updated from the I2C handlers, so the copy is taken in one
+ * atomic event.
+ *
+ * @note
+ * This function is used by the si1133 configuration and the benches to measure the I2C cost of their own work.
+ *
+ * @param[out] stats
+ * Totals since metrics_open()
+ ******************************************************************************/
+void i2c_stats(I2C_STATS *stats){
+  /* Atomic event */
+  CORE_DECLARE_IRQ_STATE;
+  CORE_ENTER_CRITICAL();
+  stats->transactions = metric_i2c_transactions[0];
+  stats->busy_waits = metric_i2c_busy_waits[0];
+  stats->busy_cycles = metric_i2c_busy_cycles[0];
+  stats->isr_cycles = metric_i2c_isr_total_cycles[0];
+  CORE_EXIT_CRITICAL();
+}
+
 /***************************************************************************//**
  * @brief
  * Interrupt handler for the I2C0 peripheral
@@ -407,6 +681,8 @@ void I2C0_IRQHandler(void){
  * This function will respond and handle the ACK, RXDATAV, and MSTOP interrupts
  ******************************************************************************/
 void I2C1_IRQHandler(void){
+  uint32_t start = timing_cycles();
+  bool flash_active = flash_busy();
   uint32_t int_flag = I2C1->IF & I2C1->IEN;
    I2C1->IFC = int_flag;
 
@@ -420,6 +696,15 @@ void I2C1_IRQHandler(void){
        Stop_Func(&i2c1_state);
       }
 
+   // Handler code is fetched from flash, so flash programming shows up as added handler time
+   uint32_t isr_cycles = timing_cycles_since(start);
+   METRIC_ADD(i2c_isr_total_cycles, isr_cycles);
+   if(flash_active){
+       METRIC_HIST(i2c_isr_flash_cycles, isr_cycles);
+   }else{
+       METRIC_HIST(i2c_isr_cycles, isr_cycles);
+       i2c1_state.isr_avg_cycles += ((int32_t)isr_cycles - (int32_t)i2c1_state.isr_avg_cycles) >> I2C_ISR_AVG_SHIFT;
+   }
 
 }
 
@@ -0,0 +1,225 @@
+/**
+ * @file
+ * i2c_bench.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that sweeps the I2C timing settings on the target and reports the operating point to use
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "i2c_bench.h"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+static const CMU_HFRCOFreq_TypeDef i2c_bench_bands[I2C_BENCH_BANDS] = {
+  cmuHFRCOFreq_19M0Hz, cmuHFRCOFreq_26M0Hz, cmuHFRCOFreq_38M0Hz
+};
+static const I2C_ClockHLR_TypeDef i2c_bench_clhrs[I2C_BENCH_CLHRS] = {
+  i2cClockHLRStandard, i2cClockHLRAsymetric, i2cClockHLRFast
+};
+static const uint32_t i2c_bench_freqs[I2C_BENCH_FREQS] = {
+  I2C_FREQ_STANDARD_MAX, 200000, I2C_FREQ_FAST_MAX
+};
+static const uint32_t i2c_bench_lengths[I2C_BENCH_LENGTHS] = {
+  1, 3, 5, I2C_BENCH_MAX_BYTES      // 3 is the white light result read, 7 the result read of three channels
+};
+
+static uint32_t i2c_bench_data[(I2C_BENCH_MAX_BYTES + 3) / 4];
+
+METRIC_DECLARE(i2c_bench_table, metric_gauge, I2C_BENCH_POINTS * I2C_BENCH_FIELDS);   // I2C_BENCH_FIELDS per point, band, clhr, freq then length order
+METRIC_DECLARE(i2c_bench_choice, metric_gauge, I2C_BENCH_CHOICE_FIELDS);
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static void i2c_bench_point(I2C_TypeDef *i2c, uint32_t device_address, uint32_t reg, uint32_t expected, uint32_t bytes, uint32_t *result);
+static void i2c_bench_recommend(void);
+
+/***************************************************************************//**
+ * @brief
+ * Measures one operating point.
+ *
+ * @details
+ * Each transaction is started with interrupt execution and timed from i2c_start() to completion. The CPU cost is
+ * the time spent in i2c_start() plus the I2C handler time, the rest of the transaction is time the core could
+ * sleep in EM1. Energy uses the same current figures as the i2c execution mode cost model. The first byte read
+ * must match the expected value, a mismatch or a transaction that times out counts as an error.
+ *
+ * @param[in] i2c
+ * I2C peripheral, opened at the settings of the point
+ *
+ * @param[in] device_address
+ * Device read from
+ *
+ * @param[in] reg
+ * First register of the read
+ *
+ * @param[in] expected
+ * Value of the first register
+ *
+ * @param[in] bytes
+ * Length of each read
+ *
+ * @param[out] result
+ * I2C_BENCH_FIELDS values of the point
+ *
+ ******************************************************************************/
+static void i2c_bench_point(I2C_TypeDef *i2c, uint32_t device_address, uint32_t reg, uint32_t expected, uint32_t bytes, uint32_t *result){
+  uint32_t core_hz = CMU_ClockFreqGet(cmuClock_CORE);
+  uint32_t timeout = (uint64_t)I2C_BENCH_TIMEOUT_US * core_hz / 1000000;
+  uint32_t position = bytes - 1;   // the first byte received is the most significant
+  uint32_t completed = 0;
+  uint32_t errors = 0;
+  uint64_t wall_cycles = 0;
+  uint64_t cpu_cycles = 0;
+
+  for(int i = 0; i < I2C_BENCH_TRANSACTIONS; i++){
+      I2C_STATS before, after;
+      i2c_stats(&before);
+      uint32_t start = timing_cycles();
+      i2c_start(i2c, device_address, read, i2c_bench_data, bytes, reg, 0, false); //no completion event
+      uint32_t setup_cycles = timing_cycles_since(start);
+
+      while(!i2c_available(i2c) && timing_cycles_since(start) < timeout);
+      uint32_t cycles = timing_cycles_since(start);
+      if(!i2c_available(i2c)){
+          i2c_abort(i2c);
+          errors++;
+          continue;
+      }
+
+      i2c_stats(&after);
+      completed++;
+      wall_cycles += cycles;
+      cpu_cycles += setup_cycles + (after.isr_cycles - before.isr_cycles);
+      if(((i2c_bench_data[position / 4] >> (8 * (position % 4))) & 0xFF) != expected){
+          errors++;
+      }
+  }
+
+  result[i2c_bench_errors] = errors;
+  if(!completed){
+      result[i2c_bench_bytes_per_s] = 0;
+      result[i2c_bench_cycles_per_byte] = 0;
+      result[i2c_bench_nj] = 0;
+      return;
+  }
+
+  uint64_t sleep_cycles = wall_cycles > cpu_cycles ? wall_cycles - cpu_cycles : 0;
+  // pJ = uA/MHz * mV * cycles / 1000
+  uint64_t pj = ((uint64_t)I2C_EM0_UA_PER_MHZ * cpu_cycles + (uint64_t)I2C_EM1_UA_PER_MHZ * sleep_cycles) * I2C_SUPPLY_MV / 1000;
+
+  result[i2c_bench_bytes_per_s] = (uint64_t)bytes * completed * core_hz / wall_cycles;
+  result[i2c_bench_cycles_per_byte] = cpu_cycles * 16 / (bytes * completed);
+  result[i2c_bench_nj] = pj / 1000 / completed;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Picks the operating point from the table.
+ *
+ * @details
+ * Only points at I2C_BENCH_SIZING_BYTES without errors are considered. The point with the lowest energy per
+ * transaction wins, the higher throughput breaks a tie.
+ *
+ ******************************************************************************/
+static void i2c_bench_recommend(void){
+  uint32_t best = I2C_BENCH_POINTS;
+
+  for(uint32_t point = 0; point < I2C_BENCH_POINTS; point++){
+      const uint32_t *result = &metric_i2c_bench_table[point * I2C_BENCH_FIELDS];
+      if(i2c_bench_lengths[point % I2C_BENCH_LENGTHS] != I2C_BENCH_SIZING_BYTES || result[i2c_bench_errors]){
+          continue;
+      }
+      if(best == I2C_BENCH_POINTS){
+          best = point;
+          continue;
+      }
+      const uint32_t *best_result = &metric_i2c_bench_table[best * I2C_BENCH_FIELDS];
+      if(result[i2c_bench_nj] < best_result[i2c_bench_nj] ||
+          (result[i2c_bench_nj] == best_result[i2c_bench_nj] && result[i2c_bench_bytes_per_s] > best_result[i2c_bench_bytes_per_s])){
+          best = point;
+      }
+  }
+
+  EFM_ASSERT(best < I2C_BENCH_POINTS); //no setting worked
+  uint32_t freq = best / I2C_BENCH_LENGTHS;
+  uint32_t clhr = freq / I2C_BENCH_FREQS;
+  uint32_t band = clhr / I2C_BENCH_CLHRS;
+  metric_i2c_bench_choice[i2c_bench_choice_band_hz] = i2c_bench_bands[band];
+  metric_i2c_bench_choice[i2c_bench_choice_clhr] = i2c_bench_clhrs[clhr % I2C_BENCH_CLHRS];
+  metric_i2c_bench_choice[i2c_bench_choice_freq] = i2c_bench_freqs[freq % I2C_BENCH_FREQS];
+  metric_i2c_bench_choice[i2c_bench_choice_point] = best;
+}
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Sweeps HFRCO band, clock low/high ratio, bus frequency and read length and recommends an operating point.
+ *
+ * @details
+ * At every point the peripheral is opened again, so the bus divider is computed for the band, and
+ * I2C_BENCH_TRANSACTIONS reads of a register with a known value are measured. Throughput, CPU cycles per byte,
+ * energy per transaction and errors of every point are kept in i2c_bench_table and the chosen point in
+ * i2c_bench_choice. The HFRCO band and the caller's settings are restored afterwards, the recommendation is
+ * only reported.
+ *
+ * @note
+ * This function is called in app_peripheral_setup() when I2C_TIMING_BENCH is defined, before anything else
+ * depends on the HF clock or uses the bus.
+ *
+ * @param[in] i2c
+ * I2C peripheral to characterize
+ *
+ * @param[in] setup
+ * Settings the peripheral is used with, routes and interrupts are kept for every point
+ *
+ * @param[in] device_address
+ * Device read from
+ *
+ * @param[in] reg
+ * Register with a known value, read at every point
+ *
+ * @param[in] expected
+ * Value of the register
+ *
+ ******************************************************************************/
+void i2c_bench_run(I2C_TypeDef *i2c, I2C_OPEN_STRUCT *setup, uint32_t device_address, uint32_t reg, uint32_t expected){
+  CMU_HFRCOFreq_TypeDef band_in_use = CMU_HFRCOBandGet();
+  I2C_OPEN_STRUCT point_setup = *setup;
+  point_setup.exec_policy = i2c_exec_irq;
+  uint32_t point = 0;
+
+  for(int band = 0; band < I2C_BENCH_BANDS; band++){
+      CMU_HFRCOBandSet(i2c_bench_bands[band]);
+      for(int clhr = 0; clhr < I2C_BENCH_CLHRS; clhr++){
+          for(int freq = 0; freq < I2C_BENCH_FREQS; freq++){
+              point_setup.clhr = i2c_bench_clhrs[clhr];
+              point_setup.freq = i2c_bench_freqs[freq];
+              i2c_open(i2c, &point_setup);
+              for(int length = 0; length < I2C_BENCH_LENGTHS; length++){
+                  i2c_bench_point(i2c, device_address, reg, expected, i2c_bench_lengths[length],
+                                  &metric_i2c_bench_table[point * I2C_BENCH_FIELDS]);
+                  point++;
+              }
+          }
+      }
+  }
+
+  CMU_HFRCOBandSet(band_in_use);
+  i2c_open(i2c, setup);
+  i2c_bench_recommend();
+}
@@ -0,0 +1,199 @@
+/**
+ * @file
+ * idle_work.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that runs registered background jobs in bounded slices while the scheduler is idle
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "idle_work.h"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+static IDLE_JOB idle_jobs[IDLE_WORK_MAX_JOBS];
+static uint32_t idle_job_count;
+static uint32_t idle_next_job;  // round robin position so one job cannot starve the others
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Initializes the idle work job table.
+ *
+ * @details
+ * All jobs and their statistics are cleared.
+ *
+ * @note
+ * This function is called once in app_peripheral_setup() before any job is registered.
+ *
+ ******************************************************************************/
+void idle_work_open(void){
+  for(int i = 0; i < IDLE_WORK_MAX_JOBS; i++){
+      idle_jobs[i] = (IDLE_JOB){0};
+  }
+  idle_job_count = 0;
+  idle_next_job = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Registers a background job.
+ *
+ * @details
+ * The job starts without pending work and is only run after idle_work_post() is called for it.
+ *
+ * @note
+ * Jobs are registered at setup by the module that owns the housekeeping work.
+ *
+ * @param[in] name
+ * Name of the job, kept for debugging
+ *
+ * @param[in] job
+ * Function that performs one bounded unit of work and returns true while work remains
+ *
+ * @return
+ * Id of the job, used with idle_work_post() and idle_work_stats()
+ *
+ ******************************************************************************/
+uint32_t idle_work_register(const char *name, IDLE_JOB_FUNC job){
+  EFM_ASSERT(job);
+  EFM_ASSERT(idle_job_count < IDLE_WORK_MAX_JOBS);
+
+  idle_jobs[idle_job_count].name = name;
+  idle_jobs[idle_job_count].job = job;
+  return idle_job_count++;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Marks a job as having work to do.
+ *
+ * @details
+ * The post is counted, so a post that lands while the job finishes its last unit is not lost.
+ *
+ * @note
+ * This function may be called from callbacks or interrupts.
+ *
+ * @param[in] job_id
+ * Id returned by idle_work_register()
+ *
+ ******************************************************************************/
+void idle_work_post(uint32_t job_id){
+  EFM_ASSERT(job_id < idle_job_count);
+
+  /* Atomic event */
+  CORE_DECLARE_IRQ_STATE;
+  CORE_ENTER_CRITICAL();
+  idle_jobs[job_id].pending = true;
+  idle_jobs[job_id].posts++;
+  CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns true if any registered job has work remaining.
+ *
+ ******************************************************************************/
+bool idle_work_pending(void){
+  for(uint32_t i = 0; i < idle_job_count; i++){
+      if(idle_jobs[i].pending){
+          return true;
+      }
+  }
+  return false;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Runs pending jobs for at most IDLE_SLICE_US.
+ *
+ * @details
+ * The budget is converted to cycles of the core clock at the start of the slice, as the operating profiles run the
+ * core at different frequencies.
+ * Jobs are visited round robin. Each job is called one unit of work at a time. After the first unit of the slice,
+ * a new unit is only started if the longest unit seen so far for that job still fits in the remaining budget, so a
+ * slice stays bounded even though the jobs themselves cannot be preempted. The slice also ends as soon as an event is scheduled, so
+ * scheduled callbacks never wait behind background work. A job that ran out of work stays pending if it was posted
+ * again while its last unit ran.
+ *
+ * @note
+ * This function is called from the main loop only when no events are scheduled and the next LETIMER deadline
+ * is at least IDLE_MIN_HEADROOM_MS away.
+ *
+ ******************************************************************************/
+void idle_work_run_slice(void){
+  uint32_t slice_start = timing_cycles();
+  uint32_t slice_cycles = (uint64_t)IDLE_SLICE_US * CMU_ClockFreqGet(cmuClock_CORE) / 1000000;
+  uint32_t slice_units = 0;
+
+  for(uint32_t visited = 0; visited < idle_job_count; visited++){
+      IDLE_JOB *job = &idle_jobs[idle_next_job];
+      idle_next_job = (idle_next_job + 1) % idle_job_count;
+
+      if(!job->pending){
+          continue;
+      }
+      job->slices++;
+
+      while(job->pending && !any_scheduled_event()){
+          uint32_t elapsed = timing_cycles_since(slice_start);
+          if(slice_units && (elapsed + job->cycles_max_unit > slice_cycles)){
+              break; //next unit would not fit in this slice
+          }
+
+          uint32_t posts = job->posts;
+          uint32_t unit_start = timing_cycles();
+          bool more = job->job();
+          uint32_t unit_cycles = timing_cycles_since(unit_start);
+
+          slice_units++;
+          job->units++;
+          job->cycles_total += unit_cycles;
+          if(unit_cycles > job->cycles_max_unit){
+              job->cycles_max_unit = unit_cycles;
+          }
+          if(!more){
+              /* Atomic event */
+              CORE_DECLARE_IRQ_STATE;
+              CORE_ENTER_CRITICAL();
+              if(job->posts == posts){
+                  job->pending = false;
+              }
+              CORE_EXIT_CRITICAL();
+              job->completions++;
+          }
+      }
+
+      if(timing_cycles_since(slice_start) > slice_cycles){
+          job->overruns++;
+      }
+      if(any_scheduled_event() || timing_cycles_since(slice_start) >= slice_cycles){
+          return;
+      }
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the progress and budget statistics of a job.
+ *
+ * @param[in] job_id
+ * Id returned by idle_work_register()
+ *
+ ******************************************************************************/
+const IDLE_JOB *idle_work_stats(uint32_t job_id){
+  EFM_ASSERT(job_id < idle_job_count);
+  return &idle_jobs[job_id];
+}
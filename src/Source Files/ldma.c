@@ -0,0 +1,134 @@
+/**
+ * @file
+ * ldma.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that shares the LDMA controller between drivers and routes channel completion interrupts
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "ldma.h"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+static bool ldma_opened = false;
+static LDMA_DONE_FUNC ldma_done[LDMA_CHANNELS];
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Initializes the LDMA controller.
+ *
+ * @details
+ * Every driver that uses a channel calls this. Only the first call initializes the controller so that a
+ * later driver does not reset transfers that are already running.
+ *
+ ******************************************************************************/
+void ldma_open(void){
+  LDMA_Init_t ldma_init = LDMA_INIT_DEFAULT;
+
+  if(ldma_opened){
+      return;
+  }
+  for(int i = 0; i < LDMA_CHANNELS; i++){
+      ldma_done[i] = 0;
+  }
+  LDMA_Init(&ldma_init);
+  ldma_opened = true;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Starts a transfer on a channel.
+ *
+ * @details
+ * If the descriptor sets doneIfs, done is called from the LDMA interrupt when the transfer is complete.
+ *
+ * @note
+ * The LDMA only runs in EM0 and EM1. The caller blocks EM2 for as long as it needs the transfer to progress.
+ *
+ * @param[in] channel
+ * Channel from the assignments in ldma.h
+ *
+ * @param[in] config
+ * Request source and loop configuration
+ *
+ * @param[in] descriptor
+ * First descriptor of the transfer, must stay valid until the transfer is complete if it links to others
+ *
+ * @param[in] done
+ * Completion function, or 0 for none
+ *
+ ******************************************************************************/
+void ldma_start(uint32_t channel, const LDMA_TransferCfg_t *config, const LDMA_Descriptor_t *descriptor, LDMA_DONE_FUNC done){
+  EFM_ASSERT(ldma_opened);
+  EFM_ASSERT(channel < LDMA_CHANNELS);
+
+  ldma_done[channel] = done;
+  LDMA_StartTransfer(channel, config, descriptor);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Stops a channel. Its completion function is not called.
+ *
+ * @details
+ * A done flag still pending from the stopped transfer is cleared so that it is not taken as the completion of
+ * the next transfer started on the channel.
+ ******************************************************************************/
+void ldma_stop(uint32_t channel){
+  EFM_ASSERT(channel < LDMA_CHANNELS);
+
+  LDMA_StopTransfer(channel);
+  LDMA->IFC = 1 << channel;
+  ldma_done[channel] = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the number of units the channel has not transferred yet.
+ ******************************************************************************/
+uint32_t ldma_remaining(uint32_t channel){
+  EFM_ASSERT(channel < LDMA_CHANNELS);
+
+  return LDMA_TransferRemainingCount(channel);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Interrupt handler for the LDMA
+ *
+ * @details
+ * Calls the completion function of every channel whose done flag is set. A bus error stops the controller
+ * and is treated as a programming error.
+ *
+ ******************************************************************************/
+void LDMA_IRQHandler(void){
+  uint32_t int_flag = LDMA->IF & LDMA->IEN;
+  LDMA->IFC = int_flag;
+
+  EFM_ASSERT(!(int_flag & LDMA_IF_ERROR));
+
+  for(uint32_t channel = 0; channel < LDMA_CHANNELS; channel++){
+      if((int_flag & (1 << channel)) && ldma_done[channel]){
+          ldma_done[channel](channel);
+      }
+  }
+}
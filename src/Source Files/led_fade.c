@@ -0,0 +1,336 @@
+/**
+ * @file
+ * led_fade.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that fades the RGB LED colors by feeding gamma corrected ramps to the TIMER0 compare buffers with the LDMA
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "led_fade.h"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+typedef struct {
+  uint32_t            ldma_ch;
+  uint32_t            route;          // TIMER ROUTELOC0 location of the color pin
+  uint32_t            pen;            // TIMER ROUTEPEN bit of the color pin
+  bool                open;
+  bool                fading;
+  uint8_t             start_level;    // level at the start of the current ramp
+  uint8_t             level;          // level at the end of the current ramp
+  uint32_t            steps;          // length of the current ramp
+  LDMA_Descriptor_t   descriptor;
+  uint32_t            ramp[FADE_MAX_STEPS];   // CCVB values, one per PWM period
+} FADE_CHANNEL;
+
+static FADE_CHANNEL fade_channel[FADE_CHANNELS] = {
+  { .ldma_ch = LDMA_CH_FADE_RED,   .route = RED_RGB_LOC,   .pen = TIMER_ROUTEPEN_CC0PEN },
+  { .ldma_ch = LDMA_CH_FADE_GREEN, .route = GREEN_RGB_LOC, .pen = TIMER_ROUTEPEN_CC1PEN },
+  { .ldma_ch = LDMA_CH_FADE_BLUE,  .route = BLUE_RGB_LOC,  .pen = TIMER_ROUTEPEN_CC2PEN },
+};
+static uint16_t fade_gamma[FADE_LEVELS];   // level to compare value
+static uint32_t fade_step_hz;
+static uint32_t fade_done_cb;
+static bool fade_running;                   // TIMER0 is counting and EM2 is blocked
+
+METRIC_COUNTER(fade_ramps);
+METRIC_COUNTER(fade_steps);       // compare values written by the LDMA, each one a wakeup saved
+METRIC_COUNTER(fade_interrupts);  // CPU interrupts taken by the fade engine, one per ramp
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static uint32_t fade_isqrt(uint64_t value);
+static uint64_t fade_gamma_power(uint64_t level);
+static uint32_t fade_index(uint32_t color);
+static void fade_run(bool run);
+static void fade_done(uint32_t channel);
+
+/***************************************************************************//**
+ * @brief
+ * Integer square root, rounded down.
+ ******************************************************************************/
+static uint32_t fade_isqrt(uint64_t value){
+  uint64_t root = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+
+  while(bit > value){
+      bit >>= 2;
+  }
+  while(bit){
+      if(value >= root + bit){
+          value -= root + bit;
+          root = (root >> 1) + bit;
+      }
+      else{
+          root >>= 1;
+      }
+      bit >>= 2;
+  }
+  return root;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns level^FADE_GAMMA_X2, its square root is the level raised to the gamma.
+ ******************************************************************************/
+static uint64_t fade_gamma_power(uint64_t level){
+  uint64_t power = 1;
+
+  for(int i = 0; i < FADE_GAMMA_X2; i++){
+      power *= level;
+  }
+  return power;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the channel of a single COLOR_* bit.
+ ******************************************************************************/
+static uint32_t fade_index(uint32_t color){
+  EFM_ASSERT(color && !(color & (color - 1)));
+
+  uint32_t index = 31 - __CLZ(color);
+  EFM_ASSERT(index < FADE_CHANNELS);
+  EFM_ASSERT(fade_channel[index].open);
+  return index;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Starts or stops TIMER0 together with its EM2 block.
+ *
+ * @details
+ * The timer only has to run while a color is fading or lit. When every color is off it is stopped so the fade
+ * engine does not hold the board in EM1, and its clock is released so HFPER can be gated.
+ *
+ * @note
+ * Called with interrupts disabled.
+ *
+ ******************************************************************************/
+static void fade_run(bool run){
+  if(run == fade_running){
+      return;
+  }
+  fade_running = run;
+  if(run){
+      sleep_block_mode(FADE_TIMER_EM);
+      cmu_clock_acquire(FADE_TIMER_CLOCK);
+      TIMER_Enable(FADE_TIMER, true);
+  }
+  else{
+      TIMER_Enable(FADE_TIMER, false);
+      cmu_clock_release(FADE_TIMER_CLOCK);
+      sleep_unblock_mode(FADE_TIMER_EM);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * LDMA completion function of a fade channel, called in interrupt context.
+ *
+ * @details
+ * The last ramp value stays in the compare register so the color holds its level. If every color has faded to
+ * off the timer is stopped.
+ *
+ ******************************************************************************/
+static void fade_done(uint32_t channel){
+  bool lit = false;
+
+  metric_fade_interrupts[0]++;
+  for(int i = 0; i < FADE_CHANNELS; i++){
+      if(fade_channel[i].ldma_ch == channel){
+          fade_channel[i].fading = false;
+      }
+      lit |= fade_channel[i].fading || fade_channel[i].level;
+  }
+  if(!lit){
+      fade_run(false);
+  }
+  if(fade_done_cb){
+      add_scheduled_event(fade_done_cb);
+  }
+}
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Opens the fade engine on the RGB color pins.
+ *
+ * @details
+ * TIMER0 runs in PWM mode with a compare channel per color, routed to the RED/GREEN/BLUE_RGB_LOC pins. The
+ * gamma table is computed here once. A fade is a RAM ramp of compare values that the LDMA copies into the
+ * compare buffer on each TIMER0 overflow, so the CPU is not woken until the ramp is complete.
+ *
+ * @note
+ * TIMER0 is also used by timer_delay(), which must only be called before this function.
+ *
+ * @param[in] colors
+ * OR of the COLOR_* bits the engine drives, the other color pins stay under GPIO control
+ *
+ * @param[in] done_cb
+ * Event scheduled when a fade is complete, or 0 for none
+ *
+ ******************************************************************************/
+void led_fade_open(uint32_t colors, uint32_t done_cb){
+  TIMER_Init_TypeDef timer_init = TIMER_INIT_DEFAULT;
+  TIMER_InitCC_TypeDef pwm_init = TIMER_INITCC_DEFAULT;
+  uint32_t max = fade_isqrt(fade_gamma_power(FADE_LEVELS - 1));
+
+  EFM_ASSERT(!(colors & ~(COLOR_RED | COLOR_GREEN | COLOR_BLUE)));
+
+  ldma_open();
+  cmu_clock_acquire(FADE_TIMER_CLOCK);   //for the configuration, fade_run() holds it while the timer runs
+
+  for(uint64_t level = 0; level < FADE_LEVELS; level++){
+      fade_gamma[level] = (uint64_t)fade_isqrt(fade_gamma_power(level)) * FADE_PWM_TOP / max;
+  }
+  fade_step_hz = CMU_ClockFreqGet(cmuClock_HFPER) / FADE_TIMER_DIV / (FADE_PWM_TOP + 1);
+  fade_done_cb = done_cb;
+  fade_running = false;
+
+  timer_init.enable = false;
+  timer_init.debugRun = false;
+  timer_init.prescale = FADE_TIMER_PRESCALE;
+  timer_init.mode = timerModeUp;
+  TIMER_Init(FADE_TIMER, &timer_init);
+  TIMER_TopSet(FADE_TIMER, FADE_PWM_TOP);
+
+  pwm_init.mode = timerCCModePWM;
+  FADE_TIMER->ROUTEPEN = 0;
+  FADE_TIMER->ROUTELOC0 = 0;
+  for(int i = 0; i < FADE_CHANNELS; i++){
+      FADE_CHANNEL *fade = &fade_channel[i];
+      fade->open = colors & (1 << i);
+      fade->fading = false;
+      fade->level = 0;
+      if(fade->open){
+          TIMER_InitCC(FADE_TIMER, i, &pwm_init);
+          TIMER_CompareSet(FADE_TIMER, i, 0);
+          TIMER_CompareBufSet(FADE_TIMER, i, 0);
+          FADE_TIMER->ROUTELOC0 |= fade->route;
+          FADE_TIMER->ROUTEPEN |= fade->pen;
+      }
+  }
+  cmu_clock_release(FADE_TIMER_CLOCK);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Takes a change of the HFPER clock into account.
+ *
+ * @details
+ * Fades started from here are timed at the new PWM rate. A fade in progress completes its ramp at the new rate,
+ * the levels it passes through do not change.
+ *
+ * @note
+ * This is called after the HFRCO band changes.
+ *
+ ******************************************************************************/
+void led_fade_clock_update(void){
+  fade_step_hz = CMU_ClockFreqGet(cmuClock_HFPER) / FADE_TIMER_DIV / (FADE_PWM_TOP + 1);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Fades one color to a level.
+ *
+ * @details
+ * The ramp is linear in level and gamma corrected through the table, so it looks linear in brightness. A fade
+ * that interrupts one still in progress starts from the level the interrupted ramp had reached.
+ *
+ * @note
+ * The ramp is one step per PWM period and is capped at FADE_MAX_STEPS, longer durations are shortened. Only
+ * stopping the old ramp and starting the new one mask interrupts, the ramp is built in between.
+ *
+ * @param[in] color
+ * A single COLOR_* bit that was opened
+ *
+ * @param[in] level
+ * Target brightness, 0 (off) to 255 (full)
+ *
+ * @param[in] duration_ms
+ * Length of the fade in milliseconds
+ *
+ ******************************************************************************/
+void led_fade_to(uint32_t color, uint8_t level, uint32_t duration_ms){
+  FADE_CHANNEL *fade = &fade_channel[fade_index(color)];
+  LDMA_TransferCfg_t config = LDMA_TRANSFER_CFG_PERIPHERAL(FADE_LDMA_SIGNAL);
+  uint32_t steps = duration_ms * fade_step_hz / 1000;
+
+  if(steps < 1){
+      steps = 1;
+  }
+  if(steps > FADE_MAX_STEPS){
+      steps = FADE_MAX_STEPS;
+  }
+
+  /* Atomic event */
+  CORE_DECLARE_IRQ_STATE; //Save IRQ state
+  CORE_ENTER_CRITICAL(); //disables interrupts and saves IEN bit
+
+  // Stop the ramp in progress, the compare register holds the level it reached while the new one is built
+  uint8_t from = fade->level;
+  if(fade->fading){
+      ldma_stop(fade->ldma_ch);
+      int32_t done = fade->steps - ldma_remaining(fade->ldma_ch);
+      from = fade->start_level + ((int32_t)fade->level - fade->start_level) * done / (int32_t)fade->steps;
+      fade->fading = false;
+  }
+  CORE_EXIT_CRITICAL(); //Restores interrupt processes
+
+  // The LDMA no longer reads the ramp, it is rebuilt with interrupts enabled
+  for(uint32_t i = 0; i < steps; i++){
+      uint32_t step_level = from + ((int32_t)level - from) * (int32_t)(i + 1) / (int32_t)steps;
+      fade->ramp[i] = fade_gamma[step_level];
+  }
+  fade->descriptor = (LDMA_Descriptor_t)LDMA_DESCRIPTOR_SINGLE_M2P_BYTE(fade->ramp, &FADE_TIMER->CC[fade_index(color)].CCVB, steps);
+  fade->descriptor.xfer.size = ldmaCtrlSizeWord;
+  metric_fade_ramps[0]++;
+  metric_fade_steps[0] += steps;
+
+  CORE_ENTER_CRITICAL(); //disables interrupts and saves IEN bit
+  fade->start_level = from;
+  fade->level = level;
+  fade->steps = steps;
+  fade->fading = true;
+  fade_run(true);
+  ldma_start(fade->ldma_ch, &config, &fade->descriptor, fade_done);
+
+  CORE_EXIT_CRITICAL(); //Restores interrupt processes
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns true while any color is fading.
+ ******************************************************************************/
+bool led_fade_busy(void){
+  for(int i = 0; i < FADE_CHANNELS; i++){
+      if(fade_channel[i].fading){
+          return true;
+      }
+  }
+  return false;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the level a color is at, or is fading to.
+ ******************************************************************************/
+uint8_t led_fade_level(uint32_t color){
+  return fade_channel[fade_index(color)].level;
+}
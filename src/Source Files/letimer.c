@@ -31,6 +31,51 @@ static uint32_t scheduled_uf_cb;
 //***********************************************************************************
 // Private functions
 //***********************************************************************************
+static uint32_t letimer_counts(float period, float active_period, uint32_t *period_cnt, uint32_t *active_cnt);
+
+/***************************************************************************//**
+ * @brief
+ * Computes the prescaler, COMP0 and COMP1 of a PWM period.
+ *
+ * @details
+ * Periods longer than COMP0 can count at LETIMER_HZ run from a prescaled clock, so the LETIMER still only
+ * interrupts at COMP1 and the underflow of each period instead of on intermediate wraps. The smallest
+ * power of two prescaler that fits is used. A prescaled active period is rounded up, never shorter.
+ *
+ * @param[in] period
+ * PWM period in seconds
+ *
+ * @param[in] active_period
+ * PWM active period in seconds
+ *
+ * @param[out] period_cnt
+ * COMP0
+ *
+ * @param[out] active_cnt
+ * COMP1
+ *
+ * @return
+ * LETIMER clock prescaler
+ *
+ ******************************************************************************/
+static uint32_t letimer_counts(float period, float active_period, uint32_t *period_cnt, uint32_t *active_cnt){
+  uint32_t period_ms = period * LETIMER_HZ;
+  uint32_t div = 1;
+
+  while(period_ms / div > LETIMER_MAX_COUNT){
+      div <<= 1;
+  }
+  EFM_ASSERT(div <= LETIMER_MAX_DIV);
+
+  *period_cnt = period_ms / div;
+  *active_cnt = active_period * LETIMER_HZ;
+  *active_cnt = (*active_cnt + div - 1) / div;
+  if(*active_cnt == 0){
+      *active_cnt = 1;
+  }
+  EFM_ASSERT(*active_cnt < *period_cnt);
+  return div;
+}
 
 
 //***********************************************************************************
@@ -66,8 +111,9 @@ static uint32_t scheduled_uf_cb;
 void letimer_pwm_open(LETIMER_TypeDef *letimer, APP_LETIMER_PWM_TypeDef *app_letimer_struct){
 	LETIMER_Init_TypeDef letimer_pwm_values;
 
-	unsigned int period_cnt;
-	unsigned int period_active_cnt;
+	uint32_t period_cnt;
+	uint32_t period_active_cnt;
+	uint32_t div;
 
 
 	/*  Initializing LETIMER for PWM mode */
@@ -77,6 +123,12 @@ void letimer_pwm_open(LETIMER_TypeDef *letimer, APP_LETIMER_PWM_TypeDef *app_let
 	}
 	letimer_start(letimer,false);             //Disables the LETIMER (in case it was already on)
 
+	// Long periods run from a prescaled LETIMER clock, see letimer_counts()
+	div = letimer_counts(app_letimer_struct->period, app_letimer_struct->active_period, &period_cnt, &period_active_cnt);
+	if(letimer == LETIMER0){
+	    CMU_ClockDivSet(cmuClock_LETIMER0, div);
+	}
+
   // Verify whether the LETIMER clock tree properly configured and enabled
   /* Use EFM_ASSERT statements to verify whether the LETIMER clock tree is properly
    * configured and enabled
@@ -121,12 +173,7 @@ void letimer_pwm_open(LETIMER_TypeDef *letimer, APP_LETIMER_PWM_TypeDef *app_let
 	while(letimer->SYNCBUSY); //Verifies that we have completed syncronization process
 
 
-  /* Calculate the value of COMP0 and COMP1 and load these control registers
-   * with the calculated values
-   */
-	period_cnt = app_letimer_struct->period * LETIMER_HZ;
-	period_active_cnt = app_letimer_struct->active_period * LETIMER_HZ;
-
+  /* Load COMP0 and COMP1 with the values calculated by letimer_counts() */
 	LETIMER_CompareSet(letimer, 0, period_cnt);				    // comp0 register is PWM period
 	LETIMER_CompareSet(letimer, 1, period_active_cnt);		// comp1 register is PWM active period
 
@@ -210,6 +257,120 @@ void letimer_start(LETIMER_TypeDef *letimer, bool enable){
 }
 
 
+/***************************************************************************//**
+ * @brief
+ * Changes the PWM period of a running LETIMER without restarting it.
+ *
+ * @details
+ * With comp0Top COMP0 is only loaded into CNT at an underflow, so the period in progress completes at its
+ * old length and the new period starts with the next one. COMP1 takes effect immediately, a shorter active
+ * period still matches in the current period as long as CNT has not passed it. No interrupt is lost or doubled.
+ *
+ * @note
+ * The prescaler cannot change while the LETIMER counts. If the new period needs another prescaler nothing is
+ * changed and false is returned, the caller opens the LETIMER again instead.
+ *
+ * @param[in] letimer
+ * Pointer to the base peripheral address of the LETIMER peripheral, opened with letimer_pwm_open()
+ *
+ * @param[in] period
+ * PWM period in seconds
+ *
+ * @param[in] active_period
+ * PWM active period in seconds
+ *
+ * @return
+ * False if the period needs another prescaler
+ *
+ ******************************************************************************/
+bool letimer_pwm_period_set(LETIMER_TypeDef *letimer, float period, float active_period){
+  uint32_t period_cnt;
+  uint32_t period_active_cnt;
+
+  EFM_ASSERT(letimer == LETIMER0);
+  if(letimer_counts(period, active_period, &period_cnt, &period_active_cnt) != CMU_ClockDivGet(cmuClock_LETIMER0)){
+      return false;
+  }
+
+  LETIMER_CompareSet(letimer, 0, period_cnt);
+  LETIMER_CompareSet(letimer, 1, period_active_cnt);
+  while(letimer->SYNCBUSY);
+  return true;
+}
+
+
+/***************************************************************************//**
+ * @brief
+ * Returns the number of LETIMER ticks until the next enabled COMP0, COMP1 or underflow interrupt
+ *
+ * @details
+ * The LETIMER counts down from COMP0 to 0, so COMP1 fires when CNT reaches COMP1 and the underflow fires
+ * when CNT passes 0 and COMP0 is reloaded. The distance to each enabled interrupt is computed from the
+ * current count and the smallest one is returned. 0xFFFFFFFF is returned if the LETIMER is not running
+ * or no interrupt is enabled.
+ *
+ * @note
+ * Ticks are one millisecond with the ULFRCO (LETIMER_HZ = 1000) unless the period needed the clock prescaled,
+ * letimer_ms_to_ticks() converts a time to them. This is used by the main loop to decide whether there is enough time before the next deadline to
+ * run idle work instead of sleeping.
+ *
+ * @param[in] letimer
+ * Pointer to the base peripheral address of the LETIMER peripheral being checked
+ *
+ ******************************************************************************/
+uint32_t letimer_ticks_to_next_event(LETIMER_TypeDef *letimer){
+  uint32_t ticks = 0xFFFFFFFF;
+  uint32_t cnt, top, comp1;
+
+  if(!(letimer->STATUS & LETIMER_STATUS_RUNNING)){
+      return ticks;
+  }
+
+  cnt = letimer->CNT;
+  top = letimer->COMP0;
+  comp1 = letimer->COMP1;
+
+  if(letimer->IEN & LETIMER_IEN_UF){
+      ticks = cnt; //underflow occurs once CNT passes 0
+  }
+  if(letimer->IEN & LETIMER_IEN_COMP1){
+      uint32_t comp1_ticks = (cnt >= comp1) ? (cnt - comp1) : (cnt + 1 + top - comp1); //wraps through the reload if already below COMP1
+      if(comp1_ticks < ticks){
+          ticks = comp1_ticks;
+      }
+  }
+  if(letimer->IEN & LETIMER_IEN_COMP0){
+      uint32_t comp0_ticks = cnt + 1; //COMP0 matches right after the reload
+      if(comp0_ticks < ticks){
+          ticks = comp0_ticks;
+      }
+  }
+  return ticks;
+}
+
+
+/***************************************************************************//**
+ * @brief
+ * Converts a time in milliseconds to LETIMER ticks, rounded up
+ *
+ * @details
+ * A tick is the prescaler letimer_pwm_open() selected for the period divided by LETIMER_HZ. Rounding up keeps a
+ * headroom check comparing against the result conservative, even when a tick is longer than the time asked for.
+ *
+ * @param[in] letimer
+ * Pointer to the base peripheral address of the LETIMER peripheral being checked
+ *
+ * @param[in] ms
+ * Time in milliseconds
+ *
+ ******************************************************************************/
+uint32_t letimer_ms_to_ticks(LETIMER_TypeDef *letimer, uint32_t ms){
+  EFM_ASSERT(letimer == LETIMER0);
+  uint32_t div = CMU_ClockDivGet(cmuClock_LETIMER0);
+  return (uint32_t)(((uint64_t)ms * LETIMER_HZ + 1000 * div - 1) / (1000 * div));
+}
+
+
 /***************************************************************************//**
  * @brief
  * This function handles all LETIMER0 interrupts that are triggered
@@ -0,0 +1,334 @@
+/**
+ * @file
+ * leuart.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * This module configures the LEUART and implements interrupt driven transmit and receive
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "leuart.h"
+
+//***********************************************************************************
+// Private Variables
+//***********************************************************************************
+static LEUART_STATE_MACHINE leuart0_state;
+METRIC_COUNTER(leuart_tx_bytes);
+METRIC_COUNTER(leuart_rx_bytes);
+METRIC_COUNTER(leuart_rx_overflows);   // bytes dropped because the receive buffer was full
+METRIC_COUNTER(leuart_sessions);       // wakes by the host, each one holds EM2 until LEUART_SESSION_MS without traffic
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * This state machine function services TXBL interrupts
+ *
+ * @details
+ * Each TXBL interrupt writes the next byte to TXDATA. After the last byte, TXBL is disabled and TXC is
+ * enabled so the transmission is only reported complete once the stop bit of the last byte has left the pin.
+ *
+ ******************************************************************************/
+static void Txbl_Func(LEUART_STATE_MACHINE *leuart_sm){
+  leuart_sm->activity = true;
+  if(leuart_sm->tx_remaining){
+      leuart_sm->leuart->TXDATA = *leuart_sm->tx_data++;
+      leuart_sm->tx_remaining--;
+      METRIC_INC(leuart_tx_bytes);
+  }
+  if(leuart_sm->tx_remaining == 0){
+      leuart_sm->leuart->IEN &= ~LEUART_IEN_TXBL;
+      leuart_sm->leuart->IFC = LEUART_IFC_TXC;
+      leuart_sm->leuart->IEN |= LEUART_IEN_TXC;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * This state machine function services TXC interrupts
+ *
+ * @details
+ * The transmission is complete, the sleep mode block taken in leuart_start() is released and the transmit
+ * callback is scheduled.
+ *
+ ******************************************************************************/
+static void Txc_Func(LEUART_STATE_MACHINE *leuart_sm){
+  leuart_sm->leuart->IEN &= ~LEUART_IEN_TXC;
+  leuart_sm->available = true;
+  sleep_unblock_mode(LEUART_EM_BLOCK);
+  add_scheduled_event(leuart_sm->tx_cb);
+}
+
+/***************************************************************************//**
+ * @brief
+ * This state machine function services RXDATAV interrupts
+ *
+ * @details
+ * The received byte is placed in the receive ring buffer and the receive callback is scheduled. If the
+ * buffer is full the byte is dropped and counted.
+ *
+ ******************************************************************************/
+static void Rxdatav_Func(LEUART_STATE_MACHINE *leuart_sm){
+  uint8_t byte = leuart_sm->leuart->RXDATA;
+
+  leuart_sm->activity = true;
+
+  if(leuart_sm->rx_head - leuart_sm->rx_tail >= LEUART_RX_BUF_SIZE){
+      METRIC_INC(leuart_rx_overflows);
+  }else{
+      leuart_sm->rx_buf[leuart_sm->rx_head % LEUART_RX_BUF_SIZE] = byte;
+      leuart_sm->rx_head++;
+      METRIC_INC(leuart_rx_bytes);
+  }
+  add_scheduled_event(leuart_sm->rx_cb);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Arms the RX pin edge that starts the next session.
+ *
+ * @note
+ * Called with interrupts disabled, or before the wake interrupt is enabled.
+ ******************************************************************************/
+static void leuart_wake_arm(void){
+  GPIO_IntClear(1 << LEUART_RX_PIN);
+  GPIO_IntEnable(1 << LEUART_RX_PIN);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Starts a receive session on the wake edge of the RX pin.
+ *
+ * @details
+ * EM3 is blocked so the LFXO and the LEUART keep running until leuart_session_poll() ends the session. The
+ * byte whose start bit woke the board is lost while the LFXO restarts.
+ ******************************************************************************/
+static void leuart_wake(void){
+  GPIO_IntDisable(1 << LEUART_RX_PIN);
+  GPIO_IntClear(1 << LEUART_RX_PIN);
+  if(!leuart0_state.session){
+      leuart0_state.session = true;
+      leuart0_state.activity = true;
+      sleep_block_mode(LEUART_EM_BLOCK);
+      METRIC_INC(leuart_sessions);
+  }
+}
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Initializes the LEUART peripheral
+ *
+ * @details
+ * This function enables the LEUART clock, initializes the frame format and baud rate, routes TX and RX to the
+ * desired pins and enables the receive interrupt.
+ *
+ * EM3 is not blocked while the link is idle, so the board keeps the EM3 floor of the ULFRCO LETIMER instead of
+ * holding the LFXO and EM2 for good. A falling edge on the RX pin, the start bit of a byte from the host, starts
+ * a session that blocks EM3 until leuart_session_poll() sees LEUART_SESSION_MS without traffic. The byte that
+ * wakes the board is lost, so a host sends a wake byte and waits for the LFXO before its first frame.
+ *
+ * @note
+ * This function is called once in app_peripheral_setup(). The LFB clock tree must be running from the LFXO.
+ *
+ * @param[in] leuart
+ * A pointer/address to the desired LEUART peripheral to be initialized
+ *
+ * @param[in] leuart_setup
+ * A struct that contains all the app specific values for initialization
+ ******************************************************************************/
+void leuart_open(LEUART_TypeDef *leuart, LEUART_OPEN_STRUCT *leuart_setup){
+  LEUART_Init_TypeDef leuart_values;
+
+  EFM_ASSERT(leuart == LEUART0);
+  CMU_ClockEnable(cmuClock_LEUART0, true);
+
+  leuart0_state.leuart = leuart;
+  leuart0_state.available = true;
+  leuart0_state.tx_cb = leuart_setup->tx_cb;
+  leuart0_state.rx_cb = leuart_setup->rx_cb;
+  leuart0_state.rx_head = 0;
+  leuart0_state.rx_tail = 0;
+  leuart0_state.session = false;
+  leuart0_state.activity = false;
+
+  leuart_values.baudrate = leuart_setup->baudrate;
+  leuart_values.databits = leuart_setup->databits;
+  leuart_values.parity = leuart_setup->parity;
+  leuart_values.stopbits = leuart_setup->stopbits;
+  leuart_values.enable = leuart_setup->enable;
+  leuart_values.refFreq = 0; //use the LFB clock frequency
+
+  LEUART_Init(leuart, &leuart_values);
+  while(leuart->SYNCBUSY);
+
+  // Route LEUART to desired location
+  leuart->ROUTELOC0 = leuart_setup->tx_route | leuart_setup->rx_route;
+  leuart->ROUTEPEN |= (LEUART_ROUTEPEN_TXPEN * leuart_setup->tx_en);
+  leuart->ROUTEPEN |= (LEUART_ROUTEPEN_RXPEN * leuart_setup->rx_en);
+
+  leuart->CMD = LEUART_CMD_CLEARRX | LEUART_CMD_CLEARTX;
+  while(leuart->SYNCBUSY);
+
+  leuart->IFC = leuart->IF;
+  leuart->IEN |= LEUART_IEN_RXDATAV;
+  NVIC_EnableIRQ(LEUART0_IRQn);
+
+  // Start bit edge of the RX pin wakes the board, the pin stays routed to the LEUART
+  GPIO_ExtIntConfig(LEUART_RX_PORT, LEUART_RX_PIN, LEUART_RX_PIN, false, true, false);
+  leuart_wake_arm();
+  NVIC_ClearPendingIRQ(LEUART_WAKE_IRQn);
+  NVIC_EnableIRQ(LEUART_WAKE_IRQn);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Begins an interrupt driven transmission
+ *
+ * @details
+ * The data is not copied, it must stay valid until the transmit callback is scheduled. EM3 is blocked for the
+ * length of the transmission on top of the receive block.
+ *
+ * @param[in] leuart
+ * A pointer/address to the LEUART peripheral
+ *
+ * @param[in] data
+ * Bytes to transmit
+ *
+ * @param[in] length
+ * Number of bytes to transmit
+ ******************************************************************************/
+void leuart_start(LEUART_TypeDef *leuart, const uint8_t *data, uint32_t length){
+  EFM_ASSERT(leuart == LEUART0);
+  EFM_ASSERT(length);
+  while(!leuart0_state.available);
+
+  sleep_block_mode(LEUART_EM_BLOCK);
+
+  leuart0_state.available = false;
+  leuart0_state.tx_data = data;
+  leuart0_state.tx_remaining = length;
+
+  leuart->IEN |= LEUART_IEN_TXBL; //TXBL is already set, the interrupt sends the first byte
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns true if no transmission is in progress
+ ******************************************************************************/
+bool leuart_tx_available(LEUART_TypeDef *leuart){
+  EFM_ASSERT(leuart == LEUART0);
+  return leuart0_state.available;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Takes one received byte from the receive buffer
+ *
+ * @param[in] leuart
+ * A pointer/address to the LEUART peripheral
+ *
+ * @param[out] byte
+ * Received byte
+ *
+ * @return
+ * False if no byte was waiting
+ ******************************************************************************/
+bool leuart_read(LEUART_TypeDef *leuart, uint8_t *byte){
+  EFM_ASSERT(leuart == LEUART0);
+  if(leuart0_state.rx_tail == leuart0_state.rx_head){
+      return false;
+  }
+  *byte = leuart0_state.rx_buf[leuart0_state.rx_tail % LEUART_RX_BUF_SIZE];
+  leuart0_state.rx_tail++;
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Ends the receive session once the link has been quiet for LEUART_SESSION_MS.
+ *
+ * @details
+ * The EM3 block is released and the RX pin edge is armed again for the next session. A transmission in
+ * progress counts as traffic.
+ *
+ * @note
+ * This is called once per logged sample batch, so a session ends within a sample period of the timeout.
+ *
+ * @param[in] leuart
+ * A pointer/address to the LEUART peripheral
+ *
+ * @param[in] now_ms
+ * Current time in milliseconds, may wrap
+ ******************************************************************************/
+void leuart_session_poll(LEUART_TypeDef *leuart, uint32_t now_ms){
+  EFM_ASSERT(leuart == LEUART0);
+
+  /* Atomic event */
+  CORE_DECLARE_IRQ_STATE;
+  CORE_ENTER_CRITICAL();
+  if(leuart0_state.session){
+      if(leuart0_state.activity || !leuart0_state.available){
+          leuart0_state.activity = false;
+          leuart0_state.active_ms = now_ms;
+      }else if(now_ms - leuart0_state.active_ms >= LEUART_SESSION_MS){
+          leuart0_state.session = false;
+          leuart_wake_arm();
+          sleep_unblock_mode(LEUART_EM_BLOCK);
+      }
+  }
+  CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ * Interrupt handler for the LEUART0 peripheral
+ *
+ * @details
+ * This function handles the TXBL, TXC and RXDATAV interrupts by calling the state machine functions.
+ ******************************************************************************/
+void LEUART0_IRQHandler(void){
+  uint32_t int_flag = LEUART0->IF & LEUART0->IEN;
+  LEUART0->IFC = int_flag;
+
+  if(int_flag & LEUART_IF_RXDATAV){
+      Rxdatav_Func(&leuart0_state);
+  }
+  if(int_flag & LEUART_IF_TXBL){
+      Txbl_Func(&leuart0_state);
+  }
+  if(int_flag & LEUART_IF_TXC){
+      Txc_Func(&leuart0_state);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Interrupt handler of the GPIO external interrupts that share the RX pin's parity
+ *
+ * @details
+ * Only the RX pin wake edge is enabled on it, other EXTI lines (the sync input PRS source) never interrupt.
+ ******************************************************************************/
+#if LEUART_RX_PIN & 1
+void GPIO_ODD_IRQHandler(void){
+#else
+void GPIO_EVEN_IRQHandler(void){
+#endif
+  uint32_t int_flag = GPIO_IntGetEnabled();
+
+  if(int_flag & (1 << LEUART_RX_PIN)){
+      leuart_wake();
+  }
+}
@@ -0,0 +1,132 @@
+/**
+ * @file
+ * log_code.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that converts light readings to and from 16 bit log codes without floating point
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "log_code.h"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+// log2(1 + i / 64) in Q16, the fraction of a log2 from the mantissa
+static const uint32_t log_code_log2[(1 << LOG_CODE_TABLE_BITS) + 1] = {
+  0, 1466, 2909, 4331, 5732, 7112, 8473, 9814,
+  11136, 12440, 13727, 14996, 16248, 17484, 18704, 19909,
+  21098, 22272, 23433, 24579, 25711, 26830, 27936, 29029,
+  30109, 31178, 32234, 33279, 34312, 35334, 36346, 37346,
+  38336, 39316, 40286, 41246, 42196, 43137, 44068, 44990,
+  45904, 46809, 47705, 48593, 49472, 50344, 51207, 52063,
+  52911, 53751, 54584, 55410, 56229, 57040, 57845, 58643,
+  59434, 60219, 60997, 61769, 62534, 63294, 64047, 64794,
+  65536
+};
+
+// 2^(i / 64) in Q16, the mantissa from the fraction of a log2
+static const uint32_t log_code_exp2[(1 << LOG_CODE_TABLE_BITS) + 1] = {
+  65536, 66250, 66971, 67700, 68438, 69183, 69936, 70698,
+  71468, 72246, 73032, 73828, 74632, 75444, 76266, 77096,
+  77936, 78785, 79642, 80510, 81386, 82273, 83169, 84074,
+  84990, 85915, 86851, 87796, 88752, 89719, 90696, 91684,
+  92682, 93691, 94711, 95743, 96785, 97839, 98905, 99982,
+  101070, 102171, 103283, 104408, 105545, 106694, 107856, 109031,
+  110218, 111418, 112631, 113858, 115098, 116351, 117618, 118899,
+  120194, 121502, 122825, 124163, 125515, 126882, 128263, 129660,
+  131072
+};
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Encodes a reading as a log code.
+ *
+ * @details
+ * The integer part of the log2 is the position of the leading one. The raw count is normalized so the leading
+ * one is bit 31, the next LOG_CODE_TABLE_BITS bits select a table entry and the 16 bits below them interpolate
+ * to the next one. The fraction is rounded to LOG_CODE_FRAC_BITS, a fraction that rounds up to 1 carries into
+ * the integer part.
+ *
+ * @param[in] raw
+ * Raw count, up to 16 bits
+ *
+ * @param[in] gain_shift
+ * log2 of the gain the count was measured at, up to LOG_CODE_MAX_GAIN
+ *
+ * @return
+ * Log code, LOG_CODE_ZERO for a zero count
+ *
+ ******************************************************************************/
+uint16_t log_code_encode(uint32_t raw, uint32_t gain_shift){
+  EFM_ASSERT(raw <= 0xFFFF && gain_shift <= LOG_CODE_MAX_GAIN);
+  if(raw == 0){
+      return LOG_CODE_ZERO;
+  }
+
+  uint32_t msb = 31 - __CLZ(raw);
+  uint32_t mant = raw << (31 - msb);
+  uint32_t index = (mant >> (31 - LOG_CODE_TABLE_BITS)) & ((1 << LOG_CODE_TABLE_BITS) - 1);
+  uint32_t weight = (mant >> (15 - LOG_CODE_TABLE_BITS)) & 0xFFFF;
+  uint32_t lo = log_code_log2[index];
+  uint32_t frac = lo + (((log_code_log2[index + 1] - lo) * weight) >> 16);
+
+  frac = (frac + (1 << (15 - LOG_CODE_FRAC_BITS))) >> (16 - LOG_CODE_FRAC_BITS);
+  return ((msb + LOG_CODE_BIAS - gain_shift) << LOG_CODE_FRAC_BITS) + frac;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Decodes a log code to a fixed point calibrated reading.
+ *
+ * @details
+ * The fraction selects an entry of the exp2 table and interpolates to the next one, which gives the mantissa.
+ * The integer part then shifts it into place, rounding on a right shift.
+ *
+ * @param[in] code
+ * Log code
+ *
+ * @param[in] q
+ * Fraction bits of the result, the reading at gain 0 times 2^q
+ *
+ * @return
+ * Calibrated reading in Q q, saturated to 0xFFFFFFFF
+ *
+ ******************************************************************************/
+uint32_t log_code_decode(uint16_t code, uint32_t q){
+  if(code == LOG_CODE_ZERO){
+      return 0;
+  }
+
+  int32_t exponent = (int32_t)(code >> LOG_CODE_FRAC_BITS) - LOG_CODE_BIAS + (int32_t)q - 16;
+  uint32_t frac = code & ((1 << LOG_CODE_FRAC_BITS) - 1);
+  uint32_t index = frac >> (LOG_CODE_FRAC_BITS - LOG_CODE_TABLE_BITS);
+  uint32_t weight = frac & ((1 << (LOG_CODE_FRAC_BITS - LOG_CODE_TABLE_BITS)) - 1);
+  uint32_t lo = log_code_exp2[index];
+  uint32_t mant = lo + (((log_code_exp2[index + 1] - lo) * weight) >> (LOG_CODE_FRAC_BITS - LOG_CODE_TABLE_BITS));
+
+  if(exponent >= 0){
+      return exponent < 15 ? mant << exponent : 0xFFFFFFFF;   //mant is below 2^17
+  }
+  if(exponent <= -32){
+      return 0;
+  }
+  return (mant + (1 << (-exponent - 1))) >> -exponent;
+}
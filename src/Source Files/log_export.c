@@ -0,0 +1,588 @@
+/**
+ * @file
+ * log_export.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that exports the sample log to a host over the LEUART, resuming from the host's last sequence number
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "log_export.h"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+static LEUART_TypeDef *export_leuart;
+static uint8_t export_tx_frame[EXPORT_MAX_PAYLOAD + EXPORT_FRAME_OVERHEAD];
+
+// Receive frame parser
+static EXPORT_RX_STATE export_rx_state;
+static uint8_t export_rx_type;
+static uint8_t export_rx_length;
+static uint8_t export_rx_count;
+static uint8_t export_rx_payload[EXPORT_RX_MAX_PAYLOAD];
+static uint16_t export_rx_crc;
+
+// Stream state
+static bool export_streaming;
+static uint32_t export_send_seq;    // next sequence number to send
+static uint32_t export_credits;     // blocks the host will still accept
+
+// Segment stream state, the doors carry a series across frames
+static bool export_segments;        // START_PLA, knots are sent instead of samples
+static uint32_t export_pla_error;   // code error of a segment in code steps
+static PLA_DOOR export_code_door;
+static PLA_DOOR export_time_door;
+static bool export_series;          // the doors hold a series, the last sample added was export_last_seq
+static uint32_t export_last_seq;
+
+METRIC_COUNTER(export_blocks);
+METRIC_COUNTER(export_samples);
+METRIC_COUNTER(export_payload_bytes);
+METRIC_COUNTER(export_pla_samples);     // samples sent as segments
+METRIC_COUNTER(export_pla_knots);
+METRIC_COUNTER(export_pla_bytes);
+METRIC_GAUGE(export_pla_ratio);         // samples per knot times 100 since reset
+METRIC_COUNTER(export_rx_crc_errors);
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static uint32_t export_put_u16(uint8_t *dst, uint16_t value);
+static uint32_t export_put_u32(uint8_t *dst, uint32_t value);
+static uint32_t export_put_uvarint(uint8_t *dst, uint32_t value);
+static uint32_t export_put_varint(uint8_t *dst, int32_t value);
+static uint32_t export_get_u32(const uint8_t *src);
+static void export_send(uint8_t type, uint32_t length);
+static uint32_t export_encode_block(uint8_t *payload);
+static uint32_t export_put_knot(uint8_t *payload, uint32_t length, uint32_t count, const EXPORT_KNOT *prev, const EXPORT_KNOT *knot);
+static void export_close_knot(EXPORT_KNOT *knot);
+static uint32_t export_encode_segments(uint8_t *payload);
+static uint32_t export_encode_desc(uint32_t index, uint8_t *payload);
+static void export_pump(void);
+static void export_command(void);
+
+/***************************************************************************//**
+ * @brief
+ * Writes a 16-bit value little endian and returns the number of bytes written.
+ ******************************************************************************/
+static uint32_t export_put_u16(uint8_t *dst, uint16_t value){
+  dst[0] = value;
+  dst[1] = value >> 8;
+  return 2;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Writes a 32-bit value little endian and returns the number of bytes written.
+ ******************************************************************************/
+static uint32_t export_put_u32(uint8_t *dst, uint32_t value){
+  dst[0] = value;
+  dst[1] = value >> 8;
+  dst[2] = value >> 16;
+  dst[3] = value >> 24;
+  return 4;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Reads a 32-bit little endian value.
+ ******************************************************************************/
+static uint32_t export_get_u32(const uint8_t *src){
+  return src[0] | (src[1] << 8) | (src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Writes an unsigned value as a varint, 7 bits per byte, and returns the number of bytes written.
+ ******************************************************************************/
+static uint32_t export_put_uvarint(uint8_t *dst, uint32_t value){
+  uint32_t length = 0;
+
+  while(value >= 0x80){
+      dst[length++] = (value & 0x7F) | 0x80;
+      value >>= 7;
+  }
+  dst[length++] = value;
+  return length;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Writes a signed value as a zigzag varint and returns the number of bytes written.
+ *
+ * @details
+ * Zigzag maps small negative and positive values to small unsigned values, and the varint uses 7 bits per byte,
+ * so slowly changing light levels and a steady sample period take one byte each.
+ ******************************************************************************/
+static uint32_t export_put_varint(uint8_t *dst, int32_t value){
+  return export_put_uvarint(dst, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+/***************************************************************************//**
+ * @brief
+ * Adds the frame header and CRC around the payload in export_tx_frame and starts the transmission.
+ *
+ * @param[in] type
+ * Frame type
+ *
+ * @param[in] length
+ * Payload length, the payload must already be in place after the 3 header bytes
+ ******************************************************************************/
+static void export_send(uint8_t type, uint32_t length){
+  EFM_ASSERT(length <= EXPORT_MAX_PAYLOAD);
+
+  export_tx_frame[0] = EXPORT_SOF;
+  export_tx_frame[1] = type;
+  export_tx_frame[2] = length;
+  uint16_t crc = log_export_crc16(0xFFFF, &export_tx_frame[1], length + 2);
+  export_tx_frame[length + 3] = crc & 0xFF;
+  export_tx_frame[length + 4] = crc >> 8;
+
+  leuart_start(export_leuart, export_tx_frame, length + EXPORT_FRAME_OVERHEAD);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Encodes the samples from export_send_seq into a block payload.
+ *
+ * @details
+ * The first sample is sent in full, every following one as a timestamp delta-of-delta and a log code delta.
+ * Samples are added while a worst case sample still fits, so a block never exceeds EXPORT_MAX_PAYLOAD.
+ *
+ * @param[out] payload
+ * Buffer for the block payload
+ *
+ * @return
+ * Payload length
+ ******************************************************************************/
+static uint32_t export_encode_block(uint8_t *payload){
+  SAMPLE_RECORD record;
+  uint32_t length = 0;
+  uint32_t count = 0;
+  uint32_t prev_timestamp = 0;
+  uint16_t prev_code = 0;
+  int32_t prev_delta = 0;
+
+  if(!sample_log_get(export_send_seq, &record)){
+      return 0;
+  }
+  length += export_put_u32(&payload[length], record.seq);
+  length++; //count is filled in below
+  length += export_put_u32(&payload[length], record.timestamp);
+  length += export_put_u16(&payload[length], record.code);
+  prev_timestamp = record.timestamp;
+  prev_code = record.code;
+  count = 1;
+
+  while(count < 0xFF && length + EXPORT_MAX_SAMPLE_BYTES <= EXPORT_MAX_PAYLOAD
+        && sample_log_get(export_send_seq + count, &record)){
+      int32_t delta = (int32_t)(record.timestamp - prev_timestamp);
+      length += export_put_varint(&payload[length], delta - prev_delta);
+      length += export_put_varint(&payload[length], (int32_t)record.code - (int32_t)prev_code);
+      prev_delta = delta;
+      prev_timestamp = record.timestamp;
+      prev_code = record.code;
+      count++;
+  }
+  payload[4] = count;
+
+  export_send_seq += count;
+  METRIC_INC(export_blocks);
+  METRIC_ADD(export_samples, count);
+  METRIC_ADD(export_payload_bytes, length);
+  return length;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Adds a knot to a segments payload and returns the new payload length.
+ *
+ * @details
+ * The first knot of a payload is sent in full, every following one as deltas from the knot before it.
+ *
+ * @param[in] payload
+ * Segments payload
+ *
+ * @param[in] length
+ * Payload length so far
+ *
+ * @param[in] count
+ * Knots in the payload so far
+ *
+ * @param[in] prev
+ * Knot added before this one, unused for the first knot
+ *
+ * @param[in] knot
+ * Knot to add
+ ******************************************************************************/
+static uint32_t export_put_knot(uint8_t *payload, uint32_t length, uint32_t count, const EXPORT_KNOT *prev, const EXPORT_KNOT *knot){
+  if(!count){
+      length += export_put_u32(&payload[length], knot->seq);
+      length++; //count is filled in by the caller
+      length += export_put_u32(&payload[length], knot->timestamp);
+      length += export_put_u32(&payload[length], knot->code);
+      payload[length++] = knot->starts;
+  }else{
+      length += export_put_uvarint(&payload[length], ((knot->seq - prev->seq) << 1) | knot->starts);
+      length += export_put_varint(&payload[length], (int32_t)(knot->timestamp - prev->timestamp));
+      length += export_put_varint(&payload[length], knot->code - prev->code);
+  }
+  return length;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Ends the segment in progress at the last sample added and returns its end knot.
+ ******************************************************************************/
+static void export_close_knot(EXPORT_KNOT *knot){
+  knot->code = pla_close(&export_code_door);
+  knot->timestamp = (pla_close(&export_time_door) + (1 << (PLA_FRAC_BITS - 1))) >> PLA_FRAC_BITS;
+  knot->seq = export_last_seq;
+  knot->starts = false;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Encodes the samples from export_send_seq into a segments payload.
+ *
+ * @details
+ * Each sample is added to a code door and a timestamp door, a knot is sent only when a sample does not fit
+ * either of them, so the work per sample is constant and a plateau or a steady ramp costs nothing until it
+ * ends. The segment in progress is carried to the next payload. Once the log has no more samples the segment is
+ * ended at the last one, so the host is never behind by the samples of an open segment. A sample that does not
+ * follow the last one, after the log wrapped past export_send_seq, ends the open segment at the last sample sent
+ * and starts a new series, so the samples counted as sent are always covered by knots. Samples are added while
+ * two worst case knots still fit.
+ *
+ * @param[out] payload
+ * Buffer for the segments payload
+ *
+ * @return
+ * Payload length
+ ******************************************************************************/
+static uint32_t export_encode_segments(uint8_t *payload){
+  SAMPLE_RECORD record;
+  EXPORT_KNOT knot;
+  EXPORT_KNOT prev;
+  uint32_t length = 0;
+  uint32_t count = 0;
+  uint32_t samples = 0;
+
+  while(count + 2 <= 0xFF && length + EXPORT_SEGMENT_HEADER + EXPORT_MAX_KNOT_BYTES <= EXPORT_MAX_PAYLOAD){
+      if(!sample_log_get(export_send_seq, &record)){
+          if(pla_pending(&export_code_door)){
+              export_close_knot(&knot);
+              length = export_put_knot(payload, length, count++, &prev, &knot);
+          }
+          break;
+      }
+
+      bool follows = export_series && record.seq == export_last_seq + 1;
+      if(!follows || !pla_fits(&export_code_door, record.seq, record.code)
+                  || !pla_fits(&export_time_door, record.seq, record.timestamp)){
+          if(follows){
+              export_close_knot(&knot);
+              length = export_put_knot(payload, length, count++, &prev, &knot);
+              prev = knot;
+          }else{
+              if(export_series && pla_pending(&export_code_door)){
+                  export_close_knot(&knot);
+                  length = export_put_knot(payload, length, count++, &prev, &knot);
+                  prev = knot;
+              }
+              pla_start(&export_code_door, export_pla_error, record.seq, record.code);
+              pla_start(&export_time_door, EXPORT_PLA_TIME_ERROR, record.seq, record.timestamp);
+              knot.seq = record.seq;
+              knot.timestamp = record.timestamp;
+              knot.code = record.code << PLA_FRAC_BITS;
+              knot.starts = true;
+              length = export_put_knot(payload, length, count++, &prev, &knot);
+              prev = knot;
+              export_series = true;
+          }
+      }
+      if(follows){
+          pla_add(&export_code_door, record.seq, record.code);
+          pla_add(&export_time_door, record.seq, record.timestamp);
+      }
+      export_last_seq = record.seq;
+      export_send_seq++;
+      samples++;
+  }
+  payload[4] = count;
+
+  METRIC_INC(export_blocks);
+  METRIC_ADD(export_pla_samples, samples);
+  METRIC_ADD(export_pla_knots, count);
+  METRIC_ADD(export_pla_bytes, length);
+  METRIC_ADD(export_payload_bytes, length);
+  if(metric_export_pla_knots[0]){
+      METRIC_SET(export_pla_ratio, metric_export_pla_samples[0] * 100 / metric_export_pla_knots[0]);
+  }
+  return length;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Encodes a metric descriptor into a METRIC_DESC payload.
+ *
+ * @details
+ * The name is sent without its terminator and cut to the frame, the value address lets the host find the
+ * values in the metrics block with the data_addr of the METRICS_HEADER.
+ *
+ * @param[in] index
+ * Index of the descriptor
+ *
+ * @param[out] payload
+ * Buffer for the payload
+ *
+ * @return
+ * Payload length, 2 if there is no descriptor at index
+ ******************************************************************************/
+static uint32_t export_encode_desc(uint32_t index, uint8_t *payload){
+  const METRIC_DESC *desc = metrics_desc(index);
+  uint32_t length = export_put_u16(payload, index);
+
+  if(!desc){
+      return length;
+  }
+  payload[length++] = desc->type;
+  payload[length++] = desc->words;
+  length += export_put_u32(&payload[length], (uint32_t)desc->value);
+  for(const char *name = desc->name; *name && length < EXPORT_MAX_PAYLOAD; name++){
+      payload[length++] = *name;
+  }
+  return length;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Sends the next block if the host has credit for it, or END once the host is up to date.
+ *
+ * @details
+ * If the log wrapped past export_send_seq during the transfer, streaming skips to the oldest record and the
+ * gap shows up in the first_seq of the next block.
+ ******************************************************************************/
+static void export_pump(void){
+  if(!export_streaming || !export_credits || !leuart_tx_available(export_leuart)){
+      return;
+  }
+  if(export_send_seq < sample_log_oldest()){
+      export_send_seq = sample_log_oldest();
+  }
+  if(export_send_seq >= sample_log_next() && !(export_segments && pla_pending(&export_code_door))){
+      export_put_u32(&export_tx_frame[3], sample_log_next());
+      export_send(EXPORT_RSP_END, 4);
+      export_streaming = false;
+      return;
+  }
+  if(export_segments){
+      export_send(EXPORT_RSP_SEGMENTS, export_encode_segments(&export_tx_frame[3]));
+  }else{
+      export_send(EXPORT_RSP_BLOCK, export_encode_block(&export_tx_frame[3]));
+  }
+  export_credits--;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Handles a complete, CRC checked command frame.
+ ******************************************************************************/
+static void export_command(void){
+  switch(export_rx_type){
+    case EXPORT_CMD_INFO:
+      if(leuart_tx_available(export_leuart)){
+          export_put_u32(&export_tx_frame[3], sample_log_oldest());
+          export_put_u32(&export_tx_frame[7], sample_log_next());
+          export_send(EXPORT_RSP_INFO, 8);
+      }
+      break;
+    case EXPORT_CMD_START:
+      if(export_rx_length == 5){
+          export_send_seq = export_get_u32(export_rx_payload);
+          export_credits = export_rx_payload[4];
+          export_streaming = true;
+          export_segments = false;
+      }
+      break;
+    case EXPORT_CMD_START_PLA:
+      if(export_rx_length == 6){
+          export_send_seq = export_get_u32(export_rx_payload);
+          export_credits = export_rx_payload[4];
+          export_pla_error = export_rx_payload[5];
+          export_streaming = true;
+          export_segments = true;
+          export_series = false;
+          export_code_door.points = 0;    //a segment left open by a STOP belongs to the old stream
+          export_time_door.points = 0;
+      }
+      break;
+    case EXPORT_CMD_CREDIT:
+      if(export_rx_length == 1){
+          export_credits += export_rx_payload[0];
+      }
+      break;
+    case EXPORT_CMD_STOP:
+      export_streaming = false;
+      break;
+    case EXPORT_CMD_METRICS:
+      if(export_rx_length == 4 && leuart_tx_available(export_leuart)){
+          uint32_t offset = export_get_u32(export_rx_payload);
+          export_put_u32(&export_tx_frame[3], offset);
+          export_send(EXPORT_RSP_METRICS, 4 + metrics_read(offset, &export_tx_frame[7], EXPORT_METRICS_CHUNK));
+      }
+      break;
+    case EXPORT_CMD_METRIC_DESC:
+      if(export_rx_length == 2 && leuart_tx_available(export_leuart)){
+          export_send(EXPORT_RSP_METRIC_DESC, export_encode_desc(export_rx_payload[0] | (export_rx_payload[1] << 8), &export_tx_frame[3]));
+      }
+      break;
+    case EXPORT_CMD_PROFILE:
+      if(export_rx_length == 1){
+          bool accepted = profile_request(export_rx_payload[0]);
+          if(leuart_tx_available(export_leuart)){
+              export_tx_frame[3] = export_rx_payload[0];
+              export_tx_frame[4] = accepted;
+              export_send(EXPORT_RSP_PROFILE, 2);
+          }
+      }
+      break;
+    default:
+      break;
+  }
+  export_pump();
+}
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Initializes the export protocol on an opened LEUART.
+ *
+ * @note
+ * This function is called once in app_peripheral_setup() after leuart_open().
+ *
+ * @param[in] leuart
+ * LEUART the host is connected to
+ *
+ ******************************************************************************/
+void log_export_open(LEUART_TypeDef *leuart){
+  export_leuart = leuart;
+  export_rx_state = export_wait_sof;
+  export_streaming = false;
+  export_segments = false;
+  export_series = false;
+  export_credits = 0;
+  export_send_seq = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Parses the received bytes and handles any complete command.
+ *
+ * @details
+ * Bytes are taken from the LEUART receive buffer through a frame state machine. A frame with a bad CRC is
+ * dropped; the host retries the command after its timeout.
+ *
+ * @note
+ * This function is called from the LEUART receive scheduled callback.
+ *
+ ******************************************************************************/
+void log_export_rx(void){
+  uint8_t byte;
+
+  while(leuart_read(export_leuart, &byte)){
+      switch(export_rx_state){
+        case export_wait_sof:
+          if(byte == EXPORT_SOF){
+              export_rx_state = export_wait_type;
+          }
+          break;
+        case export_wait_type:
+          export_rx_type = byte;
+          export_rx_state = export_wait_length;
+          break;
+        case export_wait_length:
+          export_rx_length = byte;
+          export_rx_count = 0;
+          if(byte > EXPORT_RX_MAX_PAYLOAD){
+              export_rx_state = export_wait_sof;
+          }else{
+              export_rx_state = byte ? export_wait_payload : export_wait_crc_low;
+          }
+          break;
+        case export_wait_payload:
+          export_rx_payload[export_rx_count++] = byte;
+          if(export_rx_count == export_rx_length){
+              export_rx_state = export_wait_crc_low;
+          }
+          break;
+        case export_wait_crc_low:
+          export_rx_crc = byte;
+          export_rx_state = export_wait_crc_high;
+          break;
+        case export_wait_crc_high:
+        default: {
+          uint8_t header[2] = { export_rx_type, export_rx_length };
+          uint16_t crc = log_export_crc16(0xFFFF, header, 2);
+          crc = log_export_crc16(crc, export_rx_payload, export_rx_length);
+          export_rx_crc |= byte << 8;
+          export_rx_state = export_wait_sof;
+          if(crc == export_rx_crc){
+              export_command();
+          }else{
+              METRIC_INC(export_rx_crc_errors);
+          }
+          break;
+        }
+      }
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Continues the stream once the previous frame has been transmitted.
+ *
+ * @note
+ * This function is called from the LEUART transmit scheduled callback.
+ *
+ ******************************************************************************/
+void log_export_tx_done(void){
+  export_pump();
+}
+
+/***************************************************************************//**
+ * @brief
+ * Computes a CRC-16/CCITT (polynomial 0x1021) over a buffer.
+ *
+ * @param[in] crc
+ * Starting value, 0xFFFF for a new CRC or a previous result to continue it
+ *
+ * @param[in] data
+ * Bytes to include
+ *
+ * @param[in] length
+ * Number of bytes
+ *
+ ******************************************************************************/
+uint16_t log_export_crc16(uint16_t crc, const uint8_t *data, uint32_t length){
+  while(length--){
+      crc ^= (uint16_t)(*data++) << 8;
+      for(int i = 0; i < 8; i++){
+          crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+      }
+  }
+  return crc;
+}
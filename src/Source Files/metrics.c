@@ -0,0 +1,124 @@
+/**
+ * @file
+ * metrics.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that dumps the counters, gauges and histograms declared across the drivers as one binary block
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "metrics.h"
+#include <string.h>
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+// Section boundaries provided by config/linkerfile.ld
+extern uint32_t __metrics_start__[];
+extern uint32_t __metrics_end__[];
+extern const METRIC_DESC __metrics_desc_start__[];
+extern const METRIC_DESC __metrics_desc_end__[];
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Clears every metric.
+ *
+ * @details
+ * The metrics block is part of .bss and is already zero after reset. This function clears it again so that
+ * statistics can be restarted without a reset.
+ *
+ * @note
+ * This function is called once in app_peripheral_setup() before any peripheral is opened.
+ *
+ ******************************************************************************/
+void metrics_open(void){
+  memset(__metrics_start__, 0, metrics_size());
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the size in bytes of the metrics block.
+ *
+ ******************************************************************************/
+uint32_t metrics_size(void){
+  return (uint32_t)((uint8_t *)__metrics_end__ - (uint8_t *)__metrics_start__);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Copies part of the metrics dump, a METRICS_HEADER followed by the metrics block exactly as it is laid out in RAM.
+ *
+ * @details
+ * The values are contiguous because the linker collects them into one section, so a transport reads the dump
+ * in pieces of its frame size without visiting the descriptors. The host maps the values to names with the
+ * descriptors from metrics_desc() and data_addr.
+ *
+ * @note
+ * The block is not copied first, so a counter updated from an interrupt between two pieces may be one update
+ * ahead of the others.
+ *
+ * @param[in] offset
+ * Byte offset into the dump
+ *
+ * @param[out] dst
+ * Buffer for the bytes
+ *
+ * @param[in] length
+ * Bytes wanted
+ *
+ * @return
+ * Bytes copied, less than length at the end of the dump and 0 past it
+ ******************************************************************************/
+uint32_t metrics_read(uint32_t offset, uint8_t *dst, uint32_t length){
+  METRICS_HEADER header;
+  uint32_t total = sizeof(header) + metrics_size();
+  uint32_t copied = 0;
+
+  if(offset >= total){
+      return 0;
+  }
+  if(length > total - offset){
+      length = total - offset;
+  }
+
+  if(offset < sizeof(header)){
+      header.magic = METRICS_MAGIC;
+      header.version = METRICS_VERSION;
+      header.desc_count = (uint16_t)(__metrics_desc_end__ - __metrics_desc_start__);
+      header.data_addr = (uint32_t)__metrics_start__;
+      header.length = metrics_size();
+      copied = sizeof(header) - offset < length ? sizeof(header) - offset : length;
+      memcpy(dst, (const uint8_t *)&header + offset, copied);
+  }
+  memcpy(&dst[copied], (const uint8_t *)__metrics_start__ + (offset + copied - sizeof(header)), length - copied);
+  return length;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns a metric descriptor by its index in the descriptor table.
+ *
+ * @param[in] index
+ * Index below the desc_count of the METRICS_HEADER
+ *
+ * @return
+ * Descriptor of the metric, or 0 past the end of the table
+ ******************************************************************************/
+const METRIC_DESC *metrics_desc(uint32_t index){
+  if(index >= (uint32_t)(__metrics_desc_end__ - __metrics_desc_start__)){
+      return 0;
+  }
+  return &__metrics_desc_start__[index];
+}
@@ -0,0 +1,232 @@
+/**
+ * @file
+ * pipeline.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that passes samples through a chain of processing stages without copying them
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "pipeline.h"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+static PIPE_SAMPLE pipe_pool[PIPE_POOL_SIZE];
+static PIPE_RING pipe_free;           // slots not holding a sample
+static PIPE_STAGE pipe_stages[PIPE_MAX_STAGES];
+static uint32_t pipe_stage_count;
+
+METRIC_COUNTER(pipe_drops);           // samples lost because every slot was in use
+METRIC_DECLARE(pipe_samples, metric_counter, PIPE_MAX_STAGES);    // per stage throughput
+METRIC_DECLARE(pipe_batches, metric_counter, PIPE_MAX_STAGES);
+METRIC_DECLARE(pipe_cycles, metric_counter, PIPE_MAX_STAGES);
+METRIC_DECLARE(pipe_depth_max, metric_gauge, PIPE_MAX_STAGES);    // per stage queue depth high water mark
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static void ring_push(PIPE_RING *ring, uint8_t slot);
+static uint8_t ring_pop(PIPE_RING *ring);
+static uint32_t ring_depth(const PIPE_RING *ring);
+
+/***************************************************************************//**
+ * @brief
+ * Adds a slot index to a ring. Only the producer of the ring may call this.
+ ******************************************************************************/
+static void ring_push(PIPE_RING *ring, uint8_t slot){
+  EFM_ASSERT(ring->head - ring->tail < PIPE_RING_SIZE);
+  ring->slot[ring->head % PIPE_RING_SIZE] = slot;
+  ring->head++;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Removes the oldest slot index from a ring, or returns PIPE_NO_SLOT. Only the consumer of the ring may call this.
+ ******************************************************************************/
+static uint8_t ring_pop(PIPE_RING *ring){
+  if(ring->tail == ring->head){
+      return PIPE_NO_SLOT;
+  }
+  uint8_t slot = ring->slot[ring->tail % PIPE_RING_SIZE];
+  ring->tail++;
+  return slot;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the number of slot indices waiting in a ring.
+ ******************************************************************************/
+static uint32_t ring_depth(const PIPE_RING *ring){
+  return ring->head - ring->tail;
+}
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Initializes the sample pool and removes all stages.
+ *
+ * @note
+ * This function is called once in app_peripheral_setup() before the stages are added.
+ *
+ ******************************************************************************/
+void pipeline_open(void){
+  pipe_free.head = 0;
+  pipe_free.tail = 0;
+  for(int i = 0; i < PIPE_POOL_SIZE; i++){
+      ring_push(&pipe_free, i);
+  }
+  pipe_stage_count = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Appends a stage to the end of the chain.
+ *
+ * @details
+ * Samples pass through the stages in the order they are added. Each stage has its own scheduler event so it is
+ * dispatched from the main loop like any other callback, and a priority that decides which stage runs first
+ * when several have samples waiting.
+ *
+ * @param[in] name
+ * Name of the stage, kept for debugging
+ *
+ * @param[in] func
+ * Function that processes a batch of samples
+ *
+ * @param[in] event
+ * Scheduler event id of the stage
+ *
+ * @param[in] priority
+ * 0 is the highest priority
+ *
+ * @return
+ * Index of the stage, also its index in the pipe_* metric arrays
+ *
+ ******************************************************************************/
+uint32_t pipeline_add_stage(const char *name, PIPE_STAGE_FUNC func, uint32_t event, uint32_t priority){
+  EFM_ASSERT(pipe_stage_count < PIPE_MAX_STAGES);
+  EFM_ASSERT(func && event != SCHED_NO_EVENT);
+  for(uint32_t i = 0; i < pipe_stage_count; i++){
+      EFM_ASSERT(pipe_stages[i].event != event);
+  }
+
+  PIPE_STAGE *stage = &pipe_stages[pipe_stage_count];
+  stage->name = name;
+  stage->func = func;
+  stage->event = event;
+  stage->priority = priority;
+  stage->in.head = 0;
+  stage->in.tail = 0;
+  return pipe_stage_count++;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Takes a free sample slot for the source to write into.
+ *
+ * @return
+ * Slot to fill, or 0 if every slot is still in the pipeline (the sample is counted as dropped)
+ *
+ ******************************************************************************/
+PIPE_SAMPLE *pipeline_alloc(void){
+  uint8_t slot = ring_pop(&pipe_free);
+
+  if(slot == PIPE_NO_SLOT){
+      METRIC_INC(pipe_drops);
+      return 0;
+  }
+  return &pipe_pool[slot];
+}
+
+/***************************************************************************//**
+ * @brief
+ * Hands a filled sample slot to the first stage.
+ *
+ * @param[in] sample
+ * Slot returned by pipeline_alloc()
+ *
+ ******************************************************************************/
+void pipeline_submit(PIPE_SAMPLE *sample){
+  EFM_ASSERT(pipe_stage_count);
+  ring_push(&pipe_stages[0].in, sample - pipe_pool);
+  add_scheduled_event(pipe_stages[0].event);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Runs one batch of the highest priority stage whose event is scheduled.
+ *
+ * @details
+ * Up to PIPE_BATCH slots are taken from the stage's ring and processed in one call, then handed to the next
+ * stage's ring, or back to the free pool after the last stage. If the stage still has samples waiting its event
+ * is scheduled again, so the main loop gets to service other events between batches.
+ *
+ * @note
+ * This function is the scheduler handler of every stage event.
+ *
+ ******************************************************************************/
+void pipeline_service(void){
+  PIPE_SAMPLE *batch[PIPE_BATCH];
+  uint32_t index = PIPE_MAX_STAGES;
+
+  for(uint32_t i = 0; i < pipe_stage_count; i++){
+      if(is_scheduled_event(pipe_stages[i].event) && (index == PIPE_MAX_STAGES || pipe_stages[i].priority < pipe_stages[index].priority)){
+          index = i;
+      }
+  }
+  if(index == PIPE_MAX_STAGES){
+      return;
+  }
+
+  PIPE_STAGE *stage = &pipe_stages[index];
+  remove_scheduled_event(stage->event);
+
+  uint32_t depth = ring_depth(&stage->in);
+  if(depth > metric_pipe_depth_max[index]){
+      metric_pipe_depth_max[index] = depth;
+  }
+
+  uint32_t count = 0;
+  uint8_t slots[PIPE_BATCH];
+  while(count < PIPE_BATCH){
+      uint8_t slot = ring_pop(&stage->in);
+      if(slot == PIPE_NO_SLOT){
+          break;
+      }
+      slots[count] = slot;
+      batch[count++] = &pipe_pool[slot];
+  }
+  if(!count){
+      return;
+  }
+
+  uint32_t start = timing_cycles();
+  stage->func(batch, count);
+  metric_pipe_cycles[index] += timing_cycles_since(start);
+  metric_pipe_samples[index] += count;
+  metric_pipe_batches[index]++;
+
+  PIPE_RING *next = (index + 1 < pipe_stage_count) ? &pipe_stages[index + 1].in : &pipe_free;
+  for(uint32_t i = 0; i < count; i++){
+      ring_push(next, slots[i]);
+  }
+  if(next != &pipe_free){
+      add_scheduled_event(pipe_stages[index + 1].event);
+  }
+  if(ring_depth(&stage->in)){
+      add_scheduled_event(stage->event);
+  }
+}
@@ -0,0 +1,178 @@
+/**
+ * @file
+ * pla.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that approximates a series by connected line segments within a fixed error, one point at a time
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "pla.h"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static int64_t pla_scale(int64_t num, uint32_t x, uint32_t dx);
+
+/***************************************************************************//**
+ * @brief
+ * Returns num * x / dx rounded to nearest.
+ ******************************************************************************/
+static int64_t pla_scale(int64_t num, uint32_t x, uint32_t dx){
+  int64_t product = num * x;
+
+  return product >= 0 ? (product + dx / 2) / dx : -((-product + dx / 2) / dx);
+}
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Starts a series at its first point.
+ *
+ * @details
+ * The first point is the first knot, so it is reproduced exactly.
+ *
+ * @param[in] door
+ * Door of the series
+ *
+ * @param[in] error
+ * Largest distance of a point from its segment, in input units
+ *
+ * @param[in] x
+ * Position of the point
+ *
+ * @param[in] value
+ * Value of the point
+ *
+ ******************************************************************************/
+void pla_start(PLA_DOOR *door, uint32_t error, uint32_t x, int64_t value){
+  door->anchor = value << PLA_FRAC_BITS;
+  door->anchor_x = x;
+  door->error = (int64_t)error << PLA_FRAC_BITS;
+  door->last_x = x;
+  door->points = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Checks that a point can be added to the segment in progress.
+ *
+ * @details
+ * The point's own door, its value plus and minus the error seen from the anchor, has to overlap the doors of
+ * the points before it. Slopes are compared as cross products, so there is no division per point.
+ *
+ * @param[in] door
+ * Door of the series
+ *
+ * @param[in] x
+ * Position of the point, after the last point added
+ *
+ * @param[in] value
+ * Value of the point
+ *
+ * @return
+ * False if the segment has to end before this point
+ *
+ ******************************************************************************/
+bool pla_fits(const PLA_DOOR *door, uint32_t x, int64_t value){
+  uint32_t dx = x - door->anchor_x;
+  int64_t offset = (value << PLA_FRAC_BITS) - door->anchor;
+
+  if(dx == 0 || dx > PLA_MAX_SPAN || x - door->last_x > PLA_MAX_SPAN){
+      return false;
+  }
+  if(!door->points){
+      return true;
+  }
+  return (offset - door->error) * door->upper_dx <= door->upper * dx
+      && door->lower * dx <= (offset + door->error) * door->lower_dx;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Adds a point to the segment in progress and narrows its doors.
+ *
+ * @note
+ * The point must fit, pla_fits() is checked first.
+ *
+ * @param[in] door
+ * Door of the series
+ *
+ * @param[in] x
+ * Position of the point
+ *
+ * @param[in] value
+ * Value of the point
+ *
+ ******************************************************************************/
+void pla_add(PLA_DOOR *door, uint32_t x, int64_t value){
+  uint32_t dx = x - door->anchor_x;
+  int64_t offset = (value << PLA_FRAC_BITS) - door->anchor;
+  int64_t upper = offset + door->error;
+  int64_t lower = offset - door->error;
+
+  EFM_ASSERT(pla_fits(door, x, value));
+  if(!door->points || upper * door->upper_dx < door->upper * dx){
+      door->upper = upper;
+      door->upper_dx = dx;
+  }
+  if(!door->points || lower * door->lower_dx > door->lower * dx){
+      door->lower = lower;
+      door->lower_dx = dx;
+  }
+  door->last_x = x;
+  door->points++;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns true if points were added since the last knot.
+ ******************************************************************************/
+bool pla_pending(const PLA_DOOR *door){
+  return door->points != 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Ends the segment in progress at the last point added.
+ *
+ * @details
+ * The segment takes the slope halfway between its doors, which every point of the segment allows, so each one
+ * is within the error of it. The knot at the end is rounded to PLA_FRAC_BITS, which can move the points of the
+ * segment by at most one fraction step. The knot becomes the anchor of the next segment, so the segments are
+ * connected.
+ *
+ * @param[in] door
+ * Door of the series
+ *
+ * @return
+ * Knot at the last point added, in PLA_FRAC_BITS fixed point
+ *
+ ******************************************************************************/
+int64_t pla_close(PLA_DOOR *door){
+  if(door->points){
+      uint32_t dx = door->last_x - door->anchor_x;
+      int64_t rise = pla_scale(door->upper, dx, door->upper_dx) + pla_scale(door->lower, dx, door->lower_dx);
+
+      door->anchor += rise >= 0 ? (rise + 1) / 2 : -((-rise + 1) / 2);
+      door->anchor_x = door->last_x;
+      door->points = 0;
+  }
+  return door->anchor;
+}
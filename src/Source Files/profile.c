@@ -0,0 +1,177 @@
+/**
+ * @file
+ * profile.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that switches the application between operating profiles at a sample boundary
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "profile.h"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+static const PROFILE *profile_table;
+static uint32_t profile_count;
+static PROFILE_APPLY profile_apply;
+static uint32_t profile_id;                   // profile in use, kept across a warm reset
+static volatile uint32_t profile_pending;     // requested profile, PROFILE_NONE if there is none
+static uint32_t profile_last_ms;              // time of the last sample boundary
+static uint32_t profile_request_ms;           // last boundary before the pending request was made
+
+METRIC_GAUGE(profile_active);
+METRIC_COUNTER(profile_switches);
+METRIC_COUNTER(profile_rejected);             // requests for a profile that does not exist
+METRIC_GAUGE(profile_apply_cycles);           // time the last switch held the main loop
+METRIC_GAUGE(profile_apply_cycles_max);
+METRIC_GAUGE(profile_wait_ms);                // request to switch of the last switch, at sample resolution
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Selects the profile table and applies the first profile.
+ *
+ * @details
+ * After a warm reset the profile in use before the reset is applied again instead of initial, so a switch
+ * made at runtime survives it.
+ *
+ * @note
+ * This function is called in app_peripheral_setup() after retain_open() and after every peripheral the apply
+ * function reconfigures is open.
+ *
+ * @param[in] table
+ * Profiles, indexed by id
+ *
+ * @param[in] count
+ * Number of profiles
+ *
+ * @param[in] initial
+ * Profile applied on a cold boot
+ *
+ * @param[in] apply
+ * Function that moves the hardware to a profile
+ *
+ ******************************************************************************/
+void profile_open(const PROFILE *table, uint32_t count, uint32_t initial, PROFILE_APPLY apply){
+  EFM_ASSERT(table && apply && initial < count);
+
+  profile_table = table;
+  profile_count = count;
+  profile_apply = apply;
+  profile_pending = PROFILE_NONE;
+  profile_last_ms = 0;
+
+  profile_id = initial;
+  retain_add(&profile_id, sizeof(profile_id));
+  if(profile_id >= count){
+      profile_id = initial;
+  }
+
+  profile_apply(0, &profile_table[profile_id]);
+  METRIC_SET(profile_active, profile_id);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Requests a switch to another profile.
+ *
+ * @details
+ * The switch is made at the next sample boundary. A later request before that boundary replaces an earlier
+ * one, only the last profile requested is applied.
+ *
+ * @param[in] id
+ * Profile to switch to
+ *
+ * @return
+ * False if there is no such profile
+ *
+ ******************************************************************************/
+bool profile_request(uint32_t id){
+  if(id >= profile_count){
+      METRIC_INC(profile_rejected);
+      return false;
+  }
+  if(profile_pending == PROFILE_NONE){
+      profile_request_ms = profile_last_ms;
+  }
+  profile_pending = id;
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Applies a requested profile at a sample boundary.
+ *
+ * @details
+ * A boundary is the point where the last sample has been read and the next one has not been started, so every
+ * setting is changed between two samples and no sample is taken with a mix of two profiles. The whole switch
+ * runs in the main loop in one call, nothing else the application does can observe it half done.
+ *
+ * @note
+ * This function is called once the result of a sample has been read, before the next FORCE.
+ *
+ * @param[in] now_ms
+ * Time of the sample
+ *
+ ******************************************************************************/
+void profile_boundary(uint32_t now_ms){
+  uint32_t id = profile_pending;
+
+  profile_last_ms = now_ms;
+  if(id == PROFILE_NONE){
+      return;
+  }
+  profile_pending = PROFILE_NONE;
+  if(id == profile_id){
+      return;
+  }
+
+  uint32_t start = timing_cycles();
+  profile_apply(&profile_table[profile_id], &profile_table[id]);
+  profile_id = id;
+  uint32_t cycles = timing_cycles_since(start);
+
+  METRIC_SET(profile_active, id);
+  METRIC_INC(profile_switches);
+  METRIC_SET(profile_apply_cycles, cycles);
+  METRIC_MAX(profile_apply_cycles_max, cycles);
+  METRIC_SET(profile_wait_ms, now_ms - profile_request_ms);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the id of the profile in use.
+ ******************************************************************************/
+uint32_t profile_current(void){
+  return profile_id;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns a profile of the table.
+ *
+ * @param[in] id
+ * Profile id
+ *
+ ******************************************************************************/
+const PROFILE *profile_get(uint32_t id){
+  EFM_ASSERT(id < profile_count);
+  return &profile_table[id];
+}
@@ -0,0 +1,245 @@
+/**
+ * @file
+ * retain.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that keeps application state in no-init RAM across warm resets
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "retain.h"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+extern uint32_t __etext[];          // end of the flash image, from the linker script
+extern uint32_t __bss_end__[];
+
+// Two slots, sealed alternately, so a reset during a seal still leaves the previous one valid
+static RETAIN_SLOT retain_slots[2] RETAIN_NOINIT;
+static const RETAIN_SLOT *retain_source;    // slot restored from, null on a cold boot
+static uint32_t retain_target;              // slot the next seal writes
+static uint32_t retain_generation;
+
+static void *retain_region_data[RETAIN_REGIONS];
+static uint32_t retain_region_bytes[RETAIN_REGIONS];
+static uint32_t retain_region_count;
+static uint32_t retain_bytes;               // payload registered so far, each region starts on a word
+
+METRIC_GAUGE(retain_reset_cause);           // RMU reset cause of this boot
+METRIC_COUNTER(retain_resumes);             // warm resets the state was restored on, itself retained
+METRIC_COUNTER(retain_rejected);            // warm resets without a valid slot of this build
+METRIC_COUNTER(retain_seals);
+METRIC_GAUGE(retain_seal_cycles);
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static uint32_t retain_build(void);
+static uint32_t retain_slot_crc(const RETAIN_SLOT *slot);
+static bool retain_slot_valid(const RETAIN_SLOT *slot);
+
+/***************************************************************************//**
+ * @brief
+ * Returns an identity of the running image.
+ *
+ * @details
+ * Any change to the code or to the RAM layout moves the end of the flash image or of the bss, so state sealed
+ * by another build is never copied into variables it was not taken from.
+ *
+ ******************************************************************************/
+static uint32_t retain_build(void){
+  return (uint32_t)__etext ^ ((uint32_t)__bss_end__ << 12);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Computes the CRC of a slot's header and the payload in use.
+ *
+ ******************************************************************************/
+static uint32_t retain_slot_crc(const RETAIN_SLOT *slot){
+  uint32_t words = (offsetof(RETAIN_SLOT, data) + slot->bytes) / sizeof(uint32_t);
+
+  return retain_crc32((const uint32_t *)slot, words);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Checks that a slot was completely sealed by this build.
+ *
+ ******************************************************************************/
+static bool retain_slot_valid(const RETAIN_SLOT *slot){
+  return slot->magic == RETAIN_MAGIC && slot->build == retain_build() && slot->bytes <= sizeof(slot->data)
+      && slot->crc == retain_slot_crc(slot);
+}
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Reads the reset cause and finds the state to resume from.
+ *
+ * @details
+ * Only a reset in RETAIN_WARM_CAUSES with none of RETAIN_COLD_CAUSES resumes. The newer of the two slots that
+ * pass their CRC and belong to this build is then restored region by region as modules register with
+ * retain_add(). The reset cause is cleared so the next boot reads only its own.
+ *
+ * @note
+ * This function is called in app_peripheral_setup() after metrics_open() and before any module that
+ * registers a region is opened.
+ *
+ ******************************************************************************/
+void retain_open(void){
+  GPCRC_Init_TypeDef gpcrc_init = GPCRC_INIT_DEFAULT;
+  uint32_t cause;
+  bool warm;
+
+  CMU_ClockEnable(cmuClock_GPCRC, true);
+  gpcrc_init.initValue = 0xFFFFFFFF;
+  GPCRC_Init(GPCRC, &gpcrc_init);
+
+  cause = RMU_ResetCauseGet();
+  RMU_ResetCauseClear();
+  METRIC_SET(retain_reset_cause, cause);
+  warm = (cause & RETAIN_WARM_CAUSES) && !(cause & RETAIN_COLD_CAUSES);
+
+  retain_source = 0;
+  retain_target = 0;
+  retain_generation = 0;
+  retain_region_count = 0;
+  retain_bytes = 0;
+
+  if(warm){
+      for(int slot = 0; slot < 2; slot++){
+          if(!retain_slot_valid(&retain_slots[slot])){
+              continue;
+          }
+          if(!retain_source || (int32_t)(retain_slots[slot].generation - retain_source->generation) > 0){
+              retain_source = &retain_slots[slot];
+              retain_target = !slot;
+          }
+      }
+      if(retain_source){
+          retain_generation = retain_source->generation;
+      }else{
+          METRIC_INC(retain_rejected);
+      }
+  }
+
+  retain_add(metric_retain_resumes, sizeof(metric_retain_resumes));
+  if(retain_source){
+      METRIC_INC(retain_resumes);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Registers a variable to be kept across warm resets.
+ *
+ * @details
+ * When resuming, the variable is restored immediately from the same position of the slot. Regions must be
+ * registered in the same order on every boot, which they are as long as the build does not change.
+ *
+ * @param[in] data
+ * Variable to keep
+ *
+ * @param[in] bytes
+ * Size of the variable
+ *
+ ******************************************************************************/
+void retain_add(void *data, uint32_t bytes){
+  uint32_t offset = retain_bytes;
+
+  EFM_ASSERT(retain_region_count < RETAIN_REGIONS);
+  EFM_ASSERT(offset + bytes <= sizeof(retain_slots[0].data));
+
+  retain_region_data[retain_region_count] = data;
+  retain_region_bytes[retain_region_count] = bytes;
+  retain_region_count++;
+  retain_bytes += (bytes + 3) & ~3;
+
+  if(retain_source){
+      EFM_ASSERT(offset + bytes <= retain_source->bytes);
+      memcpy(data, (const uint8_t *)retain_source->data + offset, bytes);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Copies every registered region into the older slot and seals it.
+ *
+ * @details
+ * The CRC is written last, so a reset in the middle of a seal leaves that slot invalid and the other one,
+ * one seal older, is restored instead.
+ *
+ * @note
+ * This is called once the state of a sample has been updated. It is not safe from interrupt context, the
+ * regions belong to the main loop.
+ *
+ ******************************************************************************/
+void retain_seal(void){
+  uint32_t start = timing_cycles();
+  RETAIN_SLOT *slot = &retain_slots[retain_target];
+  uint8_t *payload = (uint8_t *)slot->data;
+  uint32_t offset = 0;
+
+  slot->crc = 0;
+  for(uint32_t region = 0; region < retain_region_count; region++){
+      memcpy(payload + offset, retain_region_data[region], retain_region_bytes[region]);
+      offset += (retain_region_bytes[region] + 3) & ~3;
+  }
+  slot->magic = RETAIN_MAGIC;
+  slot->build = retain_build();
+  slot->generation = ++retain_generation;
+  slot->bytes = offset;
+  slot->crc = retain_slot_crc(slot);
+
+  retain_target = !retain_target;
+  METRIC_INC(retain_seals);
+  METRIC_SET(retain_seal_cycles, timing_cycles_since(start));
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns true if this boot resumed from retained state.
+ *
+ ******************************************************************************/
+bool retain_resumed(void){
+  return retain_source != 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Computes a CRC-32 with the GPCRC peripheral.
+ *
+ * @details
+ * Ethernet polynomial with an all ones start value, one word per write.
+ *
+ * @note
+ * The GPCRC is shared, so this is only called from the main loop.
+ *
+ * @param[in] words
+ * Data to check
+ *
+ * @param[in] count
+ * Number of words
+ *
+ ******************************************************************************/
+uint32_t retain_crc32(const uint32_t *words, uint32_t count){
+  GPCRC_Start(GPCRC);
+  while(count--){
+      GPCRC_InputU32(GPCRC, *words++);
+  }
+  return GPCRC_DataRead(GPCRC);
+}
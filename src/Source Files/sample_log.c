@@ -0,0 +1,217 @@
+/**
+ * @file
+ * sample_log.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that stores the most recent samples in a ring indexed by sequence number
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "sample_log.h"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+// Records survive a warm reset, each one carries a CRC of its sequence number, timestamp and code. A reading is
+// stored as its 16 bit log code, see log_code.h, half the size of the raw count.
+static uint32_t log_timestamp[SAMPLE_LOG_SIZE] RETAIN_NOINIT;
+static uint16_t log_code[SAMPLE_LOG_SIZE] RETAIN_NOINIT;
+static uint32_t log_check[SAMPLE_LOG_SIZE] RETAIN_NOINIT;
+static uint32_t log_next_seq;   // sequence number of the next sample to be written
+static uint32_t log_count;      // records held, up to SAMPLE_LOG_SIZE
+static SEQLOCK log_lock;        // an append against readers of the records, the sequence number and the count
+METRIC_COUNTER(log_appends);
+METRIC_COUNTER(log_overwrites);  // oldest record dropped to make room
+METRIC_GAUGE(log_resume_recovered);   // records appended after the last seal and found again on a warm reset
+METRIC_GAUGE(log_resume_dropped);     // records that failed their check on a warm reset
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static uint32_t sample_log_check(uint32_t seq);
+static void sample_log_resume(void);
+
+/***************************************************************************//**
+ * @brief
+ * Returns the check of the record stored for a sequence number.
+ *
+ * @param[in] seq
+ * Sequence number the record is expected to hold
+ *
+ ******************************************************************************/
+static uint32_t sample_log_check(uint32_t seq){
+  uint32_t record[3] = { seq, log_timestamp[seq % SAMPLE_LOG_SIZE], log_code[seq % SAMPLE_LOG_SIZE] };
+
+  return retain_crc32(record, 3);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Validates the retained records after a warm reset.
+ *
+ * @details
+ * The sequence number and count come from the last seal. Records appended after it are found by checking
+ * forward from there, then records are checked back from the newest and the log ends at the first one that
+ * fails, which can only be the oldest record if a reset hit the append that was overwriting it.
+ *
+ ******************************************************************************/
+static void sample_log_resume(void){
+  uint32_t recovered = 0;
+  uint32_t expected;
+  uint32_t valid = 0;
+
+  while(recovered < SAMPLE_LOG_SIZE && log_check[(log_next_seq + recovered) % SAMPLE_LOG_SIZE] == sample_log_check(log_next_seq + recovered)){
+      recovered++;
+  }
+  log_next_seq += recovered;
+  expected = log_count + recovered;
+  if(expected > SAMPLE_LOG_SIZE || expected > log_next_seq){
+      expected = SAMPLE_LOG_SIZE < log_next_seq ? SAMPLE_LOG_SIZE : log_next_seq;
+  }
+
+  while(valid < expected && log_check[(log_next_seq - 1 - valid) % SAMPLE_LOG_SIZE] == sample_log_check(log_next_seq - 1 - valid)){
+      valid++;
+  }
+  log_count = valid;
+
+  METRIC_SET(log_resume_recovered, recovered);
+  METRIC_SET(log_resume_dropped, expected - valid);
+}
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Initializes an empty sample log, or resumes the retained one after a warm reset.
+ *
+ * @details
+ * The sequence number and count are kept by the retain module, so sequence numbers continue across a warm
+ * reset. On a cold boot every record check is cleared, so records of an earlier run can never be resumed.
+ *
+ * @note
+ * This function is called once in app_peripheral_setup(), after retain_open().
+ *
+ ******************************************************************************/
+void sample_log_open(void){
+  seqlock_init(&log_lock);
+  log_next_seq = 0;
+  log_count = 0;
+  retain_add(&log_next_seq, sizeof(log_next_seq));
+  retain_add(&log_count, sizeof(log_count));
+
+  if(retain_resumed()){
+      sample_log_resume();
+  }else{
+      memset(log_check, 0, sizeof(log_check));
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Appends a sample to the log.
+ *
+ * @details
+ * The record for sequence number n lives at index n % SAMPLE_LOG_SIZE, so a record is found from its
+ * sequence number without searching. When the log is full the oldest record is overwritten. The check is
+ * written after the data, so a record torn by a reset fails it. The append is a seqlock write, readers are not
+ * blocked out and interrupts stay enabled.
+ *
+ * @param[in] timestamp
+ * Time of the sample
+ *
+ * @param[in] code
+ * Log code of the calibrated reading
+ *
+ * @return
+ * Sequence number given to the sample
+ *
+ ******************************************************************************/
+uint32_t sample_log_append(uint32_t timestamp, uint16_t code){
+  uint32_t seq;
+
+  seqlock_write_begin(&log_lock);
+  seq = log_next_seq++;
+  log_timestamp[seq % SAMPLE_LOG_SIZE] = timestamp;
+  log_code[seq % SAMPLE_LOG_SIZE] = code;
+  log_check[seq % SAMPLE_LOG_SIZE] = sample_log_check(seq);
+  if(log_count < SAMPLE_LOG_SIZE){
+      log_count++;
+  }else{
+      METRIC_INC(log_overwrites);
+  }
+  METRIC_INC(log_appends);
+  seqlock_write_end(&log_lock);
+
+  return seq;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Reads a record by sequence number.
+ *
+ * @details
+ * The record is read again if an append overlapped the read, so it is never half of an overwritten record.
+ *
+ * @param[in] seq
+ * Sequence number of the record
+ *
+ * @param[out] record
+ * Record read
+ *
+ * @return
+ * False if the record was already overwritten or has not been written yet
+ *
+ ******************************************************************************/
+bool sample_log_get(uint32_t seq, SAMPLE_RECORD *record){
+  for(uint32_t tries = 0; tries < SEQLOCK_READ_TRIES; tries++){
+      uint32_t start = seqlock_read_begin(&log_lock);
+      bool held = seq >= log_next_seq - log_count && seq < log_next_seq;
+      record->seq = seq;
+      record->timestamp = log_timestamp[seq % SAMPLE_LOG_SIZE];
+      record->code = log_code[seq % SAMPLE_LOG_SIZE];
+      if(!seqlock_read_retry(&log_lock, start)){
+          return held;
+      }
+  }
+  return false;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the sequence number of the oldest record still held.
+ *
+ * @note
+ * The sequence number and count are read under the log seqlock. Appends are made from the main loop, so a
+ * reader there or below it always completes.
+ *
+ ******************************************************************************/
+uint32_t sample_log_oldest(void){
+  uint32_t start;
+  uint32_t oldest;
+
+  do{
+      start = seqlock_read_begin(&log_lock);
+      oldest = log_next_seq - log_count;
+  }while(seqlock_read_retry(&log_lock, start));
+  return oldest;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the sequence number the next sample will be given.
+ *
+ ******************************************************************************/
+uint32_t sample_log_next(void){
+  return log_next_seq;
+}
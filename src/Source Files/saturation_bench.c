@@ -0,0 +1,237 @@
+/**
+ * @file
+ * saturation_bench.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that steps the sample rate up until the sample pipeline saturates and reports where it saturated
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "saturation_bench.h"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+static BENCH_RESULT bench_result;
+static uint32_t bench_start_period_ms;
+static uint32_t bench_active_ms;
+static uint32_t bench_samples;
+static uint32_t bench_misses;
+static bool bench_in_flight;
+static uint32_t bench_step_start;
+static uint32_t bench_stage_cycles[BENCH_STAGE_COUNT];
+
+// Saturation indicators of the scheduler and I2C driver at the start of the step
+static uint32_t bench_coalesced_base;
+static I2C_STATS bench_i2c_base;
+
+METRIC_GAUGE(bench_knee_period_ms);
+METRIC_GAUGE(bench_limit);
+METRIC_DECLARE(bench_util_permille, metric_gauge, BENCH_STAGE_COUNT);
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static void bench_step_reset(void);
+static void bench_finish(BENCH_LIMIT limit);
+
+/***************************************************************************//**
+ * @brief
+ * Starts a new measurement step at the current period.
+ *
+ ******************************************************************************/
+static void bench_step_reset(void){
+  bench_samples = 0;
+  bench_misses = 0;
+  bench_coalesced_base = scheduler_coalesced();
+  i2c_stats(&bench_i2c_base);
+  for(int i = 0; i < BENCH_STAGE_COUNT; i++){
+      bench_stage_cycles[i] = 0;
+  }
+  bench_step_start = timing_cycles();
+}
+
+/***************************************************************************//**
+ * @brief
+ * Ends the benchmark and publishes the knee and limiting component.
+ *
+ * @param[in] limit
+ * Indicator that ended the benchmark
+ *
+ ******************************************************************************/
+static void bench_finish(BENCH_LIMIT limit){
+  bench_result.limit = limit;
+  bench_result.done = true;
+
+  METRIC_SET(bench_knee_period_ms, bench_result.knee_period_ms);
+  METRIC_SET(bench_limit, limit);
+  for(int i = 0; i < BENCH_STAGE_COUNT; i++){
+      metric_bench_util_permille[i] = bench_result.util_permille[i];
+  }
+
+  sleep_unblock_mode(EM1);
+}
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Starts the saturation benchmark.
+ *
+ * @details
+ * EM1 is blocked for the length of the benchmark so the core never sleeps and the cycle counter measures wall
+ * time. The coalesced event, I2C wait and I2C busy cycle counters are found through the metrics registry.
+ *
+ * @note
+ * This function is called in app_peripheral_setup() when SATURATION_BENCH is defined.
+ *
+ * @param[in] period_ms
+ * Starting sample period in milliseconds
+ *
+ * @param[in] active_ms
+ * COMP1 to underflow window in milliseconds, the time the sensor has to convert
+ *
+ ******************************************************************************/
+void saturation_bench_open(uint32_t period_ms, uint32_t active_ms){
+  bench_result = (BENCH_RESULT){0};
+  bench_result.period_ms = period_ms;
+  bench_start_period_ms = period_ms;
+  bench_active_ms = active_ms;
+  bench_in_flight = false;
+
+  sleep_block_mode(EM1);
+  bench_step_reset();
+}
+
+/***************************************************************************//**
+ * @brief
+ * Marks the start of a sample (FORCE sent).
+ *
+ * @details
+ * A sample that starts while the previous one has not reached its result callback missed its deadline.
+ *
+ ******************************************************************************/
+void saturation_bench_sample_start(void){
+  if(bench_result.done){
+      return;
+  }
+  if(bench_in_flight){
+      bench_misses++;
+  }
+  bench_in_flight = true;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Marks the completion of a sample (result callback ran).
+ *
+ ******************************************************************************/
+void saturation_bench_sample_done(void){
+  bench_in_flight = false;
+  bench_samples++;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Adds the cycles spent in one pipeline stage.
+ *
+ * @param[in] stage
+ * Stage the cycles were spent in
+ *
+ * @param[in] cycles
+ * Cycles spent
+ *
+ ******************************************************************************/
+void saturation_bench_stage(BENCH_STAGE stage, uint32_t cycles){
+  bench_stage_cycles[stage] += cycles;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Checks the saturation indicators once a step has taken enough samples and picks the next period.
+ *
+ * @details
+ * If no event coalesced, no I2C transaction queued and no deadline was missed, the step ran clean: its period
+ * and per-stage utilization become the knee and the next step runs at BENCH_STEP_PERCENT of the period. The
+ * first step with an indicator ends the benchmark and the LETIMER is returned to the starting period.
+ * Utilization is the share of wall time spent in each stage, in permille.
+ *
+ * @note
+ * This function is called in the result callback after saturation_bench_sample_done().
+ *
+ * @param[out] next_period_ms
+ * Period the LETIMER must be reopened with when true is returned
+ *
+ * @return
+ * True if the LETIMER period must change
+ *
+ ******************************************************************************/
+bool saturation_bench_step(uint32_t *next_period_ms){
+  if(bench_result.done || bench_samples < BENCH_SAMPLES_PER_STEP){
+      return false;
+  }
+
+  uint32_t elapsed = timing_cycles_since(bench_step_start);
+  I2C_STATS i2c;
+  i2c_stats(&i2c);
+  uint32_t coalesced = scheduler_coalesced() - bench_coalesced_base;
+  uint32_t waits = i2c.busy_waits - bench_i2c_base.busy_waits;
+  bench_stage_cycles[bench_stage_i2c_bus] = i2c.busy_cycles - bench_i2c_base.busy_cycles;
+  bench_result.steps++;
+
+  BENCH_LIMIT limit = bench_limit_none;
+  if(bench_misses){
+      limit = bench_limit_deadline;
+  }else if(waits){
+      limit = bench_limit_i2c_queue;
+  }else if(coalesced){
+      limit = bench_limit_coalesce;
+  }
+
+  if(limit != bench_limit_none){
+      bench_finish(limit);
+      *next_period_ms = bench_start_period_ms;
+      return true;
+  }
+
+  // Clean step, record it as the knee so far
+  bench_result.knee_period_ms = bench_result.period_ms;
+  for(int i = 0; i < BENCH_STAGE_COUNT; i++){
+      bench_result.util_permille[i] = (uint64_t)bench_stage_cycles[i] * 1000 / elapsed;
+  }
+  bench_result.util_permille[bench_stage_conversion] = bench_active_ms * 1000 / bench_result.period_ms;
+
+  if(bench_result.period_ms <= BENCH_MIN_PERIOD_MS){
+      bench_finish(bench_limit_timer_resolution);
+      *next_period_ms = bench_start_period_ms;
+      return true;
+  }
+
+  bench_result.period_ms = bench_result.period_ms * BENCH_STEP_PERCENT / 100;
+  if(bench_result.period_ms < BENCH_MIN_PERIOD_MS){
+      bench_result.period_ms = BENCH_MIN_PERIOD_MS;
+  }
+  *next_period_ms = bench_result.period_ms;
+  bench_step_reset();
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the benchmark progress and, once done, the knee, limiting component and per-stage utilization.
+ *
+ ******************************************************************************/
+const BENCH_RESULT *saturation_bench_result(void){
+  return &bench_result;
+}
@@ -19,7 +19,13 @@
 //***********************************************************************************
 // Private variables
 //***********************************************************************************
-static unsigned int event_scheduled;
+static uint32_t event_summary;                      // bit 31 - n set while leaf word n has an event
+static uint32_t event_leaf[SCHED_LEAF_WORDS];       // bit 31 - (id % 32) of word id / 32 set while id is scheduled
+static const SCHED_HANDLER *event_handlers;
+static uint32_t event_count;
+METRIC_COUNTER(sched_events_posted);
+METRIC_COUNTER(sched_events_coalesced);  // event posted again before its callback ran
+METRIC_COUNTER(sched_dispatches);
 
 
 
@@ -29,20 +35,34 @@ static unsigned int event_scheduled;
 
 /***************************************************************************//**
  * @brief
- * Initialize the event scheduler to 0.
+ * Initialize the event scheduler with no events scheduled.
  *
  *
  *
  * @details
- * Event scheduler will be initialized to 0, because no events are sheduled at start of program.
+ * Event scheduler will be initialized to empty, because no events are sheduled at start of program. The handler
+ * table is allocated at compile time by the application, indexed by event id.
  *
  *
  * @note
  * This function will be called once in the app.c in order to initialize the scheduler. This should be initialized before interrupts are enabled.
-
+ *
+ * @param[in] handlers
+ * Handler of every event id, entry SCHED_NO_EVENT is unused
+ *
+ * @param[in] count
+ * Number of event ids, up to SCHED_MAX_EVENTS
+ *
  ******************************************************************************/
-void scheduler_open(void){
-  event_scheduled = 0;
+void scheduler_open(const SCHED_HANDLER *handlers, uint32_t count){
+  EFM_ASSERT(handlers && count <= SCHED_MAX_EVENTS);
+
+  event_summary = 0;
+  for(uint32_t i = 0; i < SCHED_LEAF_WORDS; i++){
+      event_leaf[i] = 0;
+  }
+  event_handlers = handlers;
+  event_count = count;
 }
 
 /***************************************************************************//**
@@ -52,7 +72,7 @@ void scheduler_open(void){
  *
  * @details
  * When adding events to the event scheduler, create an atomic event in order to disable interrupts
- * from disrupting this process.
+ * from disrupting this process. The leaf bit and the summary bit are set together.
  *
  *
  * @note
@@ -62,16 +82,29 @@ void scheduler_open(void){
  *
  *
  * @param[in] event
- *  The "event" parameter is a uint32 that will containt a 1 bit in the position of the event we would like to schedule.
+ *  The "event" parameter is the id of the event we would like to schedule, SCHED_NO_EVENT is ignored.
  *
  *
  ******************************************************************************/
 void add_scheduled_event(uint32_t event){
+  if(event == SCHED_NO_EVENT){
+      return;
+  }
+  EFM_ASSERT(event < event_count);
+
+  uint32_t word = event / SCHED_LEAF_BITS;
+  uint32_t bit = 0x80000000 >> (event % SCHED_LEAF_BITS);
+
   /* Atomic event */
   CORE_DECLARE_IRQ_STATE; //Save IRQ state
   CORE_ENTER_CRITICAL(); //disables interrupts and saves IEN bit
 
-  event_scheduled |= event; //adds event to scheduler
+  METRIC_INC(sched_events_posted);
+  if(event_leaf[word] & bit){
+      METRIC_INC(sched_events_coalesced);
+  }
+  event_leaf[word] |= bit; //adds event to scheduler
+  event_summary |= 0x80000000 >> word;
 
   CORE_EXIT_CRITICAL(); //Restores interrupt processes
 }
@@ -83,10 +116,10 @@ void add_scheduled_event(uint32_t event){
  *
  * @details
  *  When removing events from the event scheduler, create an atomic event in order to disable interrupts
- * from disrupting this process.
+ * from disrupting this process. The summary bit is cleared with the last event of its leaf word.
  *
  * @note
- * This function will be called after an event that was scheduled has been handled.
+ * This function will be called by the handler of an event that was scheduled once it handles it.
  *
  *
  * @param[in] event
@@ -94,31 +127,113 @@ void add_scheduled_event(uint32_t event){
  *
  ******************************************************************************/
 void remove_scheduled_event(uint32_t event){
+  EFM_ASSERT(event < event_count);
+
+  uint32_t word = event / SCHED_LEAF_BITS;
+
   /* Atomic event */
   CORE_DECLARE_IRQ_STATE; //Save IRQ state
   CORE_ENTER_CRITICAL(); //disables interrupts and saves IEN bit
 
-  event_scheduled &= ~event; //removes event from scheduler
+  event_leaf[word] &= ~(0x80000000 >> (event % SCHED_LEAF_BITS)); //removes event from scheduler
+  if(!event_leaf[word]){
+      event_summary &= ~(0x80000000 >> word);
+  }
 
   CORE_EXIT_CRITICAL(); //Restores interrupt processes
 }
 
 /***************************************************************************//**
  * @brief
- * Returns an integer value indicating which events are scheduled to be handled.
+ * Returns true if an event is scheduled to be handled.
  *
  *
- * @details
- * This function can be used to check the status of an event and see whether it has been handled
+ * @param[in] event
+ * Event id
+ *
+ ******************************************************************************/
+bool is_scheduled_event(uint32_t event){
+  EFM_ASSERT(event < event_count);
+  return (event_leaf[event / SCHED_LEAF_BITS] << (event % SCHED_LEAF_BITS)) & 0x80000000;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns true if any event is scheduled to be handled.
  *
  *
  * @note
- * Will return a 0 if no events are scheduled.
+ * Will return false if no events are scheduled, the main loop then runs idle work or sleeps.
 
  ******************************************************************************/
-uint32_t get_scheduled_events(void){
-  return event_scheduled;
+bool any_scheduled_event(void){
+  return event_summary != 0;
 }
 
+/***************************************************************************//**
+ * @brief
+ * Returns the lowest scheduled event id, which is handled first.
+ *
+ *
+ * @details
+ * The leading zeros of the summary word give the first leaf word with an event and the leading zeros of that
+ * word give the event. Both are read in one atomic event, so an interrupt can not empty the leaf in between.
+ *
+ *
+ * @return
+ * Event id, SCHED_NO_EVENT if no events are scheduled
+ *
+ ******************************************************************************/
+uint32_t next_scheduled_event(void){
+  uint32_t event = SCHED_NO_EVENT;
+
+  /* Atomic event */
+  CORE_DECLARE_IRQ_STATE; //Save IRQ state
+  CORE_ENTER_CRITICAL(); //disables interrupts and saves IEN bit
+
+  if(event_summary){
+      uint32_t word = __CLZ(event_summary);
+      event = word * SCHED_LEAF_BITS + __CLZ(event_leaf[word]);
+  }
+
+  CORE_EXIT_CRITICAL(); //Restores interrupt processes
+  return event;
+}
 
+/***************************************************************************//**
+ * @brief
+ * Handles the lowest scheduled event.
+ *
+ *
+ * @details
+ * The handler comes from the table given to scheduler_open(), so the cost does not depend on the number of
+ * events. The handler removes the event itself.
+ *
+ *
+ * @note
+ * This function is called from the main loop, one event per pass.
+ *
+ ******************************************************************************/
+void scheduler_dispatch(void){
+  uint32_t event = next_scheduled_event();
+
+  if(event == SCHED_NO_EVENT){
+      return;
+  }
+  EFM_ASSERT(event_handlers[event]);
+  METRIC_INC(sched_dispatches);
+  event_handlers[event]();
+}
 
+/***************************************************************************//**
+ * @brief
+ * Returns the number of events posted again before their callback ran, since metrics_open().
+ *
+ *
+ * @note
+ * The count is the sched_events_coalesced metric, a bench measures its share as the difference of two reads.
+ *
+ ******************************************************************************/
+uint32_t scheduler_coalesced(void){
+  return metric_sched_events_coalesced[0];
+}
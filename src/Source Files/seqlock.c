@@ -0,0 +1,145 @@
+/**
+ * @file
+ * seqlock.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that lets multi-word state be read without masking interrupts
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "seqlock.h"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+METRIC_COUNTER(seqlock_retries);          // reads copied again because a write overlapped them
+METRIC_COUNTER(seqlock_read_failures);    // reads that gave up, the reader interrupted the writer
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Initializes a seqlock with no write in progress.
+ *
+ * @note
+ * This is called before the data is first written, while nothing reads it.
+ *
+ ******************************************************************************/
+void seqlock_init(SEQLOCK *lock){
+  lock->sequence = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Starts a write.
+ *
+ * @details
+ * The sequence becomes odd before any of the data changes. The barrier keeps the data writes after it, for the
+ * compiler as well as the core.
+ *
+ * @note
+ * Only one context writes a lock. A write is short and never waits, it can be made from any interrupt.
+ *
+ ******************************************************************************/
+void seqlock_write_begin(SEQLOCK *lock){
+  lock->sequence++;
+  __DMB();
+}
+
+/***************************************************************************//**
+ * @brief
+ * Completes a write started with seqlock_write_begin().
+ ******************************************************************************/
+void seqlock_write_end(SEQLOCK *lock){
+  __DMB();
+  lock->sequence++;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Starts a read.
+ *
+ * @return
+ * Sequence to pass to seqlock_read_retry() once the data has been copied
+ *
+ ******************************************************************************/
+uint32_t seqlock_read_begin(const SEQLOCK *lock){
+  uint32_t start = lock->sequence;
+
+  __DMB();
+  return start;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Checks whether the data copied since seqlock_read_begin() may be torn.
+ *
+ * @details
+ * The copy is torn if a write was in progress when it started or one was made while it was taken. In both cases
+ * the sequence is odd or has moved on.
+ *
+ * @param[in] start
+ * Value returned by seqlock_read_begin()
+ *
+ * @return
+ * True if the data must be copied again
+ *
+ ******************************************************************************/
+bool seqlock_read_retry(const SEQLOCK *lock, uint32_t start){
+  __DMB();
+  if((start & 1) || lock->sequence != start){
+      METRIC_INC(seqlock_retries);
+      return true;
+  }
+  return false;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Copies data guarded by a seqlock.
+ *
+ * @details
+ * The data is copied until a copy is not overlapped by a write, at most SEQLOCK_READ_TRIES times. A reader below
+ * the writer's priority only retries when the writer interrupted it, which the next copy outruns.
+ *
+ * @param[out] copy
+ * Consistent copy of the data
+ *
+ * @param[in] data
+ * Data guarded by the lock
+ *
+ * @param[in] bytes
+ * Size of the data
+ *
+ * @return
+ * False if no consistent copy could be taken, copy is then undefined
+ *
+ ******************************************************************************/
+bool seqlock_read(const SEQLOCK *lock, void *copy, const volatile void *data, uint32_t bytes){
+  for(uint32_t tries = 0; tries < SEQLOCK_READ_TRIES; tries++){
+      uint32_t start = seqlock_read_begin(lock);
+      for(uint32_t i = 0; i < bytes; i++){
+          ((uint8_t *)copy)[i] = ((const volatile uint8_t *)data)[i];
+      }
+      if(!seqlock_read_retry(lock, start)){
+          return true;
+      }
+  }
+  METRIC_INC(seqlock_read_failures);
+  return false;
+}
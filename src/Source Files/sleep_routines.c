@@ -44,6 +44,9 @@
 // Private variables
 //***********************************************************************************
 static int lowest_energy_modes[MAX_ENERGY_MODES];
+METRIC_COUNTER(sleep_em1_entries);
+METRIC_COUNTER(sleep_em2_entries);
+METRIC_COUNTER(sleep_em3_entries);
 
 //***********************************************************************************
 // Global functions
@@ -122,6 +125,8 @@ void sleep_unblock_mode(uint32_t EM){
  *
  * @note
  * The lowest energy modes array is used to determine which energy mode the processor can be put into.
+ * Before entering EM2 or EM3 the pins are switched to the sleep pin-state profile and switched back to the
+ * active profile on wake up. EM1 keeps the active profile because an I2C transfer may be in progress.
  *
  ******************************************************************************/
 void enter_sleep(void){
@@ -136,15 +141,22 @@ void enter_sleep(void){
       CORE_EXIT_CRITICAL(); //Restores interrupt processes
       return;
   }else if(lowest_energy_modes[EM2] > 0){
+      METRIC_INC(sleep_em1_entries);
       EMU_EnterEM1();
       CORE_EXIT_CRITICAL(); //Restores interrupt processes
       return;
   }else if(lowest_energy_modes[EM3] > 0){
+      gpio_profile_set(gpio_profile_sleep_get()); //I2C is idle in EM2, release its pins
+      METRIC_INC(sleep_em2_entries);
       EMU_EnterEM2(true);
+      gpio_profile_set(gpio_profile_active);
       CORE_EXIT_CRITICAL(); //Restores interrupt processes
       return;
   }else{
+      gpio_profile_set(gpio_profile_sleep_get());
+      METRIC_INC(sleep_em3_entries);
       EMU_EnterEM3(true);
+      gpio_profile_set(gpio_profile_active);
       CORE_EXIT_CRITICAL(); //Restores interrupt processes
       return;
   }
@@ -0,0 +1,265 @@
+/**
+ * @file
+ * sync_input.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that starts a Si1133 measurement on the edge of an external sync line shared between boards
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "sync_input.h"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+static uint32_t sync_read_cb;
+static uint32_t sync_conversion_ticks;
+static uint32_t sync_overflows;     // upper 16 bits of the timestamp
+static uint32_t sync_timestamp;     // timestamp of the last sync edge
+static SYNC_INPUT_STATS sync_stats;
+static SEQLOCK sync_stats_lock;     // written by the TIMER1 handler, read by the main loop
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static void sync_edge(uint32_t capture, uint32_t overflows);
+
+/***************************************************************************//**
+ * @brief
+ * Starts the measurement for a captured sync edge.
+ *
+ * @details
+ * The FORCE command is sent immediately from the TIMER1 interrupt, which runs above every other interrupt so
+ * that the delay from the edge to the I2C START only depends on the interrupt entry time. The latency is the
+ * count once the START and address have been handed to the I2C peripheral, or once the whole write is done
+ * when it is polled, less the hardware capture of the edge. It covers interrupt entry and the transaction
+ * setup; the bus time of the write after the START is fixed by SCL and not included. CC1 is armed to fire once the
+ * conversion is complete so that the result is read a fixed time after the edge.
+ *
+ * @note
+ * If the I2C bus is busy, with the previous sample or a main loop transaction this interrupt preempted, the
+ * edge is counted as missed rather than blocking in interrupt context. The bus is claimed atomically, so the
+ * transaction in progress is never touched.
+ *
+ * @param[in] capture
+ * TIMER1 count latched by the sync edge
+ *
+ * @param[in] overflows
+ * Number of TIMER1 overflows before the edge
+ *
+ ******************************************************************************/
+static void sync_edge(uint32_t capture, uint32_t overflows){
+  seqlock_write_begin(&sync_stats_lock);
+  sync_stats.triggers++;
+
+  if(!si1133_force_try()){
+      sync_stats.missed++;
+      seqlock_write_end(&sync_stats_lock);
+      return;
+  }
+  uint32_t sent = SYNC_TIMER->CNT;
+
+  sync_timestamp = (overflows << 16) | capture;
+
+  uint32_t latency = (sent - capture) & 0xFFFF;
+  sync_stats.latency_last = latency;
+  if(latency < sync_stats.latency_min){
+      sync_stats.latency_min = latency;
+  }
+  if(latency > sync_stats.latency_max){
+      sync_stats.latency_max = latency;
+  }
+  sync_stats.jitter = sync_stats.latency_max - sync_stats.latency_min;
+  seqlock_write_end(&sync_stats_lock);
+
+  TIMER_CompareSet(SYNC_TIMER, SYNC_READ_CC, (capture + sync_conversion_ticks) & 0xFFFF);
+  TIMER_IntClear(SYNC_TIMER, TIMER_IF_CC1);
+  TIMER_IntEnable(SYNC_TIMER, TIMER_IEN_CC1);
+}
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Opens the sync input so that an external edge starts each Si1133 measurement.
+ *
+ * @details
+ * The sync pin is routed through EXTI onto a PRS channel. TIMER1 runs free at HFPER / SYNC_TIMER_DIV and CC0
+ * captures the count from the PRS channel on the rising edge, so the timestamp of each sample is taken in
+ * hardware from the sync edge itself. CC1 is used as a compare to schedule the result read.
+ *
+ * @note
+ * This function is called once in app_peripheral_setup() instead of the LETIMER sampling when SYNC_INPUT_MODE
+ * is defined. TIMER1 blocks EM2 while sync mode is open.
+ *
+ * @param[in] conversion_us
+ * Time from FORCE to a complete result, in microseconds
+ *
+ * @param[in] read_cb
+ * Event scheduled when the result is ready to be read
+ *
+ ******************************************************************************/
+void sync_input_open(uint32_t conversion_us, uint32_t read_cb){
+  TIMER_Init_TypeDef timer_init = TIMER_INIT_DEFAULT;
+  TIMER_InitCC_TypeDef capture_init = TIMER_INITCC_DEFAULT;
+  TIMER_InitCC_TypeDef compare_init = TIMER_INITCC_DEFAULT;
+
+  CMU_ClockEnable(cmuClock_PRS, true);
+  cmu_clock_acquire(cmuClock_TIMER1);   //held for as long as sync mode samples
+
+  sync_read_cb = read_cb;
+  sync_conversion_ticks = (uint64_t)conversion_us * (CMU_ClockFreqGet(cmuClock_HFPER) / SYNC_TIMER_DIV) / 1000000;
+  EFM_ASSERT(sync_conversion_ticks < 0x8000);
+  sync_overflows = 0;
+  sync_timestamp = 0;
+  seqlock_init(&sync_stats_lock);
+  sync_stats = (SYNC_INPUT_STATS){0};
+  sync_stats.latency_min = 0xFFFFFFFF;
+
+  // Sync pin onto the PRS channel through EXTI, no GPIO interrupt is needed
+  GPIO_PinModeSet(SYNC_IN_PORT, SYNC_IN_PIN, SYNC_IN_GPIOMODE, SYNC_IN_PULL);
+  GPIO_ExtIntConfig(SYNC_IN_PORT, SYNC_IN_PIN, SYNC_IN_PIN, true, false, false);
+  PRS_SourceAsyncSignalSet(SYNC_PRS_CH, SYNC_PRS_SOURCE, SYNC_PRS_SIGNAL);
+
+  // CC0 captures the count on the rising edge of the PRS channel
+  capture_init.eventCtrl = timerEventEveryEdge;
+  capture_init.edge = timerEdgeRising;
+  capture_init.prsSel = (TIMER_PRSSEL_TypeDef)SYNC_PRS_CH;
+  capture_init.prsInput = true;
+  capture_init.mode = timerCCModeCapture;
+  TIMER_InitCC(SYNC_TIMER, SYNC_CAPTURE_CC, &capture_init);
+
+  compare_init.mode = timerCCModeCompare;
+  TIMER_InitCC(SYNC_TIMER, SYNC_READ_CC, &compare_init);
+
+  timer_init.enable = false;
+  timer_init.debugRun = false;
+  timer_init.prescale = SYNC_TIMER_PRESCALE;
+  timer_init.mode = timerModeUp;
+  TIMER_Init(SYNC_TIMER, &timer_init);
+  TIMER_TopSet(SYNC_TIMER, 0xFFFF);
+
+  TIMER_IntClear(SYNC_TIMER, TIMER_IF_OF | TIMER_IF_CC0 | TIMER_IF_CC1);
+  TIMER_IntEnable(SYNC_TIMER, TIMER_IEN_OF | TIMER_IEN_CC0);
+
+  // FORCE is started from the TIMER1 interrupt, keep it above everything else
+  NVIC_SetPriority(TIMER1_IRQn, SYNC_IRQ_PRIORITY);
+  NVIC_SetPriority(I2C1_IRQn, SYNC_OTHER_PRIORITY);
+  NVIC_SetPriority(LETIMER0_IRQn, SYNC_OTHER_PRIORITY);
+  NVIC_EnableIRQ(TIMER1_IRQn);
+
+  sleep_block_mode(SYNC_TIMER_EM);
+  TIMER_Enable(SYNC_TIMER, true);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Changes the time from FORCE to the result read.
+ *
+ * @details
+ * The compare of the next sync edge uses the new time, a measurement already started keeps its read time.
+ *
+ * @note
+ * This is called when the channels or gain of the Si1133 change.
+ *
+ * @param[in] conversion_us
+ * Time from FORCE to a complete result, in microseconds
+ *
+ ******************************************************************************/
+void sync_input_conversion_set(uint32_t conversion_us){
+  uint32_t ticks = (uint64_t)conversion_us * (CMU_ClockFreqGet(cmuClock_HFPER) / SYNC_TIMER_DIV) / 1000000;
+
+  EFM_ASSERT(ticks < 0x8000);
+  sync_conversion_ticks = ticks;   //one word, read by the TIMER1 handler
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the timestamp of the sync edge of the last started measurement.
+ *
+ * @details
+ * The timestamp is in TIMER1 ticks (HFPER / SYNC_TIMER_DIV), extended to 32 bits with the overflow count.
+ *
+ * @note
+ * This is called in the read callback so that the sample carries the time of the sync edge, not the time it was read.
+ *
+ ******************************************************************************/
+uint32_t sync_input_timestamp(void){
+  return sync_timestamp;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Copies the trigger, missed edge and edge-to-FORCE-issued latency and jitter statistics.
+ *
+ * @details
+ * The statistics are updated by the TIMER1 handler on every edge. The copy is taken under a seqlock, so it is
+ * never a mix of two edges and interrupts stay enabled while it is taken.
+ *
+ * @param[out] stats
+ * Statistics of the last edge
+ *
+ * @return
+ * False if no consistent copy could be taken, only possible from above the TIMER1 priority
+ *
+ ******************************************************************************/
+bool sync_input_stats(SYNC_INPUT_STATS *stats){
+  return seqlock_read(&sync_stats_lock, stats, &sync_stats, sizeof(*stats));
+}
+
+/***************************************************************************//**
+ * @brief
+ * Converts TIMER1 ticks to microseconds.
+ *
+ * @param[in] ticks
+ * Number of TIMER1 ticks
+ *
+ ******************************************************************************/
+uint32_t sync_input_ticks_to_us(uint32_t ticks){
+  return (uint64_t)ticks * 1000000 / (CMU_ClockFreqGet(cmuClock_HFPER) / SYNC_TIMER_DIV);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Interrupt handler for TIMER1
+ *
+ * @details
+ * Handles the overflow used to extend the timestamp, the CC0 capture of a sync edge and the CC1 compare that
+ * schedules the result read.
+ *
+ * @note
+ * If an overflow and a capture are pending together, a capture in the upper half of the count was taken
+ * before the overflow and belongs to the previous overflow period.
+ *
+ ******************************************************************************/
+void TIMER1_IRQHandler(void){
+  uint32_t int_flag = SYNC_TIMER->IF & SYNC_TIMER->IEN;
+  SYNC_TIMER->IFC = int_flag;
+
+  if(int_flag & TIMER_IF_OF){
+      sync_overflows++;
+  }
+  if(int_flag & TIMER_IF_CC0){
+      uint32_t capture = TIMER_CaptureGet(SYNC_TIMER, SYNC_CAPTURE_CC);
+      uint32_t overflows = sync_overflows;
+      if((int_flag & TIMER_IF_OF) && (capture >= 0x8000)){
+          overflows--;
+      }
+      sync_edge(capture, overflows);
+  }
+  if(int_flag & TIMER_IF_CC1){
+      TIMER_IntDisable(SYNC_TIMER, TIMER_IEN_CC1);
+      add_scheduled_event(sync_read_cb);
+  }
+}
@@ -0,0 +1,86 @@
+/**
+ * @file
+ * timing.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Module that provides a free running core cycle counter for measuring execution time
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include "timing.h"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Enables the DWT cycle counter of the Cortex-M4 core.
+ *
+ * @details
+ * The trace block must be enabled in the debug control register before the DWT cycle counter will count.
+ * The counter runs at the HF core clock and wraps every 2^32 cycles (about 165 seconds at 26 MHz).
+ *
+ * @note
+ * This function is called once in app_peripheral_setup() before any module that measures execution time is opened.
+ *
+ ******************************************************************************/
+void timing_open(void){
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; //enable trace block so DWT can run
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk; //start the cycle counter
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the current value of the core cycle counter.
+ *
+ * @note
+ * The counter does not run in EM2 or below, so measurements should not span a sleep.
+ *
+ ******************************************************************************/
+uint32_t timing_cycles(void){
+  return DWT->CYCCNT;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns the number of core cycles elapsed since a previous timing_cycles() value.
+ *
+ * @details
+ * Unsigned subtraction keeps the result correct across a single wrap of the counter.
+ *
+ * @param[in] start
+ * Value previously returned by timing_cycles()
+ *
+ ******************************************************************************/
+uint32_t timing_cycles_since(uint32_t start){
+  return DWT->CYCCNT - start;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Converts a core cycle count to microseconds at the current HF core clock.
+ *
+ * @param[in] cycles
+ * Number of core cycles to convert
+ *
+ ******************************************************************************/
+uint32_t timing_cycles_to_us(uint32_t cycles){
+  uint32_t cycles_per_us = CMU_ClockFreqGet(cmuClock_CORE) / 1000000;
+
+  EFM_ASSERT(cycles_per_us);
+  return cycles / cycles_per_us;
+}
@@ -48,32 +48,19 @@ int main(void)
   /* Infinite blink loop */
   while (1) {
       //    EMU_EnterEM1();
-      if(!get_scheduled_events()){
-          CORE_DECLARE_IRQ_STATE;
-          CORE_ENTER_CRITICAL();
-          enter_sleep();
-          CORE_EXIT_CRITICAL();
-      }
-      /* Handles UF scheduled event */
-      if(LETIMER0_UF_CB & get_scheduled_events()){
-          remove_scheduled_event(LETIMER0_UF_CB); //removes UF event (because it is currently being handled)
-          scheduled_letimer0_uf_cb(); //Handles UF event
-      }
-      /* Handles COMP0 scheduled event */
-      if(LETIMER0_COMP0_CB & get_scheduled_events()){
-          remove_scheduled_event(LETIMER0_COMP0_CB); //removes COMP0 event (because it is currently being handled)
-          scheduled_letimer0_comp0_cb(); //Handles COMP0 event
-      }
-      /* Handles COMP1 scheduled event */
-      if(LETIMER0_COMP1_CB & get_scheduled_events()){
-          remove_scheduled_event(LETIMER0_COMP1_CB); //removes COMP1 event (because it is currently being handled)
-          scheduled_letimer0_comp1_cb(); //Handles COMP1 event
-      }
-      /* Handles si1133 read scheduled event */
-      if(SI1133_LIGHT_CB & get_scheduled_events()){
-          remove_scheduled_event(SI1133_LIGHT_CB); //removes si1133 read event (because it is currently being handled)
-          scheduled_si1133_read_cb(); //Handles read event
+      if(!any_scheduled_event()){
+          /* Runs background work only if the next deadline is far enough away, otherwise sleeps */
+          if(idle_work_pending() && (letimer_ticks_to_next_event(LETIMER0) >= letimer_ms_to_ticks(LETIMER0, IDLE_MIN_HEADROOM_MS))){
+              idle_work_run_slice();
+          }else{
+              CORE_DECLARE_IRQ_STATE;
+              CORE_ENTER_CRITICAL();
+              enter_sleep();
+              CORE_EXIT_CRITICAL();
+          }
       }
+      /* Handles the highest priority scheduled event, its handler comes from the event table in app.c */
+      scheduler_dispatch();
 
   }
 }
@@ -0,0 +1,292 @@
+/**
+ * @file
+ * history_sim.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Host simulation of the flash history, to check its retention and the wear of the storage pages
+ *
+ * @details
+ * Build with: cc -O2 -I host -I "../src/Header Files" -o history_sim history_sim.c
+ * Usage: history_sim [days] [reset_day]
+ *
+ * history.c is built against a RAM copy of the storage pages. One sample per second is appended to a sample
+ * log of SAMPLE_LOG_SIZE records and the idle job is run after each one, as history_poll() does on the board.
+ * Flash operations complete before the job runs again. Every HISTORY_SIM_TIGHT_EVERY sample the job runs with
+ * too little LETIMER headroom, so erases are put off as well. At reset_day the history is opened again from
+ * the storage alone, as after a cold reset. The records kept in each ring, the counters of the history and
+ * the erases of each page are written to stdout, with the years each page lasts at HISTORY_SIM_ENDURANCE.
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define HISTORY_SIM_DAYS          200
+#define HISTORY_SIM_PERIOD_MS     1000
+#define HISTORY_SIM_TIGHT_EVERY   7         // samples between runs with LETIMER headroom below an erase
+#define HISTORY_SIM_ENDURANCE     10000     // erase cycles of a flash page
+
+/* Stand-ins for the firmware modules history.c uses. Their include guards are defined here, so the
+ * history is built without the hardware headers they pull in. */
+#define FLASH_HG
+#define IDLE_WORK_HG
+#define LETIMER_HG
+#define SAMPLE_LOG_HG
+#define TIMING_HG
+
+#define FLASH_PAGE_SIZE       2048
+#define FLASH_PAGE_WORDS      (FLASH_PAGE_SIZE / 4)
+#define FLASH_STORAGE_PAGES   32
+#define FLASH_ERASE_MAX_MS    40
+#define LETIMER_HZ            1000
+#define LETIMER0              ((LETIMER_TypeDef *)0)
+#define SAMPLE_LOG_SIZE       1024
+
+typedef struct LETIMER_TypeDef LETIMER_TypeDef;
+typedef bool (*IDLE_JOB_FUNC)(void);
+
+typedef struct {
+  uint32_t    seq;
+  uint32_t    timestamp;
+  uint16_t    code;
+} SAMPLE_RECORD;
+
+bool flash_erase(uint32_t *page);
+bool flash_write(uint32_t *dest, const uint32_t *src, uint32_t words);
+bool flash_busy(void);
+bool flash_error(void);
+uint32_t *flash_storage(void);
+uint32_t idle_work_register(const char *name, IDLE_JOB_FUNC job);
+void idle_work_post(uint32_t job_id);
+uint32_t letimer_ticks_to_next_event(LETIMER_TypeDef *letimer);
+uint32_t letimer_ms_to_ticks(LETIMER_TypeDef *letimer, uint32_t ms);
+bool sample_log_get(uint32_t seq, SAMPLE_RECORD *record);
+uint32_t sample_log_oldest(void);
+uint32_t sample_log_next(void);
+uint32_t timing_cycles(void);
+uint32_t timing_cycles_since(uint32_t start);
+
+#include "../src/Source Files/history.c"
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+static uint32_t sim_storage[FLASH_STORAGE_PAGES * FLASH_PAGE_WORDS];
+static SAMPLE_RECORD sim_log[SAMPLE_LOG_SIZE];
+static uint32_t sim_log_next;
+static IDLE_JOB_FUNC sim_job;
+static bool sim_posted;
+static bool sim_flash_done;
+static uint32_t sim_headroom;           // LETIMER ticks to the next deadline while the job runs
+static uint32_t sim_unerased_writes;
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+static uint32_t sim_clock(uint32_t elapsed);
+static void sim_run(void);
+static void sim_report(uint32_t days);
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Stand-ins of the firmware modules, the flash completes every operation before the job runs again.
+ ******************************************************************************/
+bool flash_erase(uint32_t *page){
+  memset(page, 0xFF, FLASH_PAGE_SIZE);
+  sim_flash_done = true;
+  return true;
+}
+
+bool flash_write(uint32_t *dest, const uint32_t *src, uint32_t words){
+  for(uint32_t i = 0; i < words; i++){
+      if(dest[i] != 0xFFFFFFFF){
+          sim_unerased_writes++;
+      }
+      dest[i] = src[i];
+  }
+  sim_flash_done = true;
+  return true;
+}
+
+bool flash_busy(void){
+  return false;
+}
+
+bool flash_error(void){
+  return false;
+}
+
+uint32_t *flash_storage(void){
+  return sim_storage;
+}
+
+uint32_t idle_work_register(const char *name, IDLE_JOB_FUNC job){
+  (void)name;
+  sim_job = job;
+  return 0;
+}
+
+void idle_work_post(uint32_t job_id){
+  (void)job_id;
+  sim_posted = true;
+}
+
+uint32_t letimer_ticks_to_next_event(LETIMER_TypeDef *letimer){
+  (void)letimer;
+  return sim_headroom;
+}
+
+uint32_t letimer_ms_to_ticks(LETIMER_TypeDef *letimer, uint32_t ms){
+  (void)letimer;
+  return ms;
+}
+
+bool sample_log_get(uint32_t seq, SAMPLE_RECORD *record){
+  if(seq >= sim_log_next || seq < sample_log_oldest()){
+      return false;
+  }
+  *record = sim_log[seq % SAMPLE_LOG_SIZE];
+  return true;
+}
+
+uint32_t sample_log_oldest(void){
+  return sim_log_next > SAMPLE_LOG_SIZE ? sim_log_next - SAMPLE_LOG_SIZE : 0;
+}
+
+uint32_t sample_log_next(void){
+  return sim_log_next;
+}
+
+uint32_t timing_cycles(void){
+  return 0;
+}
+
+uint32_t timing_cycles_since(uint32_t start){
+  (void)start;
+  return 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Runs the simulation.
+ ******************************************************************************/
+int main(int argc, char **argv){
+  uint32_t days = argc > 1 ? (uint32_t)atoi(argv[1]) : HISTORY_SIM_DAYS;
+  uint32_t reset_day = argc > 2 ? (uint32_t)atoi(argv[2]) : days / 2;
+  uint32_t samples = days * (86400000 / HISTORY_SIM_PERIOD_MS);
+  uint32_t reset_sample = reset_day * (86400000 / HISTORY_SIM_PERIOD_MS);
+
+  memset(sim_storage, 0xFF, sizeof(sim_storage));
+  history_open(sim_clock);
+  sim_run();
+
+  for(uint32_t i = 0; i < samples; i++){
+      if(i == reset_sample && i){
+          history_open(sim_clock);
+      }
+      SAMPLE_RECORD *record = &sim_log[sim_log_next % SAMPLE_LOG_SIZE];
+      record->seq = sim_log_next;
+      record->timestamp = i * HISTORY_SIM_PERIOD_MS;
+      record->code = (uint16_t)(20000 + (i / 3600) % 100);
+      sim_log_next++;
+
+      sim_headroom = (i % HISTORY_SIM_TIGHT_EVERY) ? HISTORY_SIM_PERIOD_MS - 10 : FLASH_ERASE_MAX_MS - 1;
+      history_poll();
+      sim_run();
+  }
+
+  sim_report(days);
+  return sim_unerased_writes ? 1 : 0;
+}
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Sample log timestamps are already in ms.
+ ******************************************************************************/
+static uint32_t sim_clock(uint32_t elapsed){
+  return elapsed;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Runs the idle job until it waits for the next sample, completing each flash operation it starts.
+ ******************************************************************************/
+static void sim_run(void){
+  while(sim_posted){
+      sim_posted = false;
+      while(sim_job()){
+      }
+      if(sim_flash_done){
+          sim_flash_done = false;
+          history_flash_done();
+      }
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Writes the retention of each ring, the counters and the wear of each page.
+ ******************************************************************************/
+static void sim_report(uint32_t days){
+  static const char *tier_names[HISTORY_TIERS] = { "minutes", "hours" };
+
+  for(uint32_t tier = 0; tier < HISTORY_TIERS; tier++){
+      HISTORY_RING *ring = &history_rings[tier];
+      uint32_t records = 0, first = HISTORY_FREE, last = 0;
+      for(uint32_t page = 0; page < ring->pages; page++){
+          uint32_t used = history_page_used(tier, page);
+          for(uint32_t i = 0; i < used; i++){
+              uint32_t minute = history_records(tier, page)[i].minute;
+              first = minute < first ? minute : first;
+              last = minute > last ? minute : last;
+          }
+          records += used;
+      }
+      printf("%-8s %6u records, minutes %u to %u (%.1f days)\n", tier_names[tier], records, first, last,
+          records ? (last - first) / 1440.0 : 0.0);
+  }
+
+  printf("minutes written %u, hours written %u, hours dropped %u, samples missed %u\n",
+      metric_history_minutes_written[0], metric_history_hours_written[0], metric_history_hours_dropped[0],
+      metric_history_samples_missed[0]);
+  printf("erases %u, deferred %u, words written %u, writes to unerased words %u\n",
+      metric_history_erases[0], metric_history_erases_deferred[0], metric_history_words_written[0],
+      sim_unerased_writes);
+
+  uint32_t most = 0;
+  printf("erases per page:");
+  for(uint32_t page = 0; page < FLASH_STORAGE_PAGES; page++){
+      printf(" %u", metric_history_page_erases[page]);
+      most = metric_history_page_erases[page] > most ? metric_history_page_erases[page] : most;
+  }
+  printf("\n");
+  if(most){
+      printf("most worn page: %.2f erases a day, %.1f years to %u cycles\n", (double)most / days,
+          HISTORY_SIM_ENDURANCE * (double)days / most / 365.0, HISTORY_SIM_ENDURANCE);
+  }
+}
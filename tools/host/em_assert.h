@@ -0,0 +1,15 @@
+/**
+ * @file
+ * em_assert.h
+ * @brief
+ * Host stand-in for the Silicon Labs header, so firmware modules without hardware access build in the tools
+ *
+ */
+#ifndef EM_ASSERT_H
+#define EM_ASSERT_H
+
+#include <assert.h>
+
+#define EFM_ASSERT(expr)  assert(expr)
+
+#endif
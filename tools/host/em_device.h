@@ -0,0 +1,13 @@
+/**
+ * @file
+ * em_device.h
+ * @brief
+ * Host stand-in for the Silicon Labs header, so firmware modules without hardware access build in the tools
+ *
+ */
+#ifndef EM_DEVICE_H
+#define EM_DEVICE_H
+
+#define __CLZ(x)          ((uint32_t)__builtin_clz(x))
+
+#endif
@@ -0,0 +1,258 @@
+/**
+ * @file
+ * log_decode.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Host tool that decodes a capture of the log export stream into samples
+ *
+ * @details
+ * Build with: cc -O2 -o log_decode log_decode.c -lm
+ * Usage: log_decode [capture] > samples.csv
+ *
+ * The capture is the raw device to host byte stream of the LEUART, see log_export.h for the frames. BLOCK
+ * frames are decoded sample by sample, SEGMENTS frames are reconstructed by drawing the line between
+ * consecutive knots. The samples are written as CSV: seq, timestamp, log code and calibrated reading. A
+ * summary of the frames, samples and compression ratio is written to stderr.
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define EXPORT_SOF              0xA5
+#define EXPORT_RSP_BLOCK        0x82
+#define EXPORT_RSP_SEGMENTS     0x85
+#define LOG_CODE_FRAC_BITS      10
+#define LOG_CODE_BIAS           19
+#define PLA_FRAC_BITS           4
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+typedef struct {
+  uint32_t    seq;
+  uint32_t    timestamp;
+  int32_t     code;         // 1/16 code steps
+} KNOT;
+
+static KNOT decode_prev;
+static bool decode_series;
+static unsigned long decode_frames;
+static unsigned long decode_crc_errors;
+static unsigned long decode_samples;
+static unsigned long decode_knots;
+static unsigned long decode_block_samples;
+static unsigned long decode_block_bytes;
+static unsigned long decode_segment_bytes;
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * CRC-16/CCITT as computed by log_export_crc16().
+ ******************************************************************************/
+static uint16_t decode_crc16(uint16_t crc, const uint8_t *data, uint32_t length){
+  while(length--){
+      crc ^= (uint16_t)*data++ << 8;
+      for(int bit = 0; bit < 8; bit++){
+          crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+      }
+  }
+  return crc;
+}
+
+static uint32_t decode_u32(const uint8_t *src){
+  return src[0] | (src[1] << 8) | (src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Reads a varint, returns false if it runs past the end of the payload.
+ ******************************************************************************/
+static bool decode_uvarint(const uint8_t *payload, uint32_t length, uint32_t *pos, uint32_t *value){
+  uint32_t shift = 0;
+
+  *value = 0;
+  while(*pos < length && shift < 35){
+      uint8_t byte = payload[(*pos)++];
+      *value |= (uint32_t)(byte & 0x7F) << shift;
+      if(!(byte & 0x80)){
+          return true;
+      }
+      shift += 7;
+  }
+  return false;
+}
+
+static bool decode_varint(const uint8_t *payload, uint32_t length, uint32_t *pos, int32_t *value){
+  uint32_t zigzag;
+
+  if(!decode_uvarint(payload, length, pos, &zigzag)){
+      return false;
+  }
+  *value = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Writes one sample, code in 1/16 steps.
+ ******************************************************************************/
+static void decode_emit(uint32_t seq, uint32_t timestamp, double code){
+  double reading = code > 0 ? pow(2.0, code / (1 << LOG_CODE_FRAC_BITS) - LOG_CODE_BIAS) : 0.0;
+
+  printf("%lu,%lu,%.4f,%.6g\n", (unsigned long)seq, (unsigned long)timestamp, code, reading);
+  decode_samples++;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Writes the samples up to a knot, on the line from the knot before it.
+ ******************************************************************************/
+static void decode_knot(const KNOT *knot, bool starts){
+  if(starts || !decode_series){
+      decode_emit(knot->seq, knot->timestamp, (double)knot->code / (1 << PLA_FRAC_BITS));
+  }else{
+      uint32_t span = knot->seq - decode_prev.seq;
+      for(uint32_t i = 1; i <= span; i++){
+          double part = (double)i / span;
+          double timestamp = decode_prev.timestamp + part * (int32_t)(knot->timestamp - decode_prev.timestamp);
+          double code = decode_prev.code + part * (knot->code - decode_prev.code);
+          decode_emit(decode_prev.seq + i, (uint32_t)floor(timestamp + 0.5), floor(code + 0.5) / (1 << PLA_FRAC_BITS));
+      }
+  }
+  decode_prev = *knot;
+  decode_series = true;
+  decode_knots++;
+}
+
+static void decode_segments(const uint8_t *payload, uint32_t length){
+  KNOT knot;
+  uint32_t pos = 14;
+
+  if(length < 14){
+      return;
+  }
+  knot.seq = decode_u32(&payload[0]);
+  knot.timestamp = decode_u32(&payload[5]);
+  knot.code = (int32_t)decode_u32(&payload[9]);
+  decode_knot(&knot, payload[13]);
+
+  for(uint32_t i = 1; i < payload[4]; i++){
+      uint32_t seq_starts;
+      int32_t timestamp_delta;
+      int32_t code_delta;
+      if(!decode_uvarint(payload, length, &pos, &seq_starts) || !decode_varint(payload, length, &pos, &timestamp_delta)
+         || !decode_varint(payload, length, &pos, &code_delta)){
+          fprintf(stderr, "truncated SEGMENTS frame\n");
+          return;
+      }
+      knot.seq += seq_starts >> 1;
+      knot.timestamp += timestamp_delta;
+      knot.code += code_delta;
+      decode_knot(&knot, seq_starts & 1);
+  }
+  decode_segment_bytes += length;
+}
+
+static void decode_block(const uint8_t *payload, uint32_t length){
+  uint32_t pos = 11;
+  int32_t prev_delta = 0;
+
+  if(length < 11){
+      return;
+  }
+  uint32_t seq = decode_u32(&payload[0]);
+  uint32_t timestamp = decode_u32(&payload[5]);
+  int32_t code = payload[9] | (payload[10] << 8);
+  decode_emit(seq, timestamp, code);
+
+  for(uint32_t i = 1; i < payload[4]; i++){
+      int32_t delta_of_delta;
+      int32_t code_delta;
+      if(!decode_varint(payload, length, &pos, &delta_of_delta) || !decode_varint(payload, length, &pos, &code_delta)){
+          fprintf(stderr, "truncated BLOCK frame\n");
+          return;
+      }
+      prev_delta += delta_of_delta;
+      timestamp += prev_delta;
+      code += code_delta;
+      decode_emit(++seq, timestamp, code);
+  }
+  decode_series = false;
+  decode_block_samples += payload[4];
+  decode_block_bytes += length;
+}
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+int main(int argc, char **argv){
+  FILE *capture = argc > 1 ? fopen(argv[1], "rb") : stdin;
+  uint8_t frame[2 + 255 + 2];
+  int byte;
+
+  if(!capture){
+      perror(argv[1]);
+      return 1;
+  }
+  printf("seq,timestamp,code,reading\n");
+
+  while((byte = fgetc(capture)) != EOF){
+      if(byte != EXPORT_SOF){
+          continue;
+      }
+      int type = fgetc(capture);
+      int length = fgetc(capture);
+      if(type == EOF || length == EOF){
+          break;
+      }
+      frame[0] = type;
+      frame[1] = length;
+      if(fread(&frame[2], 1, length + 2, capture) != (size_t)length + 2){
+          break;
+      }
+      uint16_t crc = frame[length + 2] | (frame[length + 3] << 8);
+      if(decode_crc16(0xFFFF, frame, length + 2) != crc){
+          decode_crc_errors++;
+          continue;
+      }
+      decode_frames++;
+      if(type == EXPORT_RSP_BLOCK){
+          decode_block(&frame[2], length);
+      }else if(type == EXPORT_RSP_SEGMENTS){
+          decode_segments(&frame[2], length);
+      }
+  }
+
+  fprintf(stderr, "frames %lu, crc errors %lu, samples %lu\n", decode_frames, decode_crc_errors, decode_samples);
+  if(decode_block_samples){
+      fprintf(stderr, "blocks: %lu samples in %lu payload bytes, %.2f bytes per sample\n",
+              decode_block_samples, decode_block_bytes, (double)decode_block_bytes / decode_block_samples);
+  }
+  if(decode_knots){
+      unsigned long segment_samples = decode_samples - decode_block_samples;
+      fprintf(stderr, "segments: %lu samples from %lu knots in %lu payload bytes, %.2f samples per knot, %.2f bytes per sample\n",
+              segment_samples, decode_knots, decode_segment_bytes, (double)segment_samples / decode_knots,
+              (double)decode_segment_bytes / segment_samples);
+  }
+  return 0;
+}
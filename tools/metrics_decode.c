@@ -0,0 +1,208 @@
+/**
+ * @file
+ * metrics_decode.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Host tool that decodes the metrics read over the log export link into names and values
+ *
+ * @details
+ * Build with: cc -O2 -o metrics_decode metrics_decode.c
+ * Usage: metrics_decode [capture] > metrics.csv
+ *
+ * The capture is the raw device to host byte stream of the LEUART, see log_export.h for the frames. METRICS
+ * frames are placed at their offset into the metrics dump, METRIC_DESC frames give the name, type, size and
+ * value address of each metric. Once the capture is read, every metric whose values were received is written
+ * as CSV: name, type, index and value, one line per value. Histogram buckets are those of metrics.h, 0, 1, 2-3,
+ * 4-7 and so on. Frames of the sample stream are skipped, so a capture can hold both.
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define EXPORT_SOF              0xA5
+#define EXPORT_RSP_METRICS      0x86
+#define EXPORT_RSP_METRIC_DESC  0x87
+#define METRICS_MAGIC           0x5352544D
+#define METRICS_VERSION         1
+#define METRICS_HEADER_BYTES    16
+#define DECODE_MAX_DUMP         0x10000
+#define DECODE_MAX_DESCS        1024
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+typedef struct {
+  bool        seen;
+  uint8_t     type;         // METRIC_TYPE
+  uint8_t     words;
+  uint32_t    address;      // value address on the device
+  char        name[256];
+} DESC;
+
+static const char *decode_types[] = { "counter", "gauge", "histogram" };
+
+static uint8_t decode_dump[DECODE_MAX_DUMP];
+static bool decode_have[DECODE_MAX_DUMP];
+static DESC decode_descs[DECODE_MAX_DESCS];
+static unsigned long decode_frames;
+static unsigned long decode_crc_errors;
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * CRC-16/CCITT as computed by log_export_crc16().
+ ******************************************************************************/
+static uint16_t decode_crc16(uint16_t crc, const uint8_t *data, uint32_t length){
+  while(length--){
+      crc ^= (uint16_t)*data++ << 8;
+      for(int bit = 0; bit < 8; bit++){
+          crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+      }
+  }
+  return crc;
+}
+
+static uint32_t decode_u32(const uint8_t *src){
+  return src[0] | (src[1] << 8) | (src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Returns true if every byte of a range of the dump was received.
+ ******************************************************************************/
+static bool decode_received(uint32_t offset, uint32_t length){
+  if(offset > DECODE_MAX_DUMP || length > DECODE_MAX_DUMP - offset){
+      return false;
+  }
+  for(uint32_t i = offset; i < offset + length; i++){
+      if(!decode_have[i]){
+          return false;
+      }
+  }
+  return true;
+}
+
+static void decode_metrics(const uint8_t *payload, uint32_t length){
+  if(length < 4){
+      return;
+  }
+  uint32_t offset = decode_u32(payload);
+  for(uint32_t i = 4; i < length && offset + i - 4 < DECODE_MAX_DUMP; i++){
+      decode_dump[offset + i - 4] = payload[i];
+      decode_have[offset + i - 4] = true;
+  }
+}
+
+static void decode_desc(const uint8_t *payload, uint32_t length){
+  if(length < 8){
+      return; //index past the end of the table
+  }
+  uint32_t index = payload[0] | (payload[1] << 8);
+  if(index >= DECODE_MAX_DESCS){
+      return;
+  }
+  DESC *desc = &decode_descs[index];
+  desc->seen = true;
+  desc->type = payload[2];
+  desc->words = payload[3];
+  desc->address = decode_u32(&payload[4]);
+  memcpy(desc->name, &payload[8], length - 8);
+  desc->name[length - 8] = 0;
+}
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+int main(int argc, char **argv){
+  FILE *capture = argc > 1 ? fopen(argv[1], "rb") : stdin;
+  uint8_t frame[2 + 255 + 2];
+  int byte;
+
+  if(!capture){
+      perror(argv[1]);
+      return 1;
+  }
+
+  while((byte = fgetc(capture)) != EOF){
+      if(byte != EXPORT_SOF){
+          continue;
+      }
+      int type = fgetc(capture);
+      int length = fgetc(capture);
+      if(type == EOF || length == EOF){
+          break;
+      }
+      frame[0] = type;
+      frame[1] = length;
+      if(fread(&frame[2], 1, length + 2, capture) != (size_t)length + 2){
+          break;
+      }
+      uint16_t crc = frame[length + 2] | (frame[length + 3] << 8);
+      if(decode_crc16(0xFFFF, frame, length + 2) != crc){
+          decode_crc_errors++;
+          continue;
+      }
+      decode_frames++;
+      if(type == EXPORT_RSP_METRICS){
+          decode_metrics(&frame[2], length);
+      }else if(type == EXPORT_RSP_METRIC_DESC){
+          decode_desc(&frame[2], length);
+      }
+  }
+  fprintf(stderr, "frames %lu, crc errors %lu\n", decode_frames, decode_crc_errors);
+
+  if(!decode_received(0, METRICS_HEADER_BYTES)){
+      fprintf(stderr, "no METRICS frame at offset 0\n");
+      return 1;
+  }
+  uint32_t magic = decode_u32(&decode_dump[0]);
+  uint32_t version = decode_dump[4] | (decode_dump[5] << 8);
+  uint32_t desc_count = decode_dump[6] | (decode_dump[7] << 8);
+  uint32_t data_addr = decode_u32(&decode_dump[8]);
+  uint32_t data_length = decode_u32(&decode_dump[12]);
+  if(magic != METRICS_MAGIC || version != METRICS_VERSION){
+      fprintf(stderr, "not a metrics dump of version %d\n", METRICS_VERSION);
+      return 1;
+  }
+  if(!decode_received(METRICS_HEADER_BYTES, data_length)){
+      fprintf(stderr, "metrics block of %lu bytes is incomplete\n", (unsigned long)data_length);
+  }
+
+  unsigned long missing = 0;
+  printf("name,type,index,value\n");
+  for(uint32_t index = 0; index < desc_count && index < DECODE_MAX_DESCS; index++){
+      const DESC *desc = &decode_descs[index];
+      uint32_t offset = METRICS_HEADER_BYTES + (desc->address - data_addr);
+      if(!desc->seen || desc->address < data_addr || !decode_received(offset, desc->words * 4)){
+          missing++;
+          continue;
+      }
+      const char *type = desc->type < sizeof(decode_types) / sizeof(decode_types[0]) ? decode_types[desc->type] : "?";
+      for(uint32_t word = 0; word < desc->words; word++){
+          printf("%s,%s,%lu,%lu\n", desc->name, type, (unsigned long)word,
+                 (unsigned long)decode_u32(&decode_dump[offset + word * 4]));
+      }
+  }
+  fprintf(stderr, "metrics %lu, missing %lu\n", (unsigned long)desc_count, missing);
+  return 0;
+}
@@ -0,0 +1,411 @@
+/**
+ * @file
+ * trace_gen.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Library that generates seeded synthetic light traces and writes them as log export frames or CSV
+ *
+ * @details
+ * The scene is the sum of a diurnal sun curve dimmed by cloud transients, a lamp switched on and off with mains
+ * flicker, and a night floor. The sensor turns the light into counts at the configured gain, adds shot and read
+ * noise, saturates at TRACE_RAW_MAX and encodes the count with the firmware's log_code_encode().
+ *
+ * Every random value is a hash of the seed and a sample or interval number instead of a running generator
+ * state, so a sample only depends on the seed and its sequence number. A block is generated in passes over
+ * one array per field, each pass a plain loop without calls or branches the compiler can vectorize.
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <math.h>
+#include <string.h>
+
+#include "trace_gen.h"
+#include "log_code.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define TRACE_DAY_MS          86400000ULL
+
+#define EXPORT_SOF            0xA5
+#define EXPORT_RSP_BLOCK      0x82
+#define EXPORT_MAX_PAYLOAD    255
+#define EXPORT_BLOCK_HEADER   11
+#define EXPORT_MAX_SAMPLE_BYTES 8
+
+// Salts that give each random process of the model its own stream from the one seed
+#define TRACE_SALT_CLOUD      0x636C6F7564000000ULL
+#define TRACE_SALT_LAMP       0x6C616D7000000000ULL
+#define TRACE_SALT_NOISE      0x6E6F697365000000ULL
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+static uint16_t trace_crc_table[4][256];          // CRC-16/CCITT of each byte followed by 0 to 3 zero bytes, built on first use
+static char trace_reading[1 << 16][16];           // CSV reading column of each log code, built on first use
+static uint8_t trace_reading_length[1 << 16];
+
+
+//***********************************************************************************
+// Private functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * splitmix64 finalizer, derives the 32 bit key of each random process from the seed.
+ ******************************************************************************/
+static inline uint64_t trace_hash(uint64_t x){
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+/***************************************************************************//**
+ * @brief
+ * 32 bit integer hash (lowbias32), only 32 bit multiplies so it vectorizes on any SIMD unit.
+ ******************************************************************************/
+static inline uint32_t trace_hash32(uint32_t x){
+  x ^= x >> 16;
+  x *= 0x7FEB352D;
+  x ^= x >> 15;
+  x *= 0x846CA68B;
+  return x ^ (x >> 16);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Uniform value in [0, 1) from the top 24 bits of a hash.
+ ******************************************************************************/
+static inline float trace_unit(uint32_t hash){
+  return (float)(hash >> 8) * (1.0f / 16777216.0f);
+}
+
+/***************************************************************************//**
+ * @brief
+ * Standard normal value from two hashes, the sum of four 16 bit uniforms scaled to unit variance.
+ *
+ * @details
+ * Irwin-Hall with four terms is within 1% of a normal distribution out to 2.5 sigma and needs no log or
+ * square root, so it vectorizes with the rest of the noise pass.
+ ******************************************************************************/
+static inline float trace_normal(uint32_t a, uint32_t b){
+  uint32_t sum = (a & 0xFFFF) + (a >> 16) + (b & 0xFFFF) + (b >> 16);
+  return ((float)sum * (1.0f / 65536.0f) - 2.0f) * 1.7320508f;
+}
+
+/***************************************************************************//**
+ * @brief
+ * sin(2 pi turns) by a polynomial, accurate to 1e-4 and the same on every host.
+ ******************************************************************************/
+static inline float trace_sin_turns(float turns){
+  float x = turns - floorf(turns + 0.5f);     // -0.5 to 0.5 turns
+  float y = 8.0f * x - 16.0f * x * fabsf(x);  // parabola through the sine's zeros and peaks
+  return y + 0.225f * (y * fabsf(y) - y);
+}
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+/***************************************************************************//**
+ * @brief
+ * Fills a configuration with an office by a window, one sample a second from midnight.
+ *
+ * @details
+ * A clear noon saturates the sensor at gain 0, the lamp is on for about half of the working intervals.
+ *
+ * @param[out] config
+ * Configuration to fill
+ ******************************************************************************/
+void trace_default(TRACE_CONFIG *config){
+  config->seed = 1;
+  config->period_ms = 1000;
+  config->start_hour = 0.0;
+
+  config->sun_lux = 80000.0;
+  config->night_lux = 2.0;
+  config->sunrise_hour = 6.5;
+  config->sunset_hour = 19.5;
+
+  config->cloud_cover = 0.6;
+  config->cloud_seconds = 180.0;
+
+  config->lamp_lux = 500.0;
+  config->lamp_seconds = 900.0;
+  config->lamp_duty = 0.5;
+  config->flicker_hz = 120.03;  // mains is rarely on nominal, the ripple beats slowly through whole second samples
+  config->flicker_depth = 0.3;
+
+  config->counts_per_lux = 1.0;
+  config->gain_shift = 0;
+  config->shot_noise = 1.0;
+  config->read_noise = 2.0;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Generates samples first to first + count - 1 of a trace.
+ *
+ * @details
+ * The block is filled in passes: timestamps, sun, clouds, lamp, sensor counts and log codes. Only the
+ * log code pass calls out of the loop, the others vectorize. Splitting a range into blocks of any size
+ * gives the same samples.
+ *
+ * @param[in] config
+ * Scene and sensor model
+ *
+ * @param[in] first
+ * Sequence number of the first sample
+ *
+ * @param[in] count
+ * Number of samples
+ *
+ * @param[in] block
+ * Arrays of at least count entries, lux is used as working space
+ ******************************************************************************/
+void trace_generate(const TRACE_CONFIG *config, uint64_t first, uint32_t count, const TRACE_BLOCK *block){
+  uint32_t *restrict timestamp = block->timestamp;
+  uint32_t *restrict raw = block->raw;
+  uint16_t *restrict code = block->code;
+  float *restrict lux = block->lux;
+
+  double ms0 = config->start_hour * 3600000.0 + (double)first * config->period_ms;
+  double period_ms = config->period_ms;
+  float day_length = (float)((config->sunset_hour - config->sunrise_hour) / 24.0);
+  float sunrise = (float)(config->sunrise_hour / 24.0);
+  float sun_lux = (float)config->sun_lux;
+  float night_lux = (float)config->night_lux;
+  double cloud_ms = config->cloud_seconds > 0.0 ? config->cloud_seconds * 1000.0 : 1.0;
+  double cloud0 = floor(ms0 / cloud_ms);
+  uint32_t cloud_key = (uint32_t)trace_hash(config->seed ^ TRACE_SALT_CLOUD);
+  float cloud_cover = (float)config->cloud_cover;
+  double lamp_ms = config->lamp_seconds > 0.0 ? config->lamp_seconds * 1000.0 : 1.0;
+  double lamp0 = floor(ms0 / lamp_ms);
+  uint32_t lamp_key = (uint32_t)trace_hash(config->seed ^ TRACE_SALT_LAMP);
+  uint32_t lamp_duty = (uint32_t)(config->lamp_duty * 16777216.0);
+  float lamp_lux = (float)config->lamp_lux;
+  double flicker_khz = config->flicker_hz * 0.001;
+  float flicker_depth = (float)config->flicker_depth;
+  float gain = (float)(config->counts_per_lux * (double)(1u << config->gain_shift));
+  uint32_t noise_key = (uint32_t)trace_hash(config->seed ^ TRACE_SALT_NOISE);
+  float shot_noise = (float)config->shot_noise;
+  float read_noise = (float)config->read_noise;
+
+  /* Time is a double of milliseconds, exact to 2^53, so the passes need no 64 bit integer division. Cell and
+   * interval numbers are kept relative to the first of the block and added back as 32 bit integers, which
+   * numbers them the same whatever block a sample falls in. */
+
+  // Timestamps wrap as the firmware's 32 bit millisecond counter does
+  uint32_t timestamp0 = (uint32_t)(first * config->period_ms);
+  for(uint32_t i = 0; i < count; i++){
+      timestamp[i] = timestamp0 + i * config->period_ms;
+  }
+
+  // Sun, a half sine between sunrise and sunset, squared for the low light of morning and evening
+  for(uint32_t i = 0; i < count; i++){
+      double days = (ms0 + i * period_ms) * (1.0 / TRACE_DAY_MS);
+      float phase = ((float)(days - floor(days)) - sunrise) / day_length;
+      float sun = trace_sin_turns(0.5f * phase);
+      sun = phase > 0.0f && phase < 1.0f ? sun * sun : 0.0f;
+      lux[i] = sun_lux * sun;
+  }
+
+  // Clouds, value noise over cloud_seconds cells, the cosine blend between cells keeps the edges smooth
+  for(uint32_t i = 0; i < count; i++){
+      double cells = (ms0 + i * period_ms) / cloud_ms;
+      double whole = floor(cells);
+      uint32_t cell = (uint32_t)cloud0 + (uint32_t)(int32_t)(whole - cloud0);
+      float blend = (float)(cells - whole);
+      float a = trace_unit(trace_hash32(cell ^ cloud_key));
+      float b = trace_unit(trace_hash32((cell + 1) ^ cloud_key));
+      float w = 0.5f - 0.5f * trace_sin_turns(0.25f - 0.5f * blend);
+      float shade = a + (b - a) * w;
+      lux[i] *= 1.0f - cloud_cover * shade * shade;
+  }
+
+  // Lamp, switched at lamp_seconds intervals, with mains ripple
+  for(uint32_t i = 0; i < count; i++){
+      double ms = ms0 + i * period_ms;
+      uint32_t interval = (uint32_t)lamp0 + (uint32_t)(int32_t)(floor(ms / lamp_ms) - lamp0);
+      float on = (trace_hash32(interval ^ lamp_key) >> 8) < lamp_duty ? lamp_lux : 0.0f;
+      double turns = ms * flicker_khz;
+      float ripple = trace_sin_turns((float)(turns - floor(turns)));
+      lux[i] += on * (1.0f + flicker_depth * ripple) + night_lux;
+  }
+
+  // Sensor, counts with shot and read noise, saturated at the 16 bit result
+  for(uint32_t i = 0; i < count; i++){
+      uint64_t seq = first + i;
+      uint32_t a = trace_hash32(trace_hash32((uint32_t)seq ^ noise_key) + (uint32_t)(seq >> 32));
+      uint32_t b = trace_hash32(a ^ noise_key);
+      float counts = lux[i] * gain;
+      float sigma = shot_noise * sqrtf(counts) + read_noise;
+      counts += sigma * trace_normal(a, b);
+      counts = counts < 0.0f ? 0.0f : counts > (float)TRACE_RAW_MAX ? (float)TRACE_RAW_MAX : counts;
+      raw[i] = (uint32_t)(counts + 0.5f);
+  }
+
+  for(uint32_t i = 0; i < count; i++){
+      code[i] = log_code_encode(raw[i], config->gain_shift);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ * Writes the leading samples as one EXPORT_RSP_BLOCK frame, byte for byte as log_export sends them.
+ *
+ * @details
+ * The first sample is written in full, every following one as a timestamp delta-of-delta and a log code
+ * delta. Samples are added while a worst case sample still fits the payload.
+ *
+ * @param[out] frame
+ * Frame, SOF to CRC
+ *
+ * @param[in] first_seq
+ * Sequence number of timestamp[0]
+ *
+ * @param[in] timestamp
+ * Sample timestamps
+ *
+ * @param[in] code
+ * Sample log codes
+ *
+ * @param[in] count
+ * Samples available, at least 1
+ *
+ * @return
+ * Number of samples in the frame
+ ******************************************************************************/
+uint32_t trace_block_frame(TRACE_FRAME *frame, uint32_t first_seq, const uint32_t *timestamp, const uint16_t *code, uint32_t count){
+  uint8_t *payload = &frame->frame[3];
+  uint32_t length = EXPORT_BLOCK_HEADER;
+  uint32_t n = 1;
+  int32_t prev_delta = 0;
+
+  for(int byte = 0; byte < 4; byte++){
+      payload[byte] = first_seq >> (8 * byte);
+      payload[5 + byte] = timestamp[0] >> (8 * byte);
+  }
+  payload[9] = code[0] & 0xFF;
+  payload[10] = code[0] >> 8;
+
+  while(n < count && n < 0xFF && length + EXPORT_MAX_SAMPLE_BYTES <= EXPORT_MAX_PAYLOAD){
+      int32_t delta = (int32_t)(timestamp[n] - timestamp[n - 1]);
+      int32_t field[2] = { delta - prev_delta, (int32_t)code[n] - (int32_t)code[n - 1] };
+      for(int f = 0; f < 2; f++){
+          uint32_t value = ((uint32_t)field[f] << 1) ^ (uint32_t)(field[f] >> 31);
+          while(value >= 0x80){
+              payload[length++] = (value & 0x7F) | 0x80;
+              value >>= 7;
+          }
+          payload[length++] = value;
+      }
+      prev_delta = delta;
+      n++;
+  }
+  payload[4] = n;
+
+  frame->frame[0] = EXPORT_SOF;
+  frame->frame[1] = EXPORT_RSP_BLOCK;
+  frame->frame[2] = length;
+  // Four bytes per step, the contributions of the bytes looked up independently (slicing-by-4)
+  if(!trace_crc_table[0][1]){
+      for(uint32_t byte = 0; byte < 256; byte++){
+          uint16_t crc = byte << 8;
+          for(int bit = 0; bit < 8; bit++){
+              crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+          }
+          trace_crc_table[0][byte] = crc;
+      }
+      for(int slice = 1; slice < 4; slice++){
+          for(uint32_t byte = 0; byte < 256; byte++){
+              uint16_t crc = trace_crc_table[slice - 1][byte];
+              trace_crc_table[slice][byte] = (crc << 8) ^ trace_crc_table[0][crc >> 8];
+          }
+      }
+  }
+  const uint8_t *data = &frame->frame[1];
+  uint32_t remaining = length + 2;
+  uint16_t crc = 0xFFFF;
+  for(; remaining >= 4; remaining -= 4, data += 4){
+      uint32_t word = (uint32_t)((crc >> 8) ^ data[0]) << 24 | (uint32_t)((crc & 0xFF) ^ data[1]) << 16
+                    | (uint32_t)data[2] << 8 | data[3];
+      crc = trace_crc_table[3][word >> 24] ^ trace_crc_table[2][(word >> 16) & 0xFF]
+          ^ trace_crc_table[1][(word >> 8) & 0xFF] ^ trace_crc_table[0][word & 0xFF];
+  }
+  for(; remaining; remaining--){
+      crc = (crc << 8) ^ trace_crc_table[0][(crc >> 8) ^ *data++];
+  }
+  frame->frame[length + 3] = crc & 0xFF;
+  frame->frame[length + 4] = crc >> 8;
+  frame->length = length + 5;
+  return n;
+}
+
+/***************************************************************************//**
+ * @brief
+ * Writes samples as CSV rows in the columns of log_decode, without the header.
+ *
+ * @param[in] out
+ * Output stream
+ *
+ * @param[in] first_seq
+ * Sequence number of timestamp[0]
+ *
+ * @param[in] timestamp
+ * Sample timestamps
+ *
+ * @param[in] code
+ * Sample log codes
+ *
+ * @param[in] count
+ * Number of samples
+ ******************************************************************************/
+void trace_csv(FILE *out, uint32_t first_seq, const uint32_t *timestamp, const uint16_t *code, uint32_t count){
+  char text[4096];
+  uint32_t length = 0;
+
+  for(uint32_t i = 0; i < count; i++){
+      uint32_t field[3] = { first_seq + i, timestamp[i], code[i] };
+      for(int f = 0; f < 3; f++){
+          char digits[10];
+          int n = 0;
+          do{
+              digits[n++] = '0' + field[f] % 10;
+              field[f] /= 10;
+          }while(field[f]);
+          while(n){
+              text[length++] = digits[--n];
+          }
+          text[length++] = ',';
+      }
+      length--;
+      memcpy(&text[length], ".0000,", 6);
+      length += 6;
+
+      // Same text as log_decode's printf of the reading
+      uint16_t c = code[i];
+      if(!trace_reading_length[c]){
+          double reading = c ? pow(2.0, (double)c / (1 << LOG_CODE_FRAC_BITS) - LOG_CODE_BIAS) : 0.0;
+          trace_reading_length[c] = snprintf(trace_reading[c], sizeof(trace_reading[c]), "%.6g\n", reading);
+      }
+      memcpy(&text[length], trace_reading[c], trace_reading_length[c]);
+      length += trace_reading_length[c];
+
+      if(length > sizeof(text) - 64){
+          fwrite(text, 1, length, out);
+          length = 0;
+      }
+  }
+  fwrite(text, 1, length, out);
+}
@@ -0,0 +1,83 @@
+/**
+ * @file
+ * trace_gen.h
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Seeded synthetic light traces in the formats of the firmware, for host tests and benchmarks
+ *
+ */
+#ifndef TRACE_GEN_H
+#define TRACE_GEN_H
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdint.h>
+#include <stdio.h>
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define TRACE_RAW_MAX         0xFFFF    // Si1133 16 bit result, the sensor saturates here
+#define TRACE_FRAME_MAX       (255 + 5) // largest log export frame
+#define TRACE_CSV_HEADER      "seq,timestamp,code,reading\n"   // columns of log_decode
+
+
+//***********************************************************************************
+// global variables
+//***********************************************************************************
+// Scene and sensor model. Every sample is a function of the seed and its sequence number only, so any range
+// of a trace is generated the same way in any block size and in any order.
+typedef struct {
+  uint64_t    seed;
+  uint32_t    period_ms;        // sample period, timestamps are seq * period_ms as in LETIMER mode
+  double      start_hour;       // time of day of sample 0
+
+  double      sun_lux;          // clear sky noon
+  double      night_lux;
+  double      sunrise_hour;
+  double      sunset_hour;
+
+  double      cloud_cover;      // 0 clear to 1 overcast, fraction of daylight clouds can block
+  double      cloud_seconds;    // typical length of a cloud transient
+
+  double      lamp_lux;         // artificial light while switched on
+  double      lamp_seconds;     // a switch can happen once per this interval
+  double      lamp_duty;        // fraction of intervals the lamp is on
+  double      flicker_hz;       // lamp ripple, twice the mains frequency
+  double      flicker_depth;    // ripple as a fraction of the lamp light
+
+  double      counts_per_lux;   // sensor response at gain 0
+  uint32_t    gain_shift;       // HW_GAIN + SW_GAIN of the white light channel
+  double      shot_noise;       // relative noise at one count, falls with the square root of the counts
+  double      read_noise;       // counts
+} TRACE_CONFIG;
+
+// One block of generated samples, one array per field
+typedef struct {
+  uint32_t    *timestamp;
+  uint32_t    *raw;
+  uint16_t    *code;
+  float       *lux;             // scene light before the sensor, in lux
+} TRACE_BLOCK;
+
+// Log export BLOCK frame writer state
+typedef struct {
+  uint8_t     frame[TRACE_FRAME_MAX];
+  uint32_t    length;
+} TRACE_FRAME;
+
+
+//***********************************************************************************
+// function prototypes
+//***********************************************************************************
+void trace_default(TRACE_CONFIG *config);
+void trace_generate(const TRACE_CONFIG *config, uint64_t first, uint32_t count, const TRACE_BLOCK *block);
+uint32_t trace_block_frame(TRACE_FRAME *frame, uint32_t first_seq, const uint32_t *timestamp, const uint16_t *code, uint32_t count);
+void trace_csv(FILE *out, uint32_t first_seq, const uint32_t *timestamp, const uint16_t *code, uint32_t count);
+
+#endif
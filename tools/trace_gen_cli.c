@@ -0,0 +1,134 @@
+/**
+ * @file
+ * trace_gen_cli.c
+ * @author
+ * Adam Vitti
+ * @date
+ * 10/18/26
+ * @brief
+ * Host tool that writes synthetic light traces as a log export capture or CSV, see trace_gen.h
+ *
+ * @details
+ * Build with: cc -O3 -march=native -fno-trapping-math -fno-math-errno -ffp-contract=off -flto -I host
+ *   -I "../src/Header Files" -o trace_gen trace_gen_cli.c trace_gen.c "../src/Source Files/log_code.c" -lm
+ * The first two flags let the generator passes vectorize without changing a result, -ffp-contract=off keeps
+ * FMA out so a seed gives the same trace on every host. host/ stands in for the Silicon Labs headers the
+ * firmware's log_code.c includes.
+ * Usage: trace_gen [options] > trace.bin
+ *   -n count     samples to write, default one day at the sample period
+ *   -f first     sequence number of the first sample, default 0
+ *   -s seed      model seed, default 1
+ *   -p ms        sample period, default 1000
+ *   -h hour      time of day of sample 0, default 0
+ *   -c cover     cloud cover from 0 to 1, default 0.6
+ *   -l lux       lamp light, default 500
+ *   -g gain      HW_GAIN + SW_GAIN of the sensor, default 0
+ *   -t           CSV in the columns of log_decode instead of BLOCK frames
+ *   -b           only generate and report the throughput, nothing is written
+ *
+ * A trace is a function of its seed and sample numbers only, so a long trace can be written in parts by
+ * separate processes with -f and concatenated. The binary output is the device to host stream of a
+ * log export read, and log_decode of it gives the same CSV as -t.
+ *
+ */
+
+//***********************************************************************************
+// Include files
+//***********************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trace_gen.h"
+
+
+//***********************************************************************************
+// defined files
+//***********************************************************************************
+#define CLI_BLOCK_SAMPLES     65536   // samples generated per pass, the arrays stay in L2
+
+
+//***********************************************************************************
+// Private variables
+//***********************************************************************************
+static uint32_t cli_timestamp[CLI_BLOCK_SAMPLES];
+static uint32_t cli_raw[CLI_BLOCK_SAMPLES];
+static uint16_t cli_code[CLI_BLOCK_SAMPLES];
+static float cli_lux[CLI_BLOCK_SAMPLES];
+
+
+//***********************************************************************************
+// Global functions
+//***********************************************************************************
+
+int main(int argc, char **argv){
+  TRACE_CONFIG config;
+  TRACE_BLOCK block = { cli_timestamp, cli_raw, cli_code, cli_lux };
+  TRACE_FRAME frame;
+  uint64_t count = 0;
+  uint64_t first = 0;
+  bool csv = false;
+  bool bench = false;
+  unsigned long long bytes = 0;
+  int option;
+
+  trace_default(&config);
+  while((option = getopt(argc, argv, "n:f:s:p:h:c:l:g:tb")) != -1){
+      switch(option){
+        case 'n': count = strtoull(optarg, 0, 0); break;
+        case 'f': first = strtoull(optarg, 0, 0); break;
+        case 's': config.seed = strtoull(optarg, 0, 0); break;
+        case 'p': config.period_ms = strtoul(optarg, 0, 0); break;
+        case 'h': config.start_hour = atof(optarg); break;
+        case 'c': config.cloud_cover = atof(optarg); break;
+        case 'l': config.lamp_lux = atof(optarg); break;
+        case 'g': config.gain_shift = strtoul(optarg, 0, 0); break;
+        case 't': csv = true; break;
+        case 'b': bench = true; break;
+        default:
+          fprintf(stderr, "usage: %s [-n count] [-f first] [-s seed] [-p ms] [-h hour] [-c cover] [-l lux] [-g gain] [-t] [-b]\n", argv[0]);
+          return 1;
+      }
+  }
+  if(config.period_ms == 0 || config.gain_shift > 18){
+      fprintf(stderr, "period must be at least 1 ms and gain at most 18\n");
+      return 1;
+  }
+  if(!count){
+      count = 86400000 / config.period_ms;
+  }
+
+  if(csv && !bench){
+      fputs(TRACE_CSV_HEADER, stdout);
+  }
+  clock_t start = clock();
+  for(uint64_t done = 0; done < count; ){
+      uint32_t n = count - done < CLI_BLOCK_SAMPLES ? (uint32_t)(count - done) : CLI_BLOCK_SAMPLES;
+      uint64_t seq = first + done;
+      trace_generate(&config, seq, n, &block);
+      if(bench){
+          bytes += n * (sizeof(uint32_t) + sizeof(uint16_t));
+      }else if(csv){
+          trace_csv(stdout, (uint32_t)seq, cli_timestamp, cli_code, n);
+      }else{
+          // A frame never spans two passes, which only moves the frame boundaries
+          for(uint32_t i = 0; i < n; ){
+              i += trace_block_frame(&frame, (uint32_t)(seq + i), &cli_timestamp[i], &cli_code[i], n - i);
+              fwrite(frame.frame, 1, frame.length, stdout);
+              bytes += frame.length;
+          }
+      }
+      done += n;
+  }
+  double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  fprintf(stderr, "%llu samples in %.3f s, %.1f M samples/s", (unsigned long long)count, seconds,
+          seconds > 0 ? count / seconds * 1e-6 : 0.0);
+  if(bytes){
+      fprintf(stderr, ", %.1f MB/s", seconds > 0 ? bytes / seconds * 1e-6 : 0.0);
+  }
+  fprintf(stderr, "\n");
+  return 0;
+}